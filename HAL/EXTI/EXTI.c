@@ -1,4 +1,5 @@
 #include "stm32f4xx_exti.h"
+#include "misc.h"
 #include "EXTI.h"
 
 
@@ -34,10 +35,23 @@ void Exti_Init3(uint8_t preemp_prio, uint8_t sub_prio)
 }
 
 
+// Falling edge on line 4. Port must be selected with SYSCFG_EXTILineConfig().
 void Exti_Init4(uint8_t preemp_prio, uint8_t sub_prio)
 {
-	(void)preemp_prio;
-	(void)sub_prio;
+	EXTI_InitTypeDef EXTI_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+
+	EXTI_InitStructure.EXTI_Line = EXTI_Line4;
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;
+	EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+	EXTI_Init(&EXTI_InitStructure);
+
+	NVIC_InitStructure.NVIC_IRQChannel = EXTI4_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = preemp_prio;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = sub_prio;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
 }
 
 
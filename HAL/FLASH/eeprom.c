@@ -1,13 +1,90 @@
 #include "eeprom.h"
+#include "CRC.h"
 #include <string.h>
 
 
+// The emulated EEPROM is kept as a log in two flash sectors. Each sector starts with a magic
+// word and a sequence number, the sector with the highest sequence number is the active one.
+// Changed blocks of the RAM mirror are appended as records:
+//   Word 0:   Block index (bit 0-7), number of data words (bit 8-15), CRC16 of data (bit 16-31)
+//   Word 1-n: Block data
+// The data words are programmed before the header word. A record that was interrupted by a
+// power loss has no valid header or CRC and is skipped on startup.
+// If the active sector is full, the whole mirror is written into the other sector (compaction).
+#define EE_LOG_MAGIC			((uint32_t)0x474F4C45)		// 'ELOG'
+#define EE_HEADER_SIZE			8
+#define EE_RECORD_SIZE			(4 + EE_BLOCK_SIZE)
+#define EE_NUM_BLOCKS			(EEPROM_SIZE / EE_BLOCK_SIZE)
+#define EE_NO_SECTOR			0xFF
+
+
+typedef struct {
+	uint32_t Address;
+	uint16_t Sector;
+} EE_Sector_t;
+
+static const EE_Sector_t EE_Sectors[2] = {
+	{EEPROM_SECTOR_A_ADDRESS, FLASH_SECTOR_A},
+	{EEPROM_SECTOR_B_ADDRESS, FLASH_SECTOR_B}
+};
+
+
 static uint8_t EepromData[EEPROM_SIZE];
+static uint8_t EE_Dirty[EE_NUM_BLOCKS / 8];
+
+// Active sector and its sequence number
+static uint8_t EE_Active = EE_NO_SECTOR;
+static uint32_t EE_Sequence = 0;
+// Offset of next free record in active sector
+static uint32_t EE_WriteOffset = 0;
+
+
+static uint8_t EE_SectorValid(uint8_t idx);
+static uint8_t EE_SectorBlank(uint8_t idx);
+static void EE_LoadSector(uint8_t idx);
+static uint16_t EE_RecordCRC(uint8_t block, const uint8_t *data);
+static uint32_t EE_RecordHeader(uint8_t block);
+static uint16_t EE_DirtyCount(void);
+static void EE_Compact(void);
 
 
 void EE_Init(void)
 {
-	memcpy(EepromData, (uint8_t*)EEPROM_START_ADDRESS, EEPROM_SIZE);
+	uint8_t valid_a = EE_SectorValid(0);
+	uint8_t valid_b = EE_SectorValid(1);
+
+	memset(EepromData, 0xFF, EEPROM_SIZE);
+	memset(EE_Dirty, 0, sizeof(EE_Dirty));
+
+	if(valid_a && valid_b) {
+		// Power loss after compaction, before the old sector was reused
+		uint32_t seq_a = *(uint32_t*)(EE_Sectors[0].Address + 4);
+		uint32_t seq_b = *(uint32_t*)(EE_Sectors[1].Address + 4);
+
+		EE_Active = ((int32_t)(seq_b - seq_a) > 0) ? 1 : 0;
+	}
+	else if(valid_a) {
+		EE_Active = 0;
+	}
+	else if(valid_b) {
+		EE_Active = 1;
+	}
+	else {
+		EE_Active = EE_NO_SECTOR;
+	}
+
+	if(EE_Active != EE_NO_SECTOR) {
+		EE_Sequence = *(uint32_t*)(EE_Sectors[EE_Active].Address + 4);
+		EE_LoadSector(EE_Active);
+	}
+	else {
+		// No log found. Take over data of the old byte-wise layout in the last sector,
+		// it is written into the log with the next EE_Program().
+		memcpy(EepromData, (uint8_t*)EEPROM_START_ADDRESS, EEPROM_SIZE);
+		memset(EE_Dirty, 0xFF, sizeof(EE_Dirty));
+		EE_Sequence = 0;
+		EE_WriteOffset = 0;
+	}
 }
 
 uint8_t EE_ReadByte(uint16_t VirtAddress)
@@ -17,7 +94,10 @@ uint8_t EE_ReadByte(uint16_t VirtAddress)
 
 void EE_WriteByte(uint16_t VirtAddress, uint8_t Data)
 {
-	EepromData[VirtAddress] = Data;
+	if(EepromData[VirtAddress] != Data) {
+		EepromData[VirtAddress] = Data;
+		EE_Dirty[VirtAddress / EE_BLOCK_SIZE / 8] |= 1 << ((VirtAddress / EE_BLOCK_SIZE) % 8);
+	}
 }
 
 uint8_t EE_ReadByteArray(uint8_t *DataOut, uint16_t VirtAddress, uint16_t size)
@@ -52,14 +132,56 @@ void EE_WriteByteArray(uint16_t VirtAddress, uint8_t *DataIn, uint16_t size)
 	EE_WriteByte(VirtAddress, checksum);
 }
 
+uint8_t EE_ProgramBlocking(uint16_t VirtAddress, uint16_t size)
+{
+	uint16_t blocks = EE_DirtyCount();
+
+	if(size > 0) {
+		// Worst case: All blocks touched by the write are not dirty yet
+		blocks += ((VirtAddress + size) / EE_BLOCK_SIZE) - (VirtAddress / EE_BLOCK_SIZE) + 1;
+	}
+
+	if(EE_Active == EE_NO_SECTOR) {
+		return 1;
+	}
+
+	return (EE_WriteOffset + (uint32_t)blocks*EE_RECORD_SIZE) > EEPROM_SECTOR_SIZE;
+}
+
 void EE_Program(void)
 {
-	EE_Erase();
+	uint16_t blocks = EE_DirtyCount();
+
+	if(blocks == 0) {
+		return;
+	}
+
+	if(EE_ProgramBlocking(0, 0)) {
+		EE_Compact();
+		return;
+	}
+
+	uint32_t base = EE_Sectors[EE_Active].Address;
 
 	FLASH_Unlock();
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+	for(uint8_t i = 0; i < EE_NUM_BLOCKS; i++) {
+		if(!(EE_Dirty[i / 8] & (1 << (i % 8)))) {
+			continue;
+		}
+
+		uint32_t addr = base + EE_WriteOffset;
+		const uint32_t *data = (uint32_t*)&EepromData[i * EE_BLOCK_SIZE];
+
+		// Data first, header last
+		for(uint8_t j = 0; j < EE_BLOCK_SIZE/4; j++) {
+			FLASH_ProgramWord(addr + 4 + j*4, data[j]);
+		}
+		FLASH_ProgramWord(addr, EE_RecordHeader(i));
 
-	for(uint16_t i = 0; i < EEPROM_SIZE; ++i) {
-		FLASH_ProgramByte(EEPROM_START_ADDRESS + i, EepromData[i]);
+		EE_WriteOffset += EE_RECORD_SIZE;
+		EE_Dirty[i / 8] &= ~(1 << (i % 8));
 	}
 
 	FLASH_Lock();
@@ -69,7 +191,141 @@ void EE_Erase(void)
 {
 	FLASH_Unlock();
 
-	FLASH_EraseSector(FLASH_SECTOR, VOLTAGE_RANGE);
+	FLASH_EraseSector(FLASH_SECTOR_A, VOLTAGE_RANGE);
+	FLASH_EraseSector(FLASH_SECTOR_B, VOLTAGE_RANGE);
 
 	FLASH_Lock();
+
+	EE_Active = EE_NO_SECTOR;
+	EE_WriteOffset = 0;
+	memset(EE_Dirty, 0xFF, sizeof(EE_Dirty));
+}
+
+
+static uint8_t EE_SectorValid(uint8_t idx)
+{
+	return *(uint32_t*)EE_Sectors[idx].Address == EE_LOG_MAGIC;
+}
+
+
+static uint8_t EE_SectorBlank(uint8_t idx)
+{
+	const uint32_t *p = (uint32_t*)EE_Sectors[idx].Address;
+
+	for(uint32_t i = 0; i < EEPROM_SECTOR_SIZE/4; i++) {
+		if(p[i] != 0xFFFFFFFF) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+
+static void EE_LoadSector(uint8_t idx)
+{
+	uint32_t base = EE_Sectors[idx].Address;
+	uint32_t offset = EE_HEADER_SIZE;
+
+	// Records are always placed on a fixed grid behind the sector header
+	while(offset + EE_RECORD_SIZE <= EEPROM_SECTOR_SIZE) {
+		uint32_t header = *(uint32_t*)(base + offset);
+		uint8_t block = header & 0xFF;
+		uint8_t len = (header >> 8) & 0xFF;
+		const uint8_t *data = (uint8_t*)(base + offset + 4);
+
+		if(header == 0xFFFFFFFF) {
+			uint8_t j;
+
+			for(j = 0; j < EE_BLOCK_SIZE; j++) {
+				if(data[j] != 0xFF) {
+					break;
+				}
+			}
+			if(j == EE_BLOCK_SIZE) {
+				// Erased slot, end of log
+				break;
+			}
+			// Interrupted record, only data was written
+		}
+		else if(len == EE_BLOCK_SIZE/4 && block < EE_NUM_BLOCKS && (header >> 16) == EE_RecordCRC(block, data)) {
+			memcpy(&EepromData[block * EE_BLOCK_SIZE], data, EE_BLOCK_SIZE);
+		}
+
+		offset += EE_RECORD_SIZE;
+	}
+
+	EE_WriteOffset = offset;
+}
+
+
+static uint16_t EE_RecordCRC(uint8_t block, const uint8_t *data)
+{
+	uint8_t buf[1 + EE_BLOCK_SIZE];
+
+	buf[0] = block;
+	memcpy(&buf[1], data, EE_BLOCK_SIZE);
+
+	return CRC_CalculateCRC16(buf, sizeof(buf));
+}
+
+
+static uint32_t EE_RecordHeader(uint8_t block)
+{
+	uint16_t crc = EE_RecordCRC(block, &EepromData[block * EE_BLOCK_SIZE]);
+
+	return ((uint32_t)crc << 16) | ((EE_BLOCK_SIZE/4) << 8) | block;
+}
+
+
+static uint16_t EE_DirtyCount(void)
+{
+	uint16_t cnt = 0;
+
+	for(uint8_t i = 0; i < EE_NUM_BLOCKS; i++) {
+		if(EE_Dirty[i / 8] & (1 << (i % 8))) {
+			cnt++;
+		}
+	}
+
+	return cnt;
+}
+
+
+static void EE_Compact(void)
+{
+	uint8_t target = (EE_Active == 0) ? 1 : 0;
+	uint32_t base = EE_Sectors[target].Address;
+
+	FLASH_Unlock();
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+	// Sector only needs to be erased if it was used before
+	if(!EE_SectorBlank(target)) {
+		FLASH_EraseSector(EE_Sectors[target].Sector, VOLTAGE_RANGE);
+	}
+
+	EE_WriteOffset = EE_HEADER_SIZE;
+
+	for(uint8_t i = 0; i < EE_NUM_BLOCKS; i++) {
+		uint32_t addr = base + EE_WriteOffset;
+		const uint32_t *data = (uint32_t*)&EepromData[i * EE_BLOCK_SIZE];
+
+		for(uint8_t j = 0; j < EE_BLOCK_SIZE/4; j++) {
+			FLASH_ProgramWord(addr + 4 + j*4, data[j]);
+		}
+		FLASH_ProgramWord(addr, EE_RecordHeader(i));
+
+		EE_WriteOffset += EE_RECORD_SIZE;
+	}
+
+	// Sector becomes valid with its header. Until then, the old sector stays active.
+	EE_Sequence++;
+	FLASH_ProgramWord(base + 4, EE_Sequence);
+	FLASH_ProgramWord(base, EE_LOG_MAGIC);
+
+	FLASH_Lock();
+
+	EE_Active = target;
+	memset(EE_Dirty, 0, sizeof(EE_Dirty));
 }
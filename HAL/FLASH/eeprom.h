@@ -28,10 +28,19 @@
 /* Device voltage range supposed to be [2.7V to 3.6V], the operation will be done by word  */
 #define VOLTAGE_RANGE			(uint8_t)VoltageRange_3
 
-/* EEPROM start address in Flash */
+/* Start address of old byte-wise layout. Used to take over data after an update */
 #define EEPROM_START_ADDRESS	((uint32_t)0x08060000) /* EEPROM emulation start address (last sector): 384 Kb */
 
-#define FLASH_SECTOR			FLASH_Sector_7
+/* The log alternates between the last two sectors (2x 128 Kb) */
+#define EEPROM_SECTOR_A_ADDRESS	((uint32_t)0x08040000)
+#define EEPROM_SECTOR_B_ADDRESS	((uint32_t)0x08060000)
+#define EEPROM_SECTOR_SIZE		((uint32_t)0x20000)
+
+#define FLASH_SECTOR_A			FLASH_Sector_6
+#define FLASH_SECTOR_B			FLASH_Sector_7
+
+/* Changes are appended in blocks of this size. Must be a multiple of 4 */
+#define EE_BLOCK_SIZE			16
 
 
 void EE_Init(void);
@@ -42,6 +51,14 @@ void EE_WriteByte(uint16_t VirtAddress, uint8_t Data);
 uint8_t EE_ReadByteArray(uint8_t *DataOut, uint16_t VirtAddress, uint16_t size);
 void EE_WriteByteArray(uint16_t VirtAddress, uint8_t *DataIn, uint16_t size);
 
+/**
+ * \brief   Checks if writing 'size' bytes at 'VirtAddress' (plus all pending changes) requires
+ *          a compaction, which erases a flash sector and stalls the CPU for up to a few seconds.
+ *          Appending a record only takes a few microseconds.
+ * \return  1 if EE_Program() would block, 0 otherwise
+ */
+uint8_t EE_ProgramBlocking(uint16_t VirtAddress, uint16_t size);
+
 void EE_Program(void);
 void EE_Erase(void);
 
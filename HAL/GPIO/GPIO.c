@@ -183,6 +183,15 @@ static void GPIO_InitSystem(void)
 	GPIO_Init(GPIOA, &GPIO_InitStructure);
 
 	GPIO_SetBits(GPIOA, GPIO_Pin_15);
+
+	// W5500 Interrupt Pin
+	GPIO_InitStructure.GPIO_Pin = W5500_INT_PIN;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_UP;
+	GPIO_Init(W5500_INT_PORT, &GPIO_InitStructure);
+
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_SYSCFG, ENABLE);
+	SYSCFG_EXTILineConfig(W5500_INT_EXTI_PORT, W5500_INT_EXTI_PIN);
 #endif
 
 	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_0 | GPIO_Pin_1 | GPIO_Pin_4;
@@ -9,6 +9,32 @@
 static volatile uint32_t EE_Timeout = EE_LONG_TIMEOUT;
 
 
+// States of transfer engine
+#define I2C_STATE_IDLE          0
+#define I2C_STATE_START         1
+#define I2C_STATE_ADDR          2
+#define I2C_STATE_DATA          3
+#define I2C_STATE_RETRY         4
+
+
+typedef struct {
+    I2C_Request_t Req[I2C_QUEUE_SIZE];
+    volatile uint8_t Head;
+    volatile uint8_t Tail;
+    volatile uint8_t State;
+    uint8_t Idx;
+    uint8_t Retries;
+} I2C_Queue_t;
+
+
+static I2C_Queue_t I2C_Queues[3];
+
+
+static I2C_TypeDef *I2C_GetDevice(I2C_Peripheral_e i2c);
+static void I2C_StartNext(I2C_Peripheral_e i2c);
+static void I2C_Complete(I2C_Peripheral_e i2c, uint8_t status);
+
+
 void I2C_Initialize(I2C_Peripheral_e i2c, I2C_Mode_t *mode)
 {
     I2C_InitTypeDef  I2C_InitStructure;
@@ -63,6 +89,22 @@ void I2C_Initialize(I2C_Peripheral_e i2c, I2C_Mode_t *mode)
 
             /* Apply configuration after enabling it */
             I2C_Init(I2C1, &I2C_InitStructure);
+
+            /* Interrupts for transfer engine */
+            NVIC_InitTypeDef NVIC_InitStructure;
+
+            NVIC_InitStructure.NVIC_IRQChannel = I2C1_EV_IRQn;
+            NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 2;
+            NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+            NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+            NVIC_Init(&NVIC_InitStructure);
+
+            NVIC_InitStructure.NVIC_IRQChannel = I2C1_ER_IRQn;
+            NVIC_Init(&NVIC_InitStructure);
+
+            I2C_Queues[I2C_1].Head = 0;
+            I2C_Queues[I2C_1].Tail = 0;
+            I2C_Queues[I2C_1].State = I2C_STATE_IDLE;
         }
         else if(i2c == I2C_2)
         {
@@ -98,6 +140,9 @@ uint8_t I2C_ReadByte(I2C_Peripheral_e i2c, uint8_t slave_addr, uint16_t register
         break;
     }
 
+    // Wait until queued transfers are finished
+    while(I2C_IsBusy(i2c));
+
     /*!< While the bus is busy */
     EE_Timeout = EE_LONG_TIMEOUT;
     while(I2C_GetFlagStatus(i2c_dev, I2C_FLAG_BUSY))
@@ -244,6 +289,9 @@ uint8_t I2C_WriteByte(I2C_Peripheral_e i2c, uint8_t slave_addr, uint16_t registe
     }
 
 
+    // Wait until queued transfers are finished
+    while(I2C_IsBusy(i2c));
+
     /*!< While the bus is busy */
     EE_Timeout = EE_LONG_TIMEOUT;
     while(I2C_GetFlagStatus(i2c_dev, I2C_FLAG_BUSY))
@@ -347,6 +395,9 @@ uint8_t I2C_ReadByteArray(I2C_Peripheral_e i2c, uint8_t slave_addr, uint16_t reg
         break;
     }
 
+    // Wait until queued transfers are finished
+    while(I2C_IsBusy(i2c));
+
     /*!< While the bus is busy */
     EE_Timeout = EE_LONG_TIMEOUT;
     while(I2C_GetFlagStatus(i2c_dev, I2C_FLAG_BUSY))
@@ -496,6 +547,9 @@ uint8_t I2C_WriteByteArray(I2C_Peripheral_e i2c, uint8_t slave_addr, uint16_t re
     }
 
 
+    // Wait until queued transfers are finished
+    while(I2C_IsBusy(i2c));
+
     /*!< While the bus is busy */
     EE_Timeout = EE_LONG_TIMEOUT;
     while(I2C_GetFlagStatus(i2c_dev, I2C_FLAG_BUSY))
@@ -622,3 +676,206 @@ void I2C_Scan(I2C_Peripheral_e i2c)
 	}
 	Printf("Found %d I2C device(s)\r\n", cnt);
 }
+
+
+uint8_t I2C_Submit(I2C_Peripheral_e i2c, const I2C_Request_t *req)
+{
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+    uint8_t next = (q->Head + 1) % I2C_QUEUE_SIZE;
+
+    if(next == q->Tail)
+    {
+        // Queue full
+        return 1;
+    }
+
+    q->Req[q->Head] = *req;
+    q->Head = next;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    if(q->State == I2C_STATE_IDLE)
+    {
+        I2C_StartNext(i2c);
+    }
+
+    __set_PRIMASK(primask);
+
+    return 0;
+}
+
+
+uint8_t I2C_QueueFree(I2C_Peripheral_e i2c)
+{
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+
+    return (I2C_QUEUE_SIZE - 1) - ((q->Head - q->Tail + I2C_QUEUE_SIZE) % I2C_QUEUE_SIZE);
+}
+
+
+uint8_t I2C_IsBusy(I2C_Peripheral_e i2c)
+{
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+
+    return (q->Head != q->Tail) || (q->State != I2C_STATE_IDLE);
+}
+
+
+void I2C_Tick(void)
+{
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        I2C_Queue_t *q = &I2C_Queues[i];
+
+        if(q->State == I2C_STATE_RETRY)
+        {
+            // Device didn't acknowledge, try again
+            q->State = I2C_STATE_IDLE;
+        }
+
+        if(q->State == I2C_STATE_IDLE && q->Head != q->Tail)
+        {
+            I2C_StartNext((I2C_Peripheral_e)i);
+        }
+    }
+}
+
+
+void I2C_EventHandler(I2C_Peripheral_e i2c)
+{
+    I2C_TypeDef *i2c_dev = I2C_GetDevice(i2c);
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+    I2C_Request_t *req = &q->Req[q->Tail];
+    uint16_t sr1 = i2c_dev->SR1;
+
+    if(sr1 & I2C_SR1_SB)
+    {
+        // EV5: Start condition generated, send slave address
+        i2c_dev->DR = req->SlaveAddr & 0xFE;
+        q->State = I2C_STATE_ADDR;
+    }
+    else if(sr1 & I2C_SR1_ADDR)
+    {
+        // EV6: Address acknowledged, clear ADDR by reading SR2
+        (void)i2c_dev->SR2;
+
+        if(req->Type == I2C_REQ_POLL)
+        {
+            I2C_GenerateSTOP(i2c_dev, ENABLE);
+            I2C_Complete(i2c, 0);
+            return;
+        }
+
+        i2c_dev->DR = req->RegAddr;
+        q->Idx = 0;
+        q->State = I2C_STATE_DATA;
+        I2C_ITConfig(i2c_dev, I2C_IT_BUF, ENABLE);
+    }
+    else if(q->State == I2C_STATE_DATA && (sr1 & I2C_SR1_TXE))
+    {
+        // EV8: Data register empty
+        if(q->Idx < req->Len)
+        {
+            i2c_dev->DR = req->Data[q->Idx++];
+        }
+        else
+        {
+            // Last byte in shift register, wait for BTF
+            I2C_ITConfig(i2c_dev, I2C_IT_BUF, DISABLE);
+
+            if(sr1 & I2C_SR1_BTF)
+            {
+                I2C_GenerateSTOP(i2c_dev, ENABLE);
+                I2C_Complete(i2c, 0);
+            }
+        }
+    }
+}
+
+
+void I2C_ErrorHandler(I2C_Peripheral_e i2c)
+{
+    I2C_TypeDef *i2c_dev = I2C_GetDevice(i2c);
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+    uint16_t sr1 = i2c_dev->SR1;
+
+    // Clear all error flags
+    i2c_dev->SR1 = sr1 & ~(I2C_SR1_AF | I2C_SR1_ARLO | I2C_SR1_BERR | I2C_SR1_OVR);
+
+    if(!(sr1 & I2C_SR1_ARLO))
+    {
+        I2C_GenerateSTOP(i2c_dev, ENABLE);
+    }
+
+    if((sr1 & I2C_SR1_AF) && q->State == I2C_STATE_ADDR && q->Retries < I2C_ACK_POLL_RETRIES)
+    {
+        // No acknowledge of address. Device is busy, retry in next tick.
+        I2C_ITConfig(i2c_dev, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+        q->Retries++;
+        q->State = I2C_STATE_RETRY;
+        return;
+    }
+
+    I2C_Complete(i2c, 1);
+}
+
+
+static I2C_TypeDef *I2C_GetDevice(I2C_Peripheral_e i2c)
+{
+    switch(i2c)
+    {
+    case I2C_2:
+        return I2C2;
+
+    case I2C_3:
+        return I2C3;
+
+    default:
+        return I2C1;
+    }
+}
+
+
+// Must be called with interrupts disabled or from interrupt context
+static void I2C_StartNext(I2C_Peripheral_e i2c)
+{
+    I2C_TypeDef *i2c_dev = I2C_GetDevice(i2c);
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+
+    if(q->Head == q->Tail)
+    {
+        return;
+    }
+
+    // Previous stop condition not sent yet, try again in next tick
+    if((i2c_dev->CR1 & I2C_CR1_STOP) || I2C_GetFlagStatus(i2c_dev, I2C_FLAG_BUSY))
+    {
+        return;
+    }
+
+    q->State = I2C_STATE_START;
+    I2C_ITConfig(i2c_dev, I2C_IT_EVT | I2C_IT_ERR, ENABLE);
+    I2C_GenerateSTART(i2c_dev, ENABLE);
+}
+
+
+static void I2C_Complete(I2C_Peripheral_e i2c, uint8_t status)
+{
+    I2C_TypeDef *i2c_dev = I2C_GetDevice(i2c);
+    I2C_Queue_t *q = &I2C_Queues[i2c];
+    I2C_Callback_t cb = q->Req[q->Tail].Callback;
+
+    I2C_ITConfig(i2c_dev, I2C_IT_EVT | I2C_IT_BUF | I2C_IT_ERR, DISABLE);
+
+    q->Tail = (q->Tail + 1) % I2C_QUEUE_SIZE;
+    q->Retries = 0;
+    q->State = I2C_STATE_IDLE;
+
+    if(cb)
+    {
+        cb(status);
+    }
+
+    I2C_StartNext(i2c);
+}
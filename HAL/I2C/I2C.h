@@ -8,6 +8,17 @@
 #define EE_FLAG_TIMEOUT         ((uint32_t)0x1000)
 #define EE_LONG_TIMEOUT         ((uint32_t)(30 * EE_FLAG_TIMEOUT))
 
+// Number of queued requests per peripheral
+#define I2C_QUEUE_SIZE          16
+// Maximum data bytes per request
+#define I2C_DATA_SIZE           16
+// A device that doesn't acknowledge its address is polled again every 1ms, up to this count
+#define I2C_ACK_POLL_RETRIES    20
+
+// Request types
+#define I2C_REQ_WRITE           0   // Write register address and data
+#define I2C_REQ_POLL            1   // Address device only, completes when device acknowledges
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +30,20 @@ typedef enum {
 } I2C_Peripheral_e;
 
 
+// Called from interrupt context. Status is 0 on success.
+typedef void (*I2C_Callback_t)(uint8_t status);
+
+
+typedef struct {
+    uint8_t Type;
+    uint8_t SlaveAddr;
+    uint8_t RegAddr;
+    uint8_t Len;
+    uint8_t Data[I2C_DATA_SIZE];
+    I2C_Callback_t Callback;
+} I2C_Request_t;
+
+
 typedef struct {
     uint32_t Speed;
     uint16_t Mode;
@@ -36,6 +61,27 @@ uint8_t I2C_WriteByteArray(I2C_Peripheral_e i2c, uint8_t slave_addr, uint16_t re
 
 void I2C_Scan(I2C_Peripheral_e i2c);
 
+/**
+ * \brief   Queues a request for interrupt driven transfer. The request is copied.
+ *          If the device doesn't acknowledge its address (e.g. EEPROM write cycle in progress),
+ *          the request is retried every 1ms (ACK polling).
+ * \return  0 on success, 1 if queue is full
+ */
+uint8_t I2C_Submit(I2C_Peripheral_e i2c, const I2C_Request_t *req);
+
+// Number of free queue entries
+uint8_t I2C_QueueFree(I2C_Peripheral_e i2c);
+
+// Returns 1 while queued requests are pending
+uint8_t I2C_IsBusy(I2C_Peripheral_e i2c);
+
+// Restarts pending requests. Must be called every 1ms.
+void I2C_Tick(void);
+
+// Interrupt handlers of transfer engine
+void I2C_EventHandler(I2C_Peripheral_e i2c);
+void I2C_ErrorHandler(I2C_Peripheral_e i2c);
+
 
 #ifdef __cplusplus
 }
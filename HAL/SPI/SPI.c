@@ -1,6 +1,10 @@
 #include "SPI.h"
 #include "stm32f4xx_rcc.h"
 #include "stm32f4xx_gpio.h"
+#include "stm32f4xx_dma.h"
+
+
+static bool DmaEnabled = false;
 
 
 void Spi_Init(SPI_TypeDef *SPIx, SPI_Mode mode)
@@ -216,6 +220,78 @@ void Spi_WriteDataArray(SPI_TypeDef *SPIx, uint8_t *_data, uint8_t _len)
 }
 
 
+void Spi_InitDMA(SPI_TypeDef *SPIx)
+{
+	if(SPIx == SPI3) {
+		RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_DMA1, ENABLE);
+
+		DMA_DeInit(SPI3_DMA_RX_STREAM);
+		DMA_DeInit(SPI3_DMA_TX_STREAM);
+
+		DmaEnabled = true;
+	}
+}
+
+
+void Spi_TransferDMA(SPI_TypeDef *SPIx, const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+	static uint8_t dummy_tx = 0xFF;
+	static uint8_t dummy_rx = 0;
+	DMA_InitTypeDef DMA_InitStructure;
+
+	if(SPIx != SPI3 || !DmaEnabled || len < SPI_DMA_MIN_SIZE) {
+		for(uint16_t i = 0; i < len; i++) {
+			uint8_t c = Spi_WriteByte(SPIx, tx ? tx[i] : 0xFF);
+
+			if(rx) {
+				rx[i] = c;
+			}
+		}
+		return;
+	}
+
+	DMA_StructInit(&DMA_InitStructure);
+	DMA_InitStructure.DMA_Channel = SPI3_DMA_CHANNEL;
+	DMA_InitStructure.DMA_PeripheralBaseAddr = (uint32_t)&SPIx->DR;
+	DMA_InitStructure.DMA_BufferSize = len;
+	DMA_InitStructure.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+	DMA_InitStructure.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	DMA_InitStructure.DMA_MemoryDataSize = DMA_MemoryDataSize_Byte;
+	DMA_InitStructure.DMA_Mode = DMA_Mode_Normal;
+	DMA_InitStructure.DMA_Priority = DMA_Priority_High;
+	DMA_InitStructure.DMA_FIFOMode = DMA_FIFOMode_Disable;
+
+	// Receive stream
+	DMA_InitStructure.DMA_DIR = DMA_DIR_PeripheralToMemory;
+	DMA_InitStructure.DMA_Memory0BaseAddr = rx ? (uint32_t)rx : (uint32_t)&dummy_rx;
+	DMA_InitStructure.DMA_MemoryInc = rx ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+	DMA_Init(SPI3_DMA_RX_STREAM, &DMA_InitStructure);
+
+	// Transmit stream
+	DMA_InitStructure.DMA_DIR = DMA_DIR_MemoryToPeripheral;
+	DMA_InitStructure.DMA_Memory0BaseAddr = tx ? (uint32_t)tx : (uint32_t)&dummy_tx;
+	DMA_InitStructure.DMA_MemoryInc = tx ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
+	DMA_Init(SPI3_DMA_TX_STREAM, &DMA_InitStructure);
+
+	DMA_ClearFlag(SPI3_DMA_RX_STREAM, SPI3_DMA_RX_FLAGS);
+	DMA_ClearFlag(SPI3_DMA_TX_STREAM, SPI3_DMA_TX_FLAGS);
+
+	// Discard stale data
+	(void)SPIx->DR;
+
+	DMA_Cmd(SPI3_DMA_RX_STREAM, ENABLE);
+	DMA_Cmd(SPI3_DMA_TX_STREAM, ENABLE);
+	SPI_I2S_DMACmd(SPIx, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, ENABLE);
+
+	// Transfer is complete when the last byte was received
+	while(DMA_GetFlagStatus(SPI3_DMA_RX_STREAM, DMA_FLAG_TCIF0) == RESET);
+
+	SPI_I2S_DMACmd(SPIx, SPI_I2S_DMAReq_Rx | SPI_I2S_DMAReq_Tx, DISABLE);
+	DMA_Cmd(SPI3_DMA_RX_STREAM, DISABLE);
+	DMA_Cmd(SPI3_DMA_TX_STREAM, DISABLE);
+}
+
+
 void Spi_SetPrescaler(SPI_TypeDef *SPIx, uint16_t prescaler)
 {
     SPI_Cmd(SPIx, DISABLE);
@@ -24,6 +24,17 @@
 #define SPI3_CS_GPIO_CLK        RCC_AHB1Periph_GPIOD
 
 
+// DMA streams of SPI3 (DMA1, Channel 0)
+#define SPI3_DMA_RX_STREAM      DMA1_Stream0
+#define SPI3_DMA_RX_FLAGS       (DMA_FLAG_TCIF0 | DMA_FLAG_HTIF0 | DMA_FLAG_TEIF0 | DMA_FLAG_DMEIF0 | DMA_FLAG_FEIF0)
+#define SPI3_DMA_TX_STREAM      DMA1_Stream5
+#define SPI3_DMA_TX_FLAGS       (DMA_FLAG_TCIF5 | DMA_FLAG_HTIF5 | DMA_FLAG_TEIF5 | DMA_FLAG_DMEIF5 | DMA_FLAG_FEIF5)
+#define SPI3_DMA_CHANNEL        DMA_Channel_0
+
+// Shorter transfers are done byte by byte, DMA setup takes longer
+#define SPI_DMA_MIN_SIZE        8
+
+
 #define SPI_PRESCALER_2         0x0000
 #define SPI_PRESCALER_4         0x0008
 #define SPI_PRESCALER_8         0x0010
@@ -52,6 +63,18 @@ uint8_t Spi_WriteByte(SPI_TypeDef *SPIx, uint8_t _data);
 void Spi_ReadByteArray(SPI_TypeDef *SPIx, uint8_t *_buffer, uint8_t _len);
 void Spi_WriteDataArray(SPI_TypeDef *SPIx, uint8_t *_data, uint8_t _len);
 
+/**
+ * \brief   Enables DMA transfers. Only available for SPI3, other interfaces fall back to polling.
+ */
+void Spi_InitDMA(SPI_TypeDef *SPIx);
+
+/**
+ * \brief   Full duplex burst transfer. Returns when the last byte is received.
+ * \param   tx  Data to send. If 0, 0xFF is sent.
+ * \param   rx  Receive buffer. If 0, received data is discarded.
+ */
+void Spi_TransferDMA(SPI_TypeDef *SPIx, const uint8_t *tx, uint8_t *rx, uint16_t len);
+
 void Spi_SetPrescaler(SPI_TypeDef *SPIx, uint16_t prescaler);
 void Spi_ChipSelect(SPI_TypeDef *SPIx, bool select);
 
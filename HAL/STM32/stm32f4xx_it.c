@@ -37,6 +37,11 @@
 #include "Config.h"
 #include "MotionControl.h"
 #include "Platform.h"
+#include "Recorder.h"
+#include "Benchmark.h"
+#include "I2C.h"
+#include "ServerTCP.h"
+#include "Print.h"
 
 
 /** @addtogroup Template_Project
@@ -226,6 +231,11 @@ void PendSV_Handler(void)
   */
 void SysTick_Handler(void)
 {
+#ifdef ENABLE_RECORDER
+	// Replayed pin states must be in place before the pins are sampled
+	Recorder_Tick();
+#endif
+
 	/*
 	 * Because of the board layout, we cant attach all pins to interrupts.
 	 * Therefore we just poll them in this 1ms task, which is hopefully fast
@@ -256,6 +266,15 @@ void SysTick_Handler(void)
 		DebounceCounterControl--;
 	}
 
+#ifdef ENABLE_RECORDER
+	Recorder_LogPins(limits, controls);
+#endif
+
+#ifdef USE_EXT_EEPROM
+	// Restart pending I2C transfers
+	I2C_Tick();
+#endif
+
 	gMillis++;
 }
 
@@ -277,7 +296,13 @@ void TIM1_BRK_TIM9_IRQHandler(void)
 	/* TIM9_CH1 */
 	if(TIM_GetITStatus(TIM9, TIM_IT_CC1) != RESET) {
 		// OC
+#ifdef ENABLE_BENCHMARK
+		uint32_t cycles = Benchmark_GetCycles();
 		Stepper_MainISR();
+		Benchmark_Add(BENCH_STEPPER_ISR, Benchmark_GetCycles() - cycles);
+#else
+		Stepper_MainISR();
+#endif
 
 		TIM_ClearITPendingBit(TIM9, TIM_IT_CC1);
 	}
@@ -290,6 +315,24 @@ void TIM1_BRK_TIM9_IRQHandler(void)
 }
 
 
+/**
+  * @brief  This function handles External line 4 interrupt request.
+  * @param  None
+  * @retval None
+  */
+void EXTI4_IRQHandler(void)
+{
+	if(EXTI_GetITStatus(EXTI_Line4) != RESET) {
+#ifdef ETH_IF
+		// W5500 INTn
+		ServerTCP_Interrupt();
+#endif
+
+		EXTI_ClearITPendingBit(EXTI_Line4);
+	}
+}
+
+
 /**
   * @brief  This function handles External lines 9 to 5 interrupt request.
   * @param  None
@@ -300,6 +343,28 @@ void EXTI9_5_IRQHandler(void)
 }
 
 
+/**
+  * @brief  This function handles I2C1 event interrupt request.
+  * @param  None
+  * @retval None
+  */
+void I2C1_EV_IRQHandler(void)
+{
+	I2C_EventHandler(I2C_1);
+}
+
+
+/**
+  * @brief  This function handles I2C1 error interrupt request.
+  * @param  None
+  * @retval None
+  */
+void I2C1_ER_IRQHandler(void)
+{
+	I2C_ErrorHandler(I2C_1);
+}
+
+
 /**
   * @brief  This function handles USART1 global interrupt request.
   * @param  None
@@ -347,7 +412,22 @@ void USART2_IRQHandler(void)
 		/* Read one byte from the receive data register */
 		unsigned char c = (USART_ReceiveData(USART2) & 0xFF);
 
-		ProcessReceive(c);
+		if(c == CMD_STATUS_REPORT && !Print_SerialGrIP()) {
+			// Report goes to serial, even if TCP streams
+			Print_RequestReport(PRINT_SERIAL);
+		}
+
+#ifdef ENABLE_RECORDER
+		Recorder_Receive(REC_EVT_SERIAL, c);
+#else
+		if(Print_SerialGrIP()) {
+			// Packets are parsed by GrIP, realtime commands come as MSG_REALTIME_CMD
+			FifoUsart_Insert(USART2_NUM, USART_DIR_RX, c);
+		}
+		else {
+			ProcessReceive(c);
+		}
+#endif
 	}
 
 	if(USART_GetITStatus(USART2, USART_IT_TXE) != RESET) {
@@ -52,11 +52,17 @@ void DebugMon_Handler(void);
 void PendSV_Handler(void);
 void SysTick_Handler(void);
 
+void EXTI4_IRQHandler(void);
 void TIM1_BRK_TIM9_IRQHandler(void);
+void I2C1_EV_IRQHandler(void);
+void I2C1_ER_IRQHandler(void);
 void USART1_IRQHandler(void);
 void USART2_IRQHandler(void);
 void USART6_IRQHandler(void);
 
+uint32_t millis(void);
+void ProcessReceive(char c);
+
 
 #ifdef __cplusplus
 }
@@ -49,3 +49,24 @@ void Delay_ms(volatile uint32_t ms)
 	while(ms--)
 		Delay_us(999);
 }
+
+
+// Free running core clock counter, derived from millis and the SysTick down counter.
+// Unlike the DWT cycle counter, this also works on emulators. Wraps every ~44s at 96 MHz.
+uint32_t SysTick_GetCycles(void)
+{
+	uint32_t reload = SysTick->LOAD + 1;
+	uint32_t ms, val;
+
+	do {
+		ms = millis();
+		val = SysTick->VAL;
+
+		// Counter wrapped, but tick interrupt is still pending (called from higher priority ISR)
+		if((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && (val > (reload/2))) {
+			ms++;
+		}
+	} while(ms != millis());
+
+	return (ms * reload) + (reload - 1 - val);
+}
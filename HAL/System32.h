@@ -44,6 +44,7 @@ typedef struct {
 void SysTick_Init(void);
 void Delay_us(volatile uint32_t us);
 void Delay_ms(volatile uint32_t ms);
+uint32_t SysTick_GetCycles(void);
 
 
 #ifdef __cplusplus
@@ -30,19 +30,20 @@
  */
 #include <string.h>
 #include "FIFO_USART.h"
+#include "Platform.h"
 #include "debug.h"
 
 
 static char FifoQueue[USART_NUM][2][QUEUE_SIZE];
-static uint8_t QueueIn[2][USART_NUM], QueueOut[2][USART_NUM];
-static uint32_t Count[USART_NUM] = {0};
+// In is only written by the producer, Out only by the consumer. The fill level is derived
+// from both, so interrupt and main loop don't race on a shared counter.
+static volatile uint16_t QueueIn[2][USART_NUM], QueueOut[2][USART_NUM];
 
 
 void FifoUsart_Init(void)
 {
-    memset(QueueIn, 0, sizeof(QueueIn));
-    memset(QueueOut, 0, sizeof(QueueOut));
-    memset(Count, 0, sizeof(Count));
+    memset((void*)QueueIn, 0, sizeof(QueueIn));
+    memset((void*)QueueOut, 0, sizeof(QueueOut));
 }
 
 
@@ -68,7 +69,13 @@ int8_t FifoUsart_Insert(uint8_t usart, uint8_t direction, char ch)
 
     QueueIn[direction][usart] = (QueueIn[direction][usart] + 1) % QUEUE_SIZE;
 
-    Count[usart]++;
+#ifdef USART_FLOW_CONTROL
+    if(usart == STDOUT_NUM && direction == USART_DIR_RX && FifoUsart_Count(usart, direction) >= USART_RTS_OFF_LEVEL)
+    {
+        // Almost full, host has to pause
+        GPIO_SetBits(USART_RTS_PORT, USART_RTS_PIN);
+    }
+#endif
 
     return 0; // No errors
 }
@@ -96,12 +103,30 @@ int8_t FifoUsart_Get(uint8_t usart, uint8_t direction, char *ch)
 
     QueueOut[direction][usart] = (QueueOut[direction][usart] + 1) % QUEUE_SIZE;
 
-    Count[usart]--;
+#ifdef USART_FLOW_CONTROL
+    if(usart == STDOUT_NUM && direction == USART_DIR_RX && FifoUsart_Count(usart, direction) <= USART_RTS_ON_LEVEL)
+    {
+        // Host may continue
+        GPIO_ResetBits(USART_RTS_PORT, USART_RTS_PIN);
+    }
+#endif
 
     return 0; // No errors
 }
 
 
+uint32_t FifoUsart_Count(uint8_t usart, uint8_t direction)
+{
+    if(usart >= USART_NUM || direction > 1) {
+		d_printf("ERROR: Wrong USART %d\n", usart);
+
+		return 0;
+	}
+
+    return (QueueIn[direction][usart] + QUEUE_SIZE - QueueOut[direction][usart]) % QUEUE_SIZE;
+}
+
+
 uint32_t FifoUsart_Available(uint8_t usart)
 {
     if(usart >= USART_NUM) {
@@ -110,5 +135,6 @@ uint32_t FifoUsart_Available(uint8_t usart)
 		return 0xFFFFFFFF;
 	}
 
-    return (QUEUE_ELEMENTS - Count[usart]);
+    // Free space of receive buffer
+    return (QUEUE_ELEMENTS - FifoUsart_Count(usart, USART_DIR_RX));
 }
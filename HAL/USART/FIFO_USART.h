@@ -24,9 +24,14 @@
 
 
 /* Queue structure */
-#define QUEUE_ELEMENTS 		320
+#define QUEUE_ELEMENTS 		512
 #define QUEUE_SIZE 			(QUEUE_ELEMENTS + 1)
 
+// RTS flow control thresholds of the receive buffer. The margin covers bytes, which the
+// host (USB-serial adapter) still sends after RTS was released.
+#define USART_RTS_OFF_LEVEL	(QUEUE_ELEMENTS - 64)
+#define USART_RTS_ON_LEVEL	(QUEUE_ELEMENTS / 2)
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -36,6 +41,9 @@ extern "C" {
 void FifoUsart_Init(void);
 int8_t FifoUsart_Insert(uint8_t usart, uint8_t direction, char ch);
 int8_t FifoUsart_Get(uint8_t usart, uint8_t direction, char *ch);
+// Number of bytes in buffer
+uint32_t FifoUsart_Count(uint8_t usart, uint8_t direction);
+// Free space of receive buffer
 uint32_t FifoUsart_Available(uint8_t usart);
 
 
@@ -18,11 +18,17 @@
 #include <stdio.h>
 #include "USART.h"
 #include "FIFO_USART.h"
+#include "Platform.h"
+#include "stm32f4xx_it.h"
 
 
 static uint8_t FifoInit = 0;
 
 
+static void Usart_InitFlowControl(void);
+static void Usart_WaitCts(USART_TypeDef *usart);
+
+
 void Usart_Init(USART_TypeDef *usart, uint32_t baud)
 {
 	USART_InitTypeDef USART_InitStructure;
@@ -100,6 +106,8 @@ void Usart_Init(USART_TypeDef *usart, uint32_t baud)
 		/* USART configuration */
 		USART_Init(USART2, &USART_InitStructure);
 
+		Usart_InitFlowControl();
+
 		NVIC_InitTypeDef NVIC_InitStructure;
 
 		/* Enable the USARTx Interrupt */
@@ -156,6 +164,27 @@ void Usart_Init(USART_TypeDef *usart, uint32_t baud)
 	USART_Cmd(usart, ENABLE);
 }
 
+void Usart_SetBaud(USART_TypeDef *usart, uint32_t baud)
+{
+	USART_InitTypeDef USART_InitStructure;
+
+	// Let last byte leave the shift register
+	while(USART_GetFlagStatus(usart, USART_FLAG_TC) == RESET);
+
+	USART_Cmd(usart, DISABLE);
+
+	// Keeps interrupt enables and oversampling by 8
+	USART_InitStructure.USART_BaudRate = baud;
+	USART_InitStructure.USART_WordLength = USART_WordLength_8b;
+	USART_InitStructure.USART_StopBits = USART_StopBits_1;
+	USART_InitStructure.USART_Parity = USART_Parity_No;
+	USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+	USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx;
+	USART_Init(usart, &USART_InitStructure);
+
+	USART_Cmd(usart, ENABLE);
+}
+
 void Usart_Put(USART_TypeDef *usart, bool buffered, char c)
 {
     uint8_t num = 0;
@@ -182,14 +211,15 @@ void Usart_Put(USART_TypeDef *usart, bool buffered, char c)
     }
     else
     {
+        Usart_WaitCts(usart);
         while(USART_GetFlagStatus(usart, USART_FLAG_TC) == RESET);
 		USART_SendData(usart, c);
     }
 }
 
-void Usart_Write(USART_TypeDef *usart, bool buffered, char *data, uint8_t len)
+void Usart_Write(USART_TypeDef *usart, bool buffered, char *data, uint16_t len)
 {
-	uint8_t i = 0;
+	uint16_t i = 0;
 	uint8_t num = 0;
 
     if(usart == USART1)
@@ -219,6 +249,7 @@ void Usart_Write(USART_TypeDef *usart, bool buffered, char *data, uint8_t len)
     {
 		while(len--)
         {
+            Usart_WaitCts(usart);
             while(USART_GetFlagStatus(usart, USART_FLAG_TC) == RESET);
             USART_SendData(usart, data[i++]);
         }
@@ -249,3 +280,54 @@ void Usart_RxInt(USART_TypeDef *usart, bool enable)
 	}
 }
 
+static void Usart_InitFlowControl(void)
+{
+#ifdef USART_FLOW_CONTROL
+	GPIO_InitTypeDef GPIO_InitStructure;
+
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_GPIOC, ENABLE);
+
+	/* RTS low: Ready to receive */
+	GPIO_ResetBits(USART_RTS_PORT, USART_RTS_PIN);
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_OUT;
+	GPIO_InitStructure.GPIO_Pin = USART_RTS_PIN;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_InitStructure.GPIO_OType = GPIO_OType_PP;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_NOPULL;
+	GPIO_Init(USART_RTS_PORT, &GPIO_InitStructure);
+
+	/* CTS pulled low, so an unconnected pin doesn't block output */
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IN;
+	GPIO_InitStructure.GPIO_Pin = USART_CTS_PIN;
+	GPIO_InitStructure.GPIO_PuPd = GPIO_PuPd_DOWN;
+	GPIO_Init(USART_CTS_PORT, &GPIO_InitStructure);
+#endif
+}
+
+static void Usart_WaitCts(USART_TypeDef *usart)
+{
+#ifdef USART_FLOW_CONTROL
+	// Set after a timeout, so a stuck CTS stalls only the first byte
+	static uint8_t cts_stuck = 0;
+
+	if(usart == STDOUT)
+	{
+		uint32_t start = millis();
+
+		// Host can't take more data
+		while(GPIO_ReadInputDataBit(USART_CTS_PORT, USART_CTS_PIN) == Bit_SET)
+		{
+			if(cts_stuck || (millis() - start) > USART_CTS_TIMEOUT)
+			{
+				// Host gone or adapter without CTS, don't block the main loop
+				cts_stuck = 1;
+				return;
+			}
+		}
+
+		cts_stuck = 0;
+	}
+#else
+	(void)usart;
+#endif
+}
@@ -45,9 +45,11 @@ extern "C" {
 
 
 void Usart_Init(USART_TypeDef *usart, uint32_t baud);
+// Changes baud rate after pending output is sent
+void Usart_SetBaud(USART_TypeDef *usart, uint32_t baud);
 
 void Usart_Put(USART_TypeDef *usart, bool buffered, char c);
-void Usart_Write(USART_TypeDef *usart, bool buffered, char *data, uint8_t len);
+void Usart_Write(USART_TypeDef *usart, bool buffered, char *data, uint16_t len);
 
 void Usart_TxInt(USART_TypeDef *usart, bool enable);
 void Usart_RxInt(USART_TypeDef *usart, bool enable);
@@ -16,38 +16,30 @@
   along with program.  If not, see <http://www.gnu.org/licenses/>.
 */
 #include <stdio.h>
+#include <string.h>
 #include "CRC.h"
+#include "CRC_Tables.h"
+
+#if (CRC_32_MODE == HARDWARE)
+#include "stm32f4xx.h"
+#endif
 
 
 //---- Prototypes ----//
-static void CRC_CalculateCRC8Table(void);
-static void CRC_CalculateCRC16Table(void);
-static void CRC_CalculateCRC32Table(void);
+static uint32_t CRC_ProcessCRC32(uint32_t Crc, const uint8_t *Buffer, uint16_t Length);
 
+#if (CRC_32_MODE == RUNTTIME)
 static uint8_t CRC_ReverseBitOrder8(uint8_t value);
 static uint32_t CRC_ReverseBitOrder32(uint32_t value);
-
-
-
-#if (CRC_8_MODE == TABLE)
-	static uint8_t CRC8Table[256u];
-#endif
-
-#if (CRC_16_MODE == TABLE)
-	static uint16_t CRC16Table[256u];
-#endif
-
-#if (CRC_32_MODE == TABLE)
-	static uint32_t CRC32Table[256u];
 #endif
 
 
 
 void CRC_Init(void)
 {
-	CRC_CalculateCRC8Table();
-	CRC_CalculateCRC16Table();
-	CRC_CalculateCRC32Table();
+#if (CRC_32_MODE == HARDWARE)
+	RCC_AHB1PeriphClockCmd(RCC_AHB1Periph_CRC, ENABLE);
+#endif
 }
 
 
@@ -169,12 +161,13 @@ uint16_t CRC_CalculateCRC16(const uint8_t *Buffer, uint16_t Length)
 uint32_t CRC_CalculateCRC32(const uint8_t *Buffer, uint16_t Length)
 {
 	uint32_t retVal = 0u;
-	uint16_t byteIndex = 0u;
 
 
 	if(Buffer != NULL)
     {
 #if (CRC_32_MODE==RUNTTIME)
+        uint16_t byteIndex = 0u;
+
 		retVal = CRC_32_INIT_VALUE;
 
         /* Do calculation procedure for each byte */
@@ -201,17 +194,32 @@ uint32_t CRC_CalculateCRC32(const uint8_t *Buffer, uint16_t Length)
         /* XOR result with specified value */
 		retVal ^= CRC_32_XOR_VALUE;
 
-#elif (CRC_32_MODE==TABLE)
-        uint8_t data = 0u;
+        /* Reflect result */
+        retVal = CRC_ReverseBitOrder32(retVal);
 
-		retVal = CRC_32_INIT_VALUE;
+#elif (CRC_32_MODE == TABLE) || (CRC_32_MODE == SLICE_4) || (CRC_32_MODE == SLICE_8)
+		retVal = CRC_ProcessCRC32(CRC_32_INIT_VALUE, Buffer, Length);
 
-		for(byteIndex = 0u; byteIndex < Length; ++byteIndex)
+		/* XOR result with specified value */
+		retVal ^= CRC_32_XOR_VALUE;
+
+#elif (CRC_32_MODE == HARDWARE)
+        uint16_t byteIndex = 0u;
+        uint32_t word = 0u;
+
+        /* Unit starts with 0xFFFFFFFF and shifts MSB first. Bit reversed words give the
+           reflected CRC, bit reversing the register gives the reflected state. */
+        CRC->CR = CRC_CR_RESET;
+
+        for(; (byteIndex + 4u) <= Length; byteIndex += 4u)
         {
-            data = CRC_ReverseBitOrder8(Buffer[byteIndex]) ^ (retVal >> (CRC_32_RESULT_WIDTH - 8u));
-            retVal = CRC32Table[data] ^ (retVal << 8u);
+            memcpy(&word, &Buffer[byteIndex], 4u);
+            CRC->DR = __RBIT(word);
         }
 
+        /* Remaining bytes */
+        retVal = CRC_ProcessCRC32(__RBIT(CRC->DR), &Buffer[byteIndex], Length - byteIndex);
+
 		/* XOR result with specified value */
 		retVal ^= CRC_32_XOR_VALUE;
 
@@ -222,97 +230,80 @@ uint32_t CRC_CalculateCRC32(const uint8_t *Buffer, uint16_t Length)
 #endif
 	}
 
-    /* Reflect result */
-    retVal = CRC_ReverseBitOrder32(retVal);
-
 	return retVal;
 }
 
 
-static void CRC_CalculateCRC8Table(void)
+uint32_t CRC_UpdateCRC32(uint32_t Crc, const uint8_t *Buffer, uint16_t Length)
 {
-#if (CRC_8_MODE==TABLE)
-	uint16_t i = 0u, j = 0u;
-
-	for(i = 0u; i < 256u; ++i)
-	{
-		uint8_t curr = i;
-
-		for(j = 0u; j < 8u; ++j)
-		{
-			if((curr & 0x80u) != 0u)
-			{
-				curr = (curr << 1u) ^ CRC_8_POLYNOMIAL;
-			}
-			else
-			{
-				curr <<= 1u;
-			}
-		}
+    if(Buffer == NULL)
+    {
+        return Crc;
+    }
 
-		CRC8Table[i] = curr;
-	}
-#endif
+    return CRC_ProcessCRC32(Crc ^ CRC_32_XOR_VALUE, Buffer, Length) ^ CRC_32_XOR_VALUE;
 }
 
 
-static void CRC_CalculateCRC16Table(void)
+/* Continues reflected CRC32 calculation from state Crc (no final XOR) */
+static uint32_t CRC_ProcessCRC32(uint32_t Crc, const uint8_t *Buffer, uint16_t Length)
 {
-#if (CRC_16_MODE==TABLE)
-	uint16_t i = 0u, j = 0u;
-	uint16_t result = 0u;
-	uint16_t xor_flag = 0u;
-
-	for(i = 0u; i < 256u; i++)
-	{
-		result = i << 8u;
-
-		for(j = 0u; j < 8u; j++)
-		{
-			/* Flag for XOR if leftmost bit is set */
-			xor_flag = result & 0x8000u;
-
-			/* Shift CRC */
-			result <<= 1u;
-
-			/* Perform the XOR */
-			if(xor_flag != 0u)
-				result ^= CRC_16_POLYNOMIAL;
-		}
+    uint16_t byteIndex = 0u;
 
-		CRC16Table[i] = result;
-	}
-#endif
-}
+#if (CRC_32_MODE == RUNTTIME)
+    for(; byteIndex < Length; ++byteIndex)
+    {
+        Crc ^= Buffer[byteIndex];
 
+        for(uint8_t bitIndex = 0u; bitIndex < 8u; bitIndex++)
+        {
+            Crc = (Crc & 1u) ? ((Crc >> 1u) ^ CRC_32_POLYNOMIAL_REFLECTED) : (Crc >> 1u);
+        }
+    }
+#else
+#if (CRC_32_MODE == SLICE_4) || (CRC_32_MODE == SLICE_8)
+    uint32_t word = 0u;
 
-static void CRC_CalculateCRC32Table(void)
-{
-#if (CRC_32_MODE==TABLE)
-    uint32_t remainder = 0u;
+#if (CRC_32_MODE == SLICE_8)
+    uint32_t word2 = 0u;
+
+    /* 8 bytes per step, little endian words */
+    for(; (byteIndex + 8u) <= Length; byteIndex += 8u)
+    {
+        memcpy(&word, &Buffer[byteIndex], 4u);
+        memcpy(&word2, &Buffer[byteIndex + 4u], 4u);
+        word ^= Crc;
+
+        Crc = CRC32Table[7][word & 0xFFu] ^ CRC32Table[6][(word >> 8u) & 0xFFu] ^
+              CRC32Table[5][(word >> 16u) & 0xFFu] ^ CRC32Table[4][word >> 24u] ^
+              CRC32Table[3][word2 & 0xFFu] ^ CRC32Table[2][(word2 >> 8u) & 0xFFu] ^
+              CRC32Table[1][(word2 >> 16u) & 0xFFu] ^ CRC32Table[0][word2 >> 24u];
+    }
+#endif
 
-    for(uint32_t dividend = 0u; dividend < 256u; ++dividend)
+    /* 4 bytes per step */
+    for(; (byteIndex + 4u) <= Length; byteIndex += 4u)
     {
-        remainder = dividend << (CRC_32_RESULT_WIDTH - 8u);
+        memcpy(&word, &Buffer[byteIndex], 4u);
+        word ^= Crc;
 
-        for(uint8_t bit = 8u; bit > 0u; --bit)
-        {
-            if(remainder & (1u << (CRC_32_RESULT_WIDTH - 1u)))
-            {
-                remainder = (remainder << 1u) ^ CRC_32_POLYNOMIAL;
-            }
-            else
-            {
-                remainder = (remainder << 1u);
-            }
-        }
+        Crc = CRC32Table[3][word & 0xFFu] ^ CRC32Table[2][(word >> 8u) & 0xFFu] ^
+              CRC32Table[1][(word >> 16u) & 0xFFu] ^ CRC32Table[0][word >> 24u];
+    }
+#endif
 
-        CRC32Table[dividend] = remainder;
+    /* Remaining bytes */
+    for(; byteIndex < Length; ++byteIndex)
+    {
+        Crc = CRC32Table[0][(Crc ^ Buffer[byteIndex]) & 0xFFu] ^ (Crc >> 8u);
     }
 #endif
+
+    return Crc;
 }
 
 
+#if (CRC_32_MODE == RUNTTIME)
 static uint8_t CRC_ReverseBitOrder8(uint8_t value)
 {
     value = (value & 0xF0) >> 4u | (value & 0x0F) << 4u;
@@ -336,3 +327,4 @@ static uint32_t CRC_ReverseBitOrder32(uint32_t value)
 
     return reversed;
 }
+#endif
@@ -30,6 +30,8 @@ extern "C" {
 #define RUNTTIME							0
 #define TABLE								1
 #define HARDWARE							2
+#define SLICE_4								3
+#define SLICE_8								4
 
 
 /* ---------- Defines for 8-bit SAE J1850 CRC calculation (Not reflected) ------------------------------------------------------- */
@@ -37,24 +39,44 @@ extern "C" {
 #define CRC_8_POLYNOMIAL                    0x1Du
 #define CRC_8_INIT_VALUE                    0xFFu
 #define CRC_8_XOR_VALUE                     0xFFu
+#ifndef CRC_8_MODE
 #define CRC_8_MODE							TABLE
+#endif
 
 /* ---------- Defines for 16-bit CCITT CRC calculation (Not reflected) ---------------------------------------------------------- */
 #define CRC_16_RESULT_WIDTH                 16u
 #define CRC_16_POLYNOMIAL                   0x1021u
 #define CRC_16_INIT_VALUE                   0xFFFFu
 #define CRC_16_XOR_VALUE                    0x0000u
-#define CRC_16_MODE							RUNTTIME
+#ifndef CRC_16_MODE
+#define CRC_16_MODE							TABLE
+#endif
 
 /* ---------- Defines for 32-bit CCITT CRC calculation (Reflected) -------------------------------------------------------------- */
 #define CRC_32_RESULT_WIDTH                 32u
 #define CRC_32_POLYNOMIAL                   0x04C11DB7u
+#define CRC_32_POLYNOMIAL_REFLECTED         0xEDB88320u
 #define CRC_32_INIT_VALUE                   0xFFFFFFFFu
 #define CRC_32_XOR_VALUE                    0xFFFFFFFFu
-#define CRC_32_MODE							RUNTTIME
+// HARDWARE uses the CRC unit of the STM32, which only supports this polynomial. It is not
+// reentrant, don't use it from interrupts. SLICE_4/SLICE_8 take 4/8 KB of flash.
+#ifndef CRC_32_MODE
+#define CRC_32_MODE							HARDWARE
+#endif
+
+#if (CRC_32_MODE == SLICE_8)
+  #define CRC_32_SLICES                     8
+#elif (CRC_32_MODE == SLICE_4)
+  #define CRC_32_SLICES                     4
+#else
+  #define CRC_32_SLICES                     1
+#endif
 
 
 
+/**
+ * Enables the CRC unit. Lookup tables are constant (CRC_Tables.h).
+ */
 void CRC_Init(void);
 
 /**
@@ -78,6 +100,15 @@ uint16_t CRC_CalculateCRC16(const uint8_t *Buffer, uint16_t Length);
  */
 uint32_t CRC_CalculateCRC32(const uint8_t *Buffer, uint16_t Length);
 
+/**
+ * Continues a CRC32 over several buffers. Start with Crc = 0, the result of
+ * CRC_UpdateCRC32(CRC_UpdateCRC32(0, a, n), b, m) equals the CRC32 of a and b in one buffer.
+ * Always in software, so it may be used for data larger than 64 KB and in any order.
+ *
+ * RETURN VALUE: 32 bit result of CRC calculation
+ */
+uint32_t CRC_UpdateCRC32(uint32_t Crc, const uint8_t *Buffer, uint16_t Length);
+
 
 #ifdef __cplusplus
 }
@@ -8,22 +8,313 @@
 #include "W5500.h"
 #include "socket.h"
 #include "System32.h"
+#include "Platform.h"
+#include "stm32f4xx_it.h"
+#include <string.h>
+
+
+// Events are also checked in this interval (ms), in case an edge got lost or INTn is not connected
+#ifndef W5500_POLL_INTERVAL
+    #define W5500_POLL_INTERVAL     100
+#endif
+
+
+// Responses are collected in a buffer and sent with a single SEND command, once
+// SERVER_TX_THRESHOLD bytes are staged or the oldest byte waited SERVER_TX_DEADLINE ms.
+#ifndef SERVER_TX_BUFFER_SIZE
+    #define SERVER_TX_BUFFER_SIZE   1024
+#endif
+#ifndef SERVER_TX_THRESHOLD
+    #define SERVER_TX_THRESHOLD     512
+#endif
+#ifndef SERVER_TX_DEADLINE
+    #define SERVER_TX_DEADLINE      2
+#endif
+
+#ifndef ETH_MAX_CLIENTS
+    #define ETH_MAX_CLIENTS         1
+#endif
+
+#define CLIENT_NONE                 0xFF
+
+
+typedef struct
+{
+    uint8_t Sock;
+    // Socket state as of last update
+    uint8_t State;
+    // Received data not read yet
+    uint8_t RxPending;
+    // SEND command issued, waiting for SEND_OK
+    uint8_t TxBusy;
+} Client_t;
+
+
+typedef struct
+{
+    uint8_t Data[SERVER_TX_BUFFER_SIZE];
+    uint16_t Len;
+    uint32_t First;
+} TxQueue_t;
+
+
+static uint8_t ServerTCP_Listen(uint8_t idx);
+static void ServerTCP_Close(uint8_t idx);
+static void ServerTCP_CheckClient(uint8_t idx);
+static void ServerTCP_DiscardInput(uint8_t idx);
+static uint8_t ServerTCP_Stage(TxQueue_t *q, uint8_t *data, uint16_t len);
+static uint8_t ServerTCP_Due(TxQueue_t *q, uint8_t force);
+static void ServerTCP_FlushOwner(uint8_t force);
+static void ServerTCP_FlushObservers(uint8_t force);
+static uint8_t ServerTCP_TxReady(Client_t *client);
 
 
 static uint8_t mSock = 0;
 static uint16_t mPort = 0;
 
+// Set by W5500 interrupt
+static volatile uint8_t IntPending = 1;
+static uint32_t LastCheck = 0;
+
+// One client owns the stream, all others are observers
+static Client_t Clients[ETH_MAX_CLIENTS];
+static uint8_t Owner = CLIENT_NONE;
+// Incremented whenever the owner changes
+static uint8_t Session = 0;
+// Status report requested by an observer
+static uint8_t StatusRequest = 0;
+// Observers waiting for that report (bit per client)
+static uint8_t ReplyTo = 0;
+
+// Everything for the owner
+static TxQueue_t OwnerTx;
+// Broadcasts, shared by all observers
+static TxQueue_t ObserverTx;
+
+
 uint8_t ServerTCP_Init(uint8_t sock, uint16_t port)
 {
+    uint8_t ret = 0;
+
     mSock = sock;
 	mPort = port;
+	Owner = CLIENT_NONE;
+	OwnerTx.Len = 0;
+	ObserverTx.Len = 0;
+
+	// All sockets listen on the same port, the W5500 hands each connection to a free one
+	for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        Clients[i].Sock = sock + i;
+        ret |= ServerTCP_Listen(i);
+    }
+
+	return ret;
+}
+
+
+void ServerTCP_DeInit(void)
+{
+    for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        ServerTCP_Close(i);
+    }
+}
+
+
+uint8_t ServerTCP_Send(uint8_t *data, uint16_t len)
+{
+	// Check if socket available
+	if(Owner == CLIENT_NONE)
+	{
+		return 2;
+	}
+
+	// Data is only staged here. Packets are never split, so the caller can retry later.
+	return ServerTCP_Stage(&OwnerTx, data, len);
+}
+
+
+uint8_t ServerTCP_Broadcast(uint8_t *data, uint16_t len)
+{
+    uint8_t observers = 0;
+
+    for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        if(i != Owner && Clients[i].State == SnSR_ESTABLISHED)
+        {
+            observers = 1;
+        }
+    }
+
+    if(observers)
+    {
+        // Observers must not stall the controller, drop data if they can't keep up
+        ServerTCP_Stage(&ObserverTx, data, len);
+        ReplyTo = 0;
+    }
+
+    return ServerTCP_Send(data, len);
+}
+
+
+uint8_t ServerTCP_Reply(uint8_t *data, uint16_t len)
+{
+    for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        Client_t *client = &Clients[i];
+
+        if(!(ReplyTo & (1 << i)) || i == Owner || client->State != SnSR_ESTABLISHED || !ServerTCP_TxReady(client))
+        {
+            continue;
+        }
+
+        if(W5500_GetTXFreeSize(client->Sock) >= len)
+        {
+            W5500_SendDataProcessing(client->Sock, data, len);
+            W5500_ExecCmdSn(client->Sock, Sock_SEND);
+            client->TxBusy = 1;
+        }
+    }
+
+    ReplyTo = 0;
+
+    return 0;
+}
+
+
+void ServerTCP_Flush(uint8_t force)
+{
+    ServerTCP_FlushOwner(force);
+    ServerTCP_FlushObservers(force);
+}
+
+
+void ServerTCP_DropOwner(void)
+{
+    uint8_t idx = Owner;
+
+    if(idx == CLIENT_NONE)
+    {
+        return;
+    }
+
+    ServerTCP_Close(idx);
+    ServerTCP_Listen(idx);
+}
+
+
+int32_t ServerTCP_Receive(uint8_t *data, uint16_t len)
+{
+    if(Owner == CLIENT_NONE)
+    {
+        return -1;
+    }
+
+	// Read data. Returns -1 if no data is available.
+	return recv(Clients[Owner].Sock, data, len);
+}
+
+
+uint16_t ServerTCP_DataAvailable(void)
+{
+    if(Owner == CLIENT_NONE || !Clients[Owner].RxPending)
+    {
+        return 0;
+    }
+
+    uint16_t len = W5500_GetRXReceivedSize(Clients[Owner].Sock);
+    if(len == 0)
+    {
+        // Everything read, wait for next RECV event
+        Clients[Owner].RxPending = 0;
+    }
+
+    return len;
+}
+
+
+uint8_t ServerTCP_GetSession(void)
+{
+    return Session;
+}
+
+
+uint8_t ServerTCP_StatusRequested(void)
+{
+    uint8_t ret = StatusRequest;
+
+    StatusRequest = 0;
+
+    return ret;
+}
+
+
+void ServerTCP_Interrupt(void)
+{
+    IntPending = 1;
+}
+
+
+void ServerTCP_Update(void)
+{
+    uint8_t poll = 0;
+
+    if(!IntPending)
+    {
+        if((millis() - LastCheck) < W5500_POLL_INTERVAL)
+        {
+            // No events, only send staged data
+            ServerTCP_Flush(0);
+            return;
+        }
+
+        poll = 1;
+    }
+
+    IntPending = 0;
+    LastCheck = millis();
+
+    // Only check sockets which signaled an event
+    uint8_t sir = W5500_READ_GP_REG8(REG8_SIR);
+
+    for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        if(poll || (sir & (1<<Clients[i].Sock)))
+        {
+            ServerTCP_CheckClient(i);
+        }
+    }
+
+    ServerTCP_Flush(0);
+
+    // INTn still active, another event occurred
+    if(GPIO_ReadInputDataBit(W5500_INT_PORT, W5500_INT_PIN) == Bit_RESET)
+    {
+        IntPending = 1;
+    }
+}
+
+
+static uint8_t ServerTCP_Listen(uint8_t idx)
+{
+    Client_t *client = &Clients[idx];
+
+    client->RxPending = 0;
+    client->TxBusy = 0;
+    client->State = W5500_READ_SOCK_REG8(client->Sock, REG8_SnSR);
 
 	// Check if socket is available
-	if(W5500_READ_SOCK_REG8(sock, REG8_SnSR) == SnSR_CLOSED)
+	if(client->State == SnSR_CLOSED)
 	{
 	    // Set socket to TCP listen mode
-		socket(sock, SnMR_TCP, port, 0);
-		listen(sock);
+		socket(client->Sock, SnMR_TCP, mPort, 0);
+		listen(client->Sock);
+
+		W5500_WRITE_SOCK_REG8(client->Sock, REG8_SnIMR, SnIR_CON | SnIR_RECV | SnIR_DISCON | SnIR_SEND_OK);
+		W5500_WRITE_GP_REG8(REG8_SIMR, W5500_READ_GP_REG8(REG8_SIMR) | (1<<client->Sock));
+
+		client->State = SnSR_LISTEN;
 
 		// OK
 		return 0;
@@ -34,8 +325,10 @@ uint8_t ServerTCP_Init(uint8_t sock, uint16_t port)
 }
 
 
-void ServerTCP_DeInit(uint8_t sock)
+static void ServerTCP_Close(uint8_t idx)
 {
+    uint8_t sock = Clients[idx].Sock;
+
 	// Release socket
 	disconnect(sock);
 
@@ -47,63 +340,228 @@ void ServerTCP_DeInit(uint8_t sock)
 		// Force release
 		close(sock);
 	}
+
+	if(idx == Owner)
+    {
+        // Drop everything belonging to the old connection
+        Owner = CLIENT_NONE;
+        OwnerTx.Len = 0;
+    }
+
+    Clients[idx].State = SnSR_CLOSED;
 }
 
 
-uint8_t ServerTCP_Send(uint8_t sock, uint8_t *data, uint16_t len)
+static void ServerTCP_CheckClient(uint8_t idx)
 {
-	// Check if socket available
-	if(W5500_READ_SOCK_REG8(sock, REG8_SnSR) == SnSR_ESTABLISHED)
-	{
-		// Send data
-		if(send(sock, data, len) <= 0)
-		{
-			return 1;
-		}
+    Client_t *client = &Clients[idx];
+    uint8_t last = client->State;
 
-		// OK
-		return 0;
+    // Read and clear socket events
+    uint8_t ir = W5500_READ_SOCK_REG8(client->Sock, REG8_SnIR);
+    if(ir)
+    {
+        W5500_WRITE_SOCK_REG8(client->Sock, REG8_SnIR, ir);
+    }
+
+    if(ir & SnIR_RECV)
+    {
+        client->RxPending = 1;
+    }
+
+    if(ir & SnIR_SEND_OK)
+    {
+        client->TxBusy = 0;
+    }
+
+    client->State = W5500_READ_SOCK_REG8(client->Sock, REG8_SnSR);
+
+    if(client->State == SnSR_ESTABLISHED)
+    {
+        if(last != SnSR_ESTABLISHED && Owner == CLIENT_NONE)
+        {
+            // First client gets the stream
+            Owner = idx;
+            OwnerTx.Len = 0;
+            Session++;
+        }
+
+        if(W5500_GetRXReceivedSize(client->Sock))
+        {
+            // Data received before interrupt was enabled
+            client->RxPending = 1;
+        }
+
+        if(idx != Owner && client->RxPending)
+        {
+            if(Owner == CLIENT_NONE)
+            {
+                // Stream is free, observer takes over
+                Owner = idx;
+                OwnerTx.Len = 0;
+                Session++;
+            }
+            else
+            {
+                ServerTCP_DiscardInput(idx);
+            }
+        }
+    }
+
+	// If socket is closed, reinitalize it.
+	if(client->State == SnSR_CLOSE_WAIT)
+	{
+		ServerTCP_Close(idx);
+		ServerTCP_Listen(idx);
 	}
 
-	return 2;
+	if(client->State == SnSR_CLOSED)
+    {
+        if(idx == Owner)
+        {
+            Owner = CLIENT_NONE;
+            OwnerTx.Len = 0;
+        }
+
+        ServerTCP_Listen(idx);
+    }
 }
 
 
-int32_t ServerTCP_Receive(uint8_t sock, uint8_t *data, uint16_t len)
+static void ServerTCP_DiscardInput(uint8_t idx)
 {
-	// Check if data is available
-	if(W5500_GetRXReceivedSize(sock))
+    uint8_t tmp[32];
+    int32_t len;
+
+    // Observers are read-only. Their input is dropped, but '?' is answered with a status report.
+    while((len = recv(Clients[idx].Sock, tmp, sizeof(tmp))) > 0)
+    {
+        if(memchr(tmp, '?', len))
+        {
+            StatusRequest = 1;
+            ReplyTo |= (1 << idx);
+        }
+    }
+
+    Clients[idx].RxPending = 0;
+}
+
+
+static uint8_t ServerTCP_Stage(TxQueue_t *q, uint8_t *data, uint16_t len)
+{
+	if(len > (SERVER_TX_BUFFER_SIZE - q->Len))
+	{
+		return 1;
+	}
+
+	if(q->Len == 0)
 	{
-		// Read data
-		return recv(sock, data, len);
+		q->First = millis();
 	}
 
-    // No data available
-	return -1;
+	memcpy(&q->Data[q->Len], data, len);
+	q->Len += len;
+
+	return 0;
 }
 
 
-uint16_t ServerTCP_DataAvailable(uint8_t sock)
+static uint8_t ServerTCP_Due(TxQueue_t *q, uint8_t force)
 {
-    return W5500_GetRXReceivedSize(sock);
+    if(q->Len == 0)
+    {
+        return 0;
+    }
+
+    return force || q->Len >= SERVER_TX_THRESHOLD || (millis() - q->First) >= SERVER_TX_DEADLINE;
 }
 
 
-void ServerTCP_Update(void)
+static void ServerTCP_FlushOwner(uint8_t force)
 {
-    // If socket is closed, reinitalize it.
-    uint8_t ret = 0;
+    if(Owner == CLIENT_NONE || !ServerTCP_Due(&OwnerTx, force) || !ServerTCP_TxReady(&Clients[Owner]))
+    {
+        return;
+    }
 
-    ret = W5500_READ_SOCK_REG8(mSock, REG8_SnSR);
+    uint8_t sock = Clients[Owner].Sock;
 
-	if(ret == SnSR_CLOSE_WAIT)
-	{
-		ServerTCP_DeInit(mSock);
-		ServerTCP_Init(mSock, mPort);
-	}
+    uint16_t len = W5500_GetTXFreeSize(sock);
+    if(len == 0)
+    {
+        // Socket buffer full, retry after next SEND_OK
+        return;
+    }
+    if(len > OwnerTx.Len)
+    {
+        len = OwnerTx.Len;
+    }
 
-	if(ret == SnSR_CLOSED)
+    W5500_SendDataProcessing(sock, OwnerTx.Data, len);
+    W5500_ExecCmdSn(sock, Sock_SEND);
+    Clients[Owner].TxBusy = 1;
+
+    // Keep remaining data for next SEND
+    OwnerTx.Len -= len;
+    if(OwnerTx.Len)
     {
-        ServerTCP_Init(mSock, mPort);
+        memmove(OwnerTx.Data, &OwnerTx.Data[len], OwnerTx.Len);
+        OwnerTx.First = millis();
     }
 }
+
+
+static void ServerTCP_FlushObservers(uint8_t force)
+{
+    if(!ServerTCP_Due(&ObserverTx, force))
+    {
+        return;
+    }
+
+    // Wait for previous SEND of all observers, unless the buffer runs full
+    if(ObserverTx.Len < SERVER_TX_THRESHOLD)
+    {
+        for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+        {
+            if(i != Owner && Clients[i].State == SnSR_ESTABLISHED && !ServerTCP_TxReady(&Clients[i]))
+            {
+                return;
+            }
+        }
+    }
+
+    // Same data goes to every observer. Slow ones miss it.
+    for(uint8_t i = 0; i < ETH_MAX_CLIENTS; i++)
+    {
+        Client_t *client = &Clients[i];
+
+        if(i == Owner || client->State != SnSR_ESTABLISHED || !ServerTCP_TxReady(client))
+        {
+            continue;
+        }
+
+        if(W5500_GetTXFreeSize(client->Sock) >= ObserverTx.Len)
+        {
+            W5500_SendDataProcessing(client->Sock, ObserverTx.Data, ObserverTx.Len);
+            W5500_ExecCmdSn(client->Sock, Sock_SEND);
+            client->TxBusy = 1;
+        }
+    }
+
+    ObserverTx.Len = 0;
+}
+
+
+static uint8_t ServerTCP_TxReady(Client_t *client)
+{
+#ifdef W5500_NO_INT
+    if(client->TxBusy && (W5500_READ_SOCK_REG8(client->Sock, REG8_SnIR) & SnIR_SEND_OK))
+    {
+        // No interrupt tells about it, don't wait for the next poll. Other events stay for ServerTCP_CheckClient().
+        W5500_WRITE_SOCK_REG8(client->Sock, REG8_SnIR, SnIR_SEND_OK);
+        client->TxBusy = 0;
+    }
+#endif
+
+    return !client->TxBusy;
+}
@@ -11,15 +11,70 @@
 #include <stdint.h>
 
 
+/**
+ * \brief   Opens ETH_MAX_CLIENTS sockets, starting at sock, which all listen on port.
+ *          The first client to connect owns the stream, further clients are read-only
+ *          observers. If the owner disconnects, the next observer to send data takes over.
+ * \return  0 on success, 1 if a socket is occupied
+ */
 uint8_t ServerTCP_Init(uint8_t sock, uint16_t port);
-void ServerTCP_DeInit(uint8_t sock);
+void ServerTCP_DeInit(void);
+
+/**
+ * \brief   Stages data for transmission to the stream owner. Never blocks, data is sent by
+ *          ServerTCP_Update().
+ * \return  0 on success, 1 if staging buffer is full, 2 if no client is connected
+ */
+uint8_t ServerTCP_Send(uint8_t *data, uint16_t len);
+
+/**
+ * \brief   Like ServerTCP_Send(), but data also goes to all observers. It is staged only
+ *          once for all of them and dropped, if they can't keep up.
+ * \return  Result of staging for the owner
+ */
+uint8_t ServerTCP_Broadcast(uint8_t *data, uint16_t len);
+
+/**
+ * \brief   Sends data only to the observers, which sent '?' since the last broadcast.
+ *          Observers, whose socket is still busy, miss it.
+ * \return  Always 0
+ */
+uint8_t ServerTCP_Reply(uint8_t *data, uint16_t len);
+
+/**
+ * \brief   Issues a SEND command for staged data, if none is in flight.
+ * \param   force   Send immediately instead of waiting for threshold or deadline
+ */
+void ServerTCP_Flush(uint8_t force);
+
+/**
+ * \brief   Closes the connection of the stream owner. Staged data for it is dropped, the
+ *          socket listens again.
+ */
+void ServerTCP_DropOwner(void);
+
+// Received data of stream owner
+int32_t ServerTCP_Receive(uint8_t *data, uint16_t len);
+uint16_t ServerTCP_DataAvailable(void);
 
-uint8_t ServerTCP_Send(uint8_t sock, uint8_t *data, uint16_t len);
-int32_t ServerTCP_Receive(uint8_t sock, uint8_t *data, uint16_t len);
+/**
+ * \brief   Returns a number, which changes whenever another client takes over the stream.
+ */
+uint8_t ServerTCP_GetSession(void);
 
-uint16_t ServerTCP_DataAvailable(uint8_t sock);
+/**
+ * \brief   Returns 1 once, if an observer sent '?'.
+ */
+uint8_t ServerTCP_StatusRequested(void);
 
+/**
+ * \brief   Services pending socket events. The SPI bus is only accessed, if the W5500
+ *          signaled an interrupt (or after W5500_POLL_INTERVAL as fallback).
+ */
 void ServerTCP_Update(void);
 
+// Called from EXTI interrupt of W5500 INTn pin
+void ServerTCP_Interrupt(void);
+
 
 #endif /* TCPSERVER_H_ */
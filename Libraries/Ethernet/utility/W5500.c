@@ -42,6 +42,7 @@ static inline uint16_t WriteSnArray(SOCKET _s, uint16_t _addr, uint8_t *_buf, ui
 void W5500_Init(void)
 {
     Spi_Init(SPI_W5500, SPI_MODE0);
+    Spi_InitDMA(SPI_W5500);
 
     // Set clock to 21 Mhz (W5500 should support up to about 80 Mhz)
     Spi_SetPrescaler(SPI_W5500, SPI_PRESCALER_2);
@@ -266,10 +267,8 @@ static inline uint16_t WriteArray(uint16_t _addr, uint8_t _cb, const uint8_t *_b
     Spi_WriteByte(SPI_W5500, _addr & 0xFF);
     Spi_WriteByte(SPI_W5500, _cb);
 
-    for(uint16_t i = 0; i < _len; i++)
-    {
-        Spi_WriteByte(SPI_W5500, _buf[i]);
-    }
+    // Burst transfer of data
+    Spi_TransferDMA(SPI_W5500, _buf, 0, _len);
 
     Spi_ChipSelect(SPI_W5500, false);
     __ASM("nop");
@@ -305,10 +304,8 @@ static inline uint16_t ReadArray(uint16_t _addr, uint8_t _cb, uint8_t *_buf, uin
     Spi_WriteByte(SPI_W5500, _addr & 0xFF);
     Spi_WriteByte(SPI_W5500, _cb);
 
-    for(uint16_t i = 0; i < _len; i++)
-    {
-        _buf[i] = Spi_ReadByte(SPI_W5500);
-    }
+    // Burst transfer of data
+    Spi_TransferDMA(SPI_W5500, 0, _buf, _len);
 
     Spi_ChipSelect(SPI_W5500, false);
     __ASM("nop");
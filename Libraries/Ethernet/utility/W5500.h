@@ -37,6 +37,8 @@
 #define REGN_SIPR_4         0x000F  // Source IP address
 #define REG8_IR             0x0015  // Interrupt
 #define REG8_IMR            0x0016  // Interrupt Mask
+#define REG8_SIR            0x0017  // Socket Interrupt
+#define REG8_SIMR           0x0018  // Socket Interrupt Mask
 #define REG16_RTR           0x0019  // Timeout address
 #define REG8_RCR            0x001B  // Retry count
 #define REGN_UIPR_4         0x0028  // Unreachable IP address in UDP mode
@@ -63,6 +65,7 @@
 #define REG16_SnRX_RSR      0x0026  // RX Free Size
 #define REG16_SnRX_RD       0x0028  // RX Read Pointer
 #define REG16_SnRX_WR       0x002A  // RX Write Pointer (supported?)
+#define REG8_SnIMR          0x002C  // Interrupt Mask
 
 
 #ifdef __cplusplus
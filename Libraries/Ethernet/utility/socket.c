@@ -203,7 +203,7 @@ int32_t send(SOCKET s, const uint8_t * buf, uint16_t len)
  */
 int32_t recv(SOCKET s, uint8_t *buf, int16_t len)
 {
-    uint16_t ret = 0;
+    int32_t ret = 0;
 
 
     if(s < MAX_SOCK_NUM)
@@ -20,49 +20,55 @@
 #include "Platform.h"
 #include "Print.h"
 #include "USART.h"
+#include "FIFO_USART.h"
+#include "util.h"
 #include <string.h>
 
 
 // Buffer size of interface
 #ifndef COMIF_BUFFER_SIZE
-    #define COMIF_BUFFER_SIZE       512
+    #define COMIF_BUFFER_SIZE       1024
 #endif
 
+// Minimum free space at end of buffer before it is compacted
 #define MAX_READ_SIZE               64
 
 
 static inline uint16_t BufferFreeBytes(void);
-static inline void BufferWriteByte(uint8_t data);
-static inline uint8_t BufferReadByte(void);
+static inline void BufferCompact(void);
+static void ComIf_Read(uint8_t move);
 
 
+// Linear receive buffer. Unread data is RxBuffer[Tail..Head). Data is always contiguous,
+// so packets can be parsed in place.
 static uint8_t RxBuffer[COMIF_BUFFER_SIZE] = {0};
-static uint16_t Head = 0, Tail = 0, Size = 0;
+static uint16_t Head = 0, Tail = 0;
 
-static uint8_t Socket = 0;
 static uint8_t Interface = IF_USB;
+// Session of data in buffer
+static uint8_t Session = 0;
+static uint8_t NewSession = 0;
 
 
-void ComIf_Init(uint8_t interface, uint8_t sock)
+void ComIf_Init(uint8_t interface)
 {
-    Head = 0, Tail = 0, Size = 0;
+    Head = 0, Tail = 0;
     memset(RxBuffer, 0, COMIF_BUFFER_SIZE);
-    Socket = sock;
     Interface = interface;
 }
 
 
 void ComIf_DeInit(void)
 {
-    ComIf_Init(Interface, 0);
+    ComIf_Init(Interface);
 }
 
 
 uint8_t ComIf_Send(uint8_t *data, uint16_t len)
 {
-    if(Interface == IF_ETH)
+    if(Interface != IF_USB)
     {
-        return ServerTCP_Send(Socket, data, len);
+        return ServerTCP_Send(data, len);
     }
     else
     {
@@ -73,6 +79,51 @@ uint8_t ComIf_Send(uint8_t *data, uint16_t len)
 }
 
 
+uint8_t ComIf_Broadcast(uint8_t *data, uint16_t len)
+{
+    if(Interface != IF_USB)
+    {
+        return ServerTCP_Broadcast(data, len);
+    }
+
+    return ComIf_Send(data, len);
+}
+
+
+uint8_t ComIf_Reply(uint8_t *data, uint16_t len)
+{
+    if(Interface != IF_USB)
+    {
+        return ServerTCP_Reply(data, len);
+    }
+
+    // Serial has no observers
+    (void)data;
+    (void)len;
+
+    return 0;
+}
+
+
+void ComIf_Disconnect(void)
+{
+    if(Interface != IF_USB)
+    {
+        ServerTCP_DropOwner();
+    }
+}
+
+
+void ComIf_Flush(void)
+{
+    if(Interface != IF_USB)
+    {
+        ServerTCP_Update();
+        ServerTCP_Flush(1);
+    }
+}
+
+
 uint16_t ComIf_Receive(uint8_t *data, uint16_t len)
 {
     // Check if data available
@@ -84,10 +135,8 @@ uint16_t ComIf_Receive(uint8_t *data, uint16_t len)
             len = rec;
         }
 
-        for(uint16_t i = 0; i < len; i++)
-        {
-            data[i] = BufferReadByte();
-        }
+        memcpy(data, &RxBuffer[Tail], len);
+        ComIf_Consume(len);
 
         return len;
     }
@@ -97,19 +146,91 @@ uint16_t ComIf_Receive(uint8_t *data, uint16_t len)
 }
 
 
+uint16_t ComIf_Peek(uint8_t **data)
+{
+    *data = &RxBuffer[Tail];
+
+    return ComIf_DataAvailable();
+}
+
+
+void ComIf_Consume(uint16_t len)
+{
+    if(len > ComIf_DataAvailable())
+    {
+        len = ComIf_DataAvailable();
+    }
+
+    Tail += len;
+
+    if(Tail == Head)
+    {
+        // Buffer empty, start over
+        Head = 0;
+        Tail = 0;
+    }
+}
+
+
 uint16_t ComIf_DataAvailable(void)
 {
     return (COMIF_BUFFER_SIZE - BufferFreeBytes());
 }
 
 
+uint8_t ComIf_NewSession(void)
+{
+    uint8_t ret = NewSession;
+
+    NewSession = 0;
+
+    return ret;
+}
+
+
+uint16_t ComIf_FreeSpace(void)
+{
+    if(Interface == IF_USB)
+    {
+        // Serial has no flow control of its own: Bytes not fitting into the usart fifo get lost.
+        // While a packet is held, the buffer isn't compacted, so only the space behind Head counts.
+        uint32_t space = FifoUsart_Available(STDOUT_NUM) + (COMIF_BUFFER_SIZE - Head);
+
+        return (uint16_t)min(space, BufferFreeBytes());
+    }
+
+    return BufferFreeBytes();
+}
+
+
 void ComIf_Update(void)
 {
-    uint8_t ret = 0;
+    if(Interface != IF_USB && ServerTCP_GetSession() != Session)
+    {
+        // Another client took over, drop what's left of the old one
+        Session = ServerTCP_GetSession();
+        NewSession = 1;
+        Head = 0;
+        Tail = 0;
+    }
+
+    ComIf_Read(1);
+}
+
+
+void ComIf_Append(void)
+{
+    ComIf_Read(0);
+}
+
+
+static void ComIf_Read(uint8_t move)
+{
+    uint16_t ret = 0;
 
-    if(Interface == IF_ETH)
+    if(Interface != IF_USB)
     {
-        ret = ServerTCP_DataAvailable(Socket);
+        ret = ServerTCP_DataAvailable();
     }
     else
     {
@@ -117,76 +238,63 @@ void ComIf_Update(void)
         ret = 1;
     }
 
-    if(ret && (MAX_READ_SIZE <= BufferFreeBytes()))
+    if(ret == 0)
+    {
+        return;
+    }
+
+    // Not enough space at end of buffer, move unread data to the front
+    if(move && (COMIF_BUFFER_SIZE - Head) < MAX_READ_SIZE)
     {
-        uint8_t buf[MAX_READ_SIZE];
+        BufferCompact();
+    }
 
-        // Read max 64 bytes
-        if(ret > MAX_READ_SIZE)
-        {
-            ret = MAX_READ_SIZE;
-        }
+    uint16_t space = COMIF_BUFFER_SIZE - Head;
+    if(space == 0)
+    {
+        // Buffer full
+        return;
+    }
 
-        if(Interface == IF_ETH)
+    if(Interface != IF_USB)
+    {
+        if(ret > space)
         {
-            // Read max 64 bytes from TCP socket and write it into buffer
-            uint8_t read = ServerTCP_Receive(Socket, buf, ret);
-
-            for(uint8_t i = 0; i < read; i++)
-            {
-                BufferWriteByte(buf[i]);
-            }
+            ret = space;
         }
-        else
+
+        // Read directly from TCP socket into buffer
+        int32_t read = ServerTCP_Receive(&RxBuffer[Head], ret);
+        if(read > 0)
         {
-            // Read max 64 bytes from usart buffer
-            for(uint16_t read = 0; read < MAX_READ_SIZE; read++)
-            {
-                char c;
-                if(Getc(&c) == 0)
-                {
-                    BufferWriteByte((uint8_t)c);
-                }
-                else
-                {
-                    break;
-                }
-            }
+            Head += read;
         }
     }
-}
-
-
-static inline void BufferWriteByte(uint8_t data)
-{
-    if(Size > (COMIF_BUFFER_SIZE-1))
+    else
     {
-        // Queue full
-        return;
-    }
+        // Read from usart buffer
+        char c;
 
-    RxBuffer[Head] = data;
-    Head = (Head + 1) % COMIF_BUFFER_SIZE;
-    Size++;
+        while(Head < COMIF_BUFFER_SIZE && Getc(&c) == 0)
+        {
+            RxBuffer[Head++] = (uint8_t)c;
+        }
+    }
 }
 
 
-static inline uint8_t BufferReadByte(void)
+static inline void BufferCompact(void)
 {
-    uint8_t ret = 0;
-
-    if(Size)
+    if(Tail > 0)
     {
-        ret = RxBuffer[Tail];
-        Tail = (Tail + 1) % COMIF_BUFFER_SIZE;
-        Size--;
+        memmove(RxBuffer, &RxBuffer[Tail], Head - Tail);
+        Head -= Tail;
+        Tail = 0;
     }
-
-    return ret;
 }
 
 
 static inline uint16_t BufferFreeBytes(void)
 {
-    return (COMIF_BUFFER_SIZE - Size);
+    return (COMIF_BUFFER_SIZE - (Head - Tail));
 }
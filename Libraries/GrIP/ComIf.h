@@ -24,6 +24,8 @@
 
 #define IF_USB          0
 #define IF_ETH          1
+// TCP without GrIP framing (plain Grbl text)
+#define IF_ETH_RAW      2
 
 
 #ifdef __cplusplus
@@ -34,11 +36,11 @@ extern "C" {
 
 /** \brief Initialize communication interface.
  *
- * \param sock Socket number of TCP server.
+ * \param interface IF_USB, IF_ETH or IF_ETH_RAW.
  * \return None.
  *
  */
-void ComIf_Init(uint8_t interface, uint8_t sock);
+void ComIf_Init(uint8_t interface);
 
 /** \brief Deinitalize communication interface.
  *
@@ -52,11 +54,43 @@ void ComIf_DeInit(void);
  *
  * \param data Data array to transmit.
  * \param len Length of data array in bytes.
- * \return 0 if success.
+ * \return 0 if success, 1 if transmit buffer is full, 2 if interface is not connected.
  *
  */
 uint8_t ComIf_Send(uint8_t *data, uint16_t len);
 
+/** \brief Transmit data to all connected clients. Only the stream owner is guaranteed to receive it.
+ *
+ * \param data Data array to transmit.
+ * \param len Length of data array in bytes.
+ * \return Same as ComIf_Send().
+ *
+ */
+uint8_t ComIf_Broadcast(uint8_t *data, uint16_t len);
+
+/** \brief Transmit data only to the observers, which requested a status report. Not to the stream owner.
+ *
+ * \param data Data array to transmit.
+ * \param len Length of data array in bytes.
+ * \return Always 0. Observers, which can't take the data right now, miss it.
+ *
+ */
+uint8_t ComIf_Reply(uint8_t *data, uint16_t len);
+
+/** \brief Close the connection of the stream owner, e.g. if it stopped reading. Nothing on serial.
+ *
+ * \return None.
+ *
+ */
+void ComIf_Disconnect(void);
+
+/** \brief Push buffered transmit data to the hardware interface without waiting for the flush deadline.
+ *
+ * \return None.
+ *
+ */
+void ComIf_Flush(void);
+
 /** \brief Get data from communication interface.
  *
  * \param data Pointer where to store the data.
@@ -66,6 +100,22 @@ uint8_t ComIf_Send(uint8_t *data, uint16_t len);
  */
 uint16_t ComIf_Receive(uint8_t *data, uint16_t len);
 
+/** \brief Get pointer to received data without copying it. Data stays in the buffer until it is consumed.
+ *
+ * \param data Set to start of unread data.
+ * \return Number of contiguous bytes available.
+ *
+ */
+uint16_t ComIf_Peek(uint8_t **data);
+
+/** \brief Remove data from buffer. Pointers returned by ComIf_Peek() become invalid with the next ComIf_Update().
+ *
+ * \param len Number of bytes to remove.
+ * \return None.
+ *
+ */
+void ComIf_Consume(uint16_t len);
+
 /** \brief Return if data is available.
  *
  * \return Number of bytes available.
@@ -73,6 +123,13 @@ uint16_t ComIf_Receive(uint8_t *data, uint16_t len);
  */
 uint16_t ComIf_DataAvailable(void);
 
+/** \brief Returns 1 once after another client took over the connection. Buffered data was discarded.
+ *
+ * \return 1 if new session started.
+ *
+ */
+uint8_t ComIf_NewSession(void);
+
 /** \brief Cyclic update function. Gets data from hardware interface and stores it in internal buffer. Should be called periodically.
  *
  * \return None.
@@ -80,6 +137,20 @@ uint16_t ComIf_DataAvailable(void);
  */
 void ComIf_Update(void);
 
+/** \brief Like ComIf_Update(), but buffered data is never moved. Pointers returned by ComIf_Peek() stay valid.
+ *
+ * \return None.
+ *
+ */
+void ComIf_Append(void);
+
+/** \brief Return free space in receive buffer. On serial, also bounded by the usart fifo.
+ *
+ * \return Number of bytes, which can still be received without loss.
+ *
+ */
+uint16_t ComIf_FreeSpace(void);
+
 
 #ifdef __cplusplus
 }
@@ -24,46 +24,88 @@
 #include <string.h>
 
 
-// GrIP states
-#define GRIP_IDLE               0
-#define GRIP_RX_HEADER          1
-#define GRIP_RX_DATA            2
-
 // Magic byte - Marks start of transmission
 #define MAGIC                   0x55
 
 // Size of header packet
 #define GRIP_HEADER_SIZE        (sizeof(GrIP_PacketHeader_t))
 
+// Packets with GRIP_VERSION_CRC32 carry a CRC32 of the payload behind it (big endian)
+#define GRIP_CRC32_SIZE         4
+
+// Receivers of a packet
+#define DEST_OWNER              0
+#define DEST_ALL                1
+#define DEST_REQUESTER          2
+
+
+// Windowed transfer of MSG_DATA and MSG_MOTION packets:
+// The host numbers MSG_DATA packets with Counter and may have up to GRIP_WINDOW_SIZE packets
+// in flight, as long as their payload fits into the advertised credits. Each delivered packet
+// is acknowledged with a MSG_RESPONSE (RET_OK, Counter of packet, credits as 16 bit payload).
+// A packet received ahead of a lost one is held and the missing one is requested with RET_NOK,
+// a corrupt one with RET_WRONG_CRC. Only the requested packet has to be sent again.
+typedef struct
+{
+    uint8_t Used;
+    GrIP_PacketHeader_t Header;
+    uint8_t Data[GRIP_BUFFER_SIZE];
+} GrIP_Slot_t;
+
 
 static uint8_t CheckHeader(GrIP_PacketHeader_t *paket);
+static uint8_t CheckSequence(GrIP_PacketHeader_t *header, uint8_t *data);
+static void GrIP_SendAck(uint8_t ReturnCode, uint8_t Counter);
+static void GrIP_ResetWindow(void);
+static uint16_t ParsePacket(uint8_t *buf, uint16_t avail, GrIP_PacketHeader_t *header);
+static void ScanRealtime(void);
+static void GrIP_Consume(uint16_t len);
+static void UpdateRaw(void);
+static uint8_t GrIP_Send(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data, uint8_t dest);
+static uint8_t GrIP_Output(uint8_t *data, uint16_t len, uint8_t dest);
+static uint16_t BuildPacket(uint8_t *buf, GrIP_PacketHeader_t *header, const uint8_t *data, uint16_t len);
+static uint8_t CheckCRC(GrIP_PacketHeader_t *header, uint8_t *data);
+static uint16_t TrailerSize(GrIP_PacketHeader_t *header);
 
 
 static GrIP_PacketHeader_t TX_Header;
 
 // Transmit Buffer
-static uint8_t TX_Buffer[GRIP_BUFFER_SIZE + GRIP_HEADER_SIZE];
-// Receive Data Array
-static RX_Packet_t RX_Buff[GRIP_RX_NUM] = {0};
+static uint8_t TX_Buffer[1 + GRIP_HEADER_SIZE + GRIP_BUFFER_SIZE + GRIP_CRC32_SIZE];
+// Received packet. Payload is parsed in place in the interface buffer.
+static RX_Packet_t RX_Packet = {0};
 
-static uint8_t GrIP_Status = GRIP_IDLE;
 static uint8_t GrIP_Response = RESPONSE_OK;
-static uint8_t GrIP_idx = 0;
 
-
-void GrIP_Init(void)
+// Packets received out of order
+static GrIP_Slot_t Window[GRIP_WINDOW_SIZE];
+// Counter of next MSG_DATA packet
+static uint8_t RxExpected = 0;
+// First MSG_DATA packet of a connection sets the counter
+static uint8_t RxSynced = 0;
+static GrIP_Credits_t GrIP_Credits = 0;
+static GrIP_Realtime_t GrIP_Realtime = 0;
+// No framing, data is plain text
+static uint8_t Raw = 0;
+// Bytes at start of interface buffer, which were already checked for realtime packets
+static uint16_t Scanned = 0;
+// Host requested CRC32 for this session (GRIP_SYS_CRC32)
+static uint8_t Crc32 = 0;
+
+
+void GrIP_Init(uint8_t interface)
 {
     // Initialize to default values
-    GrIP_Status = GRIP_IDLE;
-    GrIP_idx = 0;
-
     memset(&TX_Header, 0, GRIP_HEADER_SIZE);
 
-    memset(TX_Buffer, 0, GRIP_BUFFER_SIZE + GRIP_HEADER_SIZE);
-    memset(RX_Buff, 0, sizeof(RX_Buff));
+    memset(TX_Buffer, 0, sizeof(TX_Buffer));
+    memset(&RX_Packet, 0, sizeof(RX_Packet));
+    GrIP_ResetWindow();
+    Crc32 = 0;
 
     // Init generic interface
-    ComIf_Init(IF_ETH, 0);
+    ComIf_Init(interface);
+    Raw = (interface == IF_ETH_RAW);
     // Init CRC module
     CRC_Init();
 }
@@ -71,6 +113,37 @@ void GrIP_Init(void)
 
 uint8_t GrIP_Transmit(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data)
 {
+    return GrIP_Send(MsgType, ReturnCode, data, DEST_OWNER);
+}
+
+
+uint8_t GrIP_Broadcast(uint8_t MsgType, Pdu_t *data)
+{
+    return GrIP_Send(MsgType, 0, data, DEST_ALL);
+}
+
+
+uint8_t GrIP_Reply(uint8_t MsgType, Pdu_t *data)
+{
+    return GrIP_Send(MsgType, 0, data, DEST_REQUESTER);
+}
+
+
+static uint8_t GrIP_Send(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data, uint8_t dest)
+{
+    if(Raw)
+    {
+        uint8_t ret = 0;
+
+        // Payload only
+        if(data && data->Length)
+        {
+            ret = GrIP_Output(data->Data, data->Length, dest);
+        }
+
+        return (ret == 1) ? RET_BUSY : (ret ? RET_NOK : RET_OK);
+    }
+
     // Prepare header
     TX_Header.Version = GRIP_VERSION;
     TX_Header.MsgType = MsgType;
@@ -78,32 +151,25 @@ uint8_t GrIP_Transmit(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data)
 
     if(data)
     {
-        // Convert length to network order
-        TX_Header.Length = htons(data->Length);
-
         // Check if data fits into transmit buffer
         if(data->Length > GRIP_BUFFER_SIZE)
         {
             return RET_NOK;
         }
-        else if(data->Length > 0)
-        {
-            // Calculate CRC of data
-            TX_Header.CRC8 = CRC_CalculateCRC8(data->Data, data->Length);
-        }
-        else
-        {
-            // No data, no CRC
-            TX_Header.CRC8 = 0;
-        }
 
         // Prepare transmit buffer
-        TX_Buffer[0] = MAGIC;
-        memcpy(&TX_Buffer[1], &TX_Header, GRIP_HEADER_SIZE);
-        memcpy(&TX_Buffer[1] + GRIP_HEADER_SIZE, data->Data, data->Length);
+        uint16_t size = BuildPacket(TX_Buffer, &TX_Header, data->Data, data->Length);
 
         // Transmit paket
-        ComIf_Send(TX_Buffer, data->Length + GRIP_HEADER_SIZE + 1);
+        uint8_t ret = GrIP_Output(TX_Buffer, size, dest);
+        if(ret == 1)
+        {
+            return RET_BUSY;
+        }
+        else if(ret)
+        {
+            return RET_NOK;
+        }
 
         // Check if we are expecting a response
         GrIP_Response = RESPONSE_OK;
@@ -138,20 +204,11 @@ uint8_t GrIP_Transmit(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data)
 
 uint8_t GrIP_Receive(RX_Packet_t *pData)
 {
-    if(pData)
+    if(pData && RX_Packet.isValid)
     {
-        for(uint8_t i = 0; i < GRIP_RX_NUM; i++)
-        {
-            if(RX_Buff[i].isValid)
-            {
-                memcpy(pData, &RX_Buff[i], sizeof(RX_Packet_t));
-
-                // Clear rx slot
-                memset(&RX_Buff[i], 0, sizeof(RX_Packet_t));
+        *pData = RX_Packet;
 
-                return 1;
-            }
-        }
+        return 1;
     }
 
     // No data available
@@ -159,6 +216,42 @@ uint8_t GrIP_Receive(RX_Packet_t *pData)
 }
 
 
+void GrIP_Release(void)
+{
+    if(RX_Packet.isValid)
+    {
+        if(RX_Packet.Slot != GRIP_NO_SLOT)
+        {
+            Window[RX_Packet.Slot].Used = 0;
+        }
+        else
+        {
+            // Remove packet from interface buffer
+            GrIP_Consume((Raw ? 0 : 1 + GRIP_HEADER_SIZE + TrailerSize(&RX_Packet.RX_Header)) + RX_Packet.RX_Header.Length);
+        }
+
+        if(GRIP_SEQUENCED(RX_Packet.RX_Header.MsgType))
+        {
+            GrIP_SendAck(RET_OK, RxExpected++);
+        }
+
+        RX_Packet.isValid = 0;
+    }
+}
+
+
+void GrIP_SetCreditCallback(GrIP_Credits_t callback)
+{
+    GrIP_Credits = callback;
+}
+
+
+void GrIP_SetRealtimeCallback(GrIP_Realtime_t callback)
+{
+    GrIP_Realtime = callback;
+}
+
+
 uint8_t GrIP_ResponseStatus(void)
 {
     return GrIP_Response;
@@ -167,115 +260,318 @@ uint8_t GrIP_ResponseStatus(void)
 
 void GrIP_Update(void)
 {
-    switch(GrIP_Status)
+    uint8_t *buf = 0;
+    uint16_t avail = 0;
+    GrIP_PacketHeader_t header;
+
+    if(Raw)
     {
-    case GRIP_IDLE:
-        // Check if data is available
-        if(ComIf_DataAvailable())
-        {
-            uint8_t magic = 0;
+        UpdateRaw();
+        return;
+    }
 
-            // Read Magic byte
-            ComIf_Receive(&magic, 1);
+    // Packet not released yet. Data must not be moved.
+    if(RX_Packet.isValid)
+    {
+        // Realtime commands must not wait behind it
+        ScanRealtime();
+        return;
+    }
 
-            if(magic == MAGIC)
-            {
-                // Received valid packet
-                GrIP_Status = GRIP_RX_HEADER;
-            }
-        }
-        break;
+    // Next packet was already received out of order
+    GrIP_Slot_t *slot = &Window[RxExpected % GRIP_WINDOW_SIZE];
+    if(RxSynced && slot->Used && slot->Header.Counter == RxExpected)
+    {
+        RX_Packet.RX_Header = slot->Header;
+        RX_Packet.Data = slot->Data;
+        RX_Packet.Slot = RxExpected % GRIP_WINDOW_SIZE;
+        RX_Packet.isValid = 1;
 
-    case GRIP_RX_HEADER:
-        // Check if header is available
-        if(ComIf_DataAvailable() > (GRIP_HEADER_SIZE-1))
-        {
-            uint8_t head_buff[GRIP_HEADER_SIZE] = {0};
+        return;
+    }
 
-            // Get header
-            ComIf_Receive(head_buff, GRIP_HEADER_SIZE);
+    // Check for new data
+    ComIf_Update();
 
-            // Fill struct
-            memcpy(&RX_Buff[GrIP_idx].RX_Header, head_buff, GRIP_HEADER_SIZE);
+    if(ComIf_NewSession())
+    {
+        // New client, counter and CRC mode start over
+        GrIP_ResetWindow();
+        Scanned = 0;
+        Crc32 = 0;
+    }
 
-            // Convert length to host order
-            RX_Buff[GrIP_idx].RX_Header.Length = ntohs(RX_Buff[GrIP_idx].RX_Header.Length);
+    avail = ComIf_Peek(&buf);
 
-            // Check if header is valid
-            uint8_t ret = CheckHeader(&RX_Buff[GrIP_idx].RX_Header);
-            if(ret != RET_OK)
-            {
-                // Header is invalid
-                GrIP_Status = GRIP_IDLE;
-                //Printf("Wrong header: %d\n", ret);
-                break;
-            }
-            if(RX_Buff[GrIP_idx].RX_Header.Length > GRIP_BUFFER_SIZE)
-            {
-                // Payload too big
-                GrIP_Status = GRIP_IDLE;
-                //Printf("Payload exceeds limit: %d\n", RX_Buff[GrIP_idx].RX_Header.Length);
-                break;
-            }
+    while(avail)
+    {
+        uint16_t size = ParsePacket(buf, avail, &header);
+
+        if(size == 0)
+        {
+            // Wait for more data
+            break;
+        }
+
+        if(size == 1)
+        {
+            // Search for start of packet
+            GrIP_Consume(1);
+            buf++;
+            avail--;
+            continue;
+        }
 
-            // If payload is available
-            if(RX_Buff[GrIP_idx].RX_Header.Length)
+        uint8_t *data = &buf[1 + GRIP_HEADER_SIZE];
+        uint8_t deliver = 1;
+
+        if(!CheckCRC(&header, data))
+        {
+            if(GRIP_SEQUENCED(header.MsgType))
             {
-                // Payload is available
-                GrIP_Status = GRIP_RX_DATA;
+                // Request packet again
+                GrIP_SendAck(RET_WRONG_CRC, header.Counter);
             }
-            else
+
+            // Drop packet
+            deliver = 0;
+        }
+        else if(header.MsgType == MSG_REALTIME_CMD && GrIP_Realtime)
+        {
+            // Not executed yet, if it wasn't found ahead of a held packet
+            if(size > Scanned)
             {
-                // No payload
-                GrIP_Status = GRIP_IDLE;
-
-                RX_Buff[GrIP_idx].isValid = 1;
-
-                if(GrIP_idx < (GRIP_RX_NUM-1))
-                {
-                    GrIP_idx++;
-                }
-                else
-                {
-                    GrIP_idx = 0;
-                }
+                GrIP_Realtime(data, header.Length);
             }
+            deliver = 0;
+        }
+        else if(header.MsgType == MSG_SYSTEM_CMD && header.Length == 1 &&
+                (data[0] == GRIP_SYS_CRC8 || data[0] == GRIP_SYS_CRC32))
+        {
+            // Acknowledged in the old format, everything after it is sent in the new one
+            GrIP_SendAck(RET_OK, header.Counter);
+            Crc32 = (data[0] == GRIP_SYS_CRC32);
+            deliver = 0;
+        }
+        else if(GRIP_SEQUENCED(header.MsgType) && !CheckSequence(&header, data))
+        {
+            // Duplicate or held in window
+            deliver = 0;
+        }
+
+        if(!deliver)
+        {
+            GrIP_Consume(size);
+            buf += size;
+            avail -= size;
+            continue;
+        }
+
+        RX_Packet.RX_Header = header;
+        RX_Packet.Data = data;
+        RX_Packet.Slot = GRIP_NO_SLOT;
+        RX_Packet.isValid = 1;
+
+        if(Scanned < size)
+        {
+            Scanned = size;
         }
         break;
+    }
+}
+
+
+// Returns size of packet at start of buf, 1 if there is no valid packet or 0 if it is incomplete
+static uint16_t ParsePacket(uint8_t *buf, uint16_t avail, GrIP_PacketHeader_t *header)
+{
+    if(buf[0] != MAGIC)
+    {
+        return 1;
+    }
+
+    // Wait for header
+    if(avail < (1 + GRIP_HEADER_SIZE))
+    {
+        return 0;
+    }
+
+    memcpy(header, &buf[1], GRIP_HEADER_SIZE);
+
+    // Convert length to host order
+    header->Length = ntohs(header->Length);
 
-    case GRIP_RX_DATA:
-        // Check if entire payload is available
-        if(ComIf_DataAvailable() > (RX_Buff[GrIP_idx].RX_Header.Length-1))
+    // Check if header is valid
+    if(CheckHeader(header) != RET_OK || header->Length > GRIP_BUFFER_SIZE)
+    {
+        // Header is invalid, resync on next byte
+        return 1;
+    }
+
+    // Wait for entire payload
+    uint16_t size = 1 + GRIP_HEADER_SIZE + header->Length + TrailerSize(header);
+
+    if(avail < size)
+    {
+        return 0;
+    }
+
+    return size;
+}
+
+
+// Returns packet size. Version and checksum depend on the CRC mode of the session.
+static uint16_t BuildPacket(uint8_t *buf, GrIP_PacketHeader_t *header, const uint8_t *data, uint16_t len)
+{
+    header->Length = htons(len);
+
+    buf[0] = MAGIC;
+    memcpy(&buf[1 + GRIP_HEADER_SIZE], data, len);
+
+    if(Crc32)
+    {
+        uint32_t crc = CRC_CalculateCRC32(data, len);
+
+        header->Version = GRIP_VERSION_CRC32;
+        header->CRC8 = 0;
+
+        buf[1 + GRIP_HEADER_SIZE + len] = crc >> 24;
+        buf[2 + GRIP_HEADER_SIZE + len] = (crc >> 16) & 0xFF;
+        buf[3 + GRIP_HEADER_SIZE + len] = (crc >> 8) & 0xFF;
+        buf[4 + GRIP_HEADER_SIZE + len] = crc & 0xFF;
+    }
+    else
+    {
+        header->Version = GRIP_VERSION;
+        // No data, no CRC
+        header->CRC8 = len ? CRC_CalculateCRC8(data, len) : 0;
+    }
+
+    memcpy(&buf[1], header, GRIP_HEADER_SIZE);
+
+    return 1 + GRIP_HEADER_SIZE + len + (Crc32 ? GRIP_CRC32_SIZE : 0);
+}
+
+
+// Checks the payload against CRC8 of the header or the CRC32 behind the payload
+static uint8_t CheckCRC(GrIP_PacketHeader_t *header, uint8_t *data)
+{
+    if(header->Version == GRIP_VERSION_CRC32)
+    {
+        uint8_t *crc = &data[header->Length];
+
+        return CRC_CalculateCRC32(data, header->Length) ==
+               (((uint32_t)crc[0] << 24) | ((uint32_t)crc[1] << 16) | ((uint32_t)crc[2] << 8) | crc[3]);
+    }
+
+    return header->Length == 0 || header->CRC8 == CRC_CalculateCRC8(data, header->Length);
+}
+
+
+static uint16_t TrailerSize(GrIP_PacketHeader_t *header)
+{
+    return (header->Version == GRIP_VERSION_CRC32) ? GRIP_CRC32_SIZE : 0;
+}
+
+
+// Executes realtime packets received after the held packet. Scanned counts the bytes at the
+// start of the interface buffer, which were already checked.
+static void ScanRealtime(void)
+{
+    uint8_t *buf = 0;
+    uint16_t avail = 0;
+    GrIP_PacketHeader_t header;
+
+    if(!GrIP_Realtime)
+    {
+        return;
+    }
+
+    ComIf_Append();
+    avail = ComIf_Peek(&buf);
+
+    while(Scanned < avail)
+    {
+        uint16_t size = ParsePacket(&buf[Scanned], avail - Scanned, &header);
+
+        if(size == 0)
+        {
+            break;
+        }
+
+        if(size > 1 && header.MsgType == MSG_REALTIME_CMD)
         {
-            // Get payload
-            //GenIf_Receive(RX_Buffer, RX_Header.Length);
-            ComIf_Receive(RX_Buff[GrIP_idx].Data, RX_Buff[GrIP_idx].RX_Header.Length);
-            if(RX_Buff[GrIP_idx].RX_Header.CRC8 == CRC_CalculateCRC8(RX_Buff[GrIP_idx].Data, RX_Buff[GrIP_idx].RX_Header.Length))
+            uint8_t *data = &buf[Scanned + 1 + GRIP_HEADER_SIZE];
+
+            if(CheckCRC(&header, data))
             {
-                RX_Buff[GrIP_idx].isValid = 1;
-
-                if(GrIP_idx < (GRIP_RX_NUM-1))
-                {
-                    GrIP_idx++;
-                }
-                else
-                {
-                    GrIP_idx = 0;
-                }
+                GrIP_Realtime(data, header.Length);
             }
-            GrIP_Status = GRIP_IDLE;
         }
-        break;
+
+        Scanned += size;
     }
+}
 
-    // Check for new data
-    ComIf_Update();
+
+// Without framing, everything received is returned as one data packet. Realtime commands
+// are passed to the callback once, when they arrive. It removes them from the stream.
+static void UpdateRaw(void)
+{
+    uint8_t *buf = 0;
+    uint16_t avail = 0;
+
+    if(RX_Packet.isValid)
+    {
+        // Don't move held data
+        ComIf_Append();
+    }
+    else
+    {
+        ComIf_Update();
+
+        if(ComIf_NewSession())
+        {
+            Scanned = 0;
+        }
+    }
+
+    avail = ComIf_Peek(&buf);
+
+    if(avail > Scanned)
+    {
+        if(GrIP_Realtime)
+        {
+            GrIP_Realtime(&buf[Scanned], avail - Scanned);
+        }
+        Scanned = avail;
+    }
+
+    if(!RX_Packet.isValid && avail)
+    {
+        RX_Packet.RX_Header.Version = GRIP_VERSION;
+        RX_Packet.RX_Header.MsgType = MSG_DATA_NO_RESPONSE;
+        RX_Packet.RX_Header.ReturnCode = 0;
+        RX_Packet.RX_Header.Length = avail;
+        RX_Packet.RX_Header.CRC8 = 0;
+        RX_Packet.RX_Header.Counter = 0;
+        RX_Packet.Data = buf;
+        RX_Packet.Slot = GRIP_NO_SLOT;
+        RX_Packet.isValid = 1;
+    }
+}
+
+
+static void GrIP_Consume(uint16_t len)
+{
+    ComIf_Consume(len);
+
+    Scanned = (Scanned > len) ? (Scanned - len) : 0;
 }
 
 
 static uint8_t CheckHeader(GrIP_PacketHeader_t *paket)
 {
-    if(paket->Version != GRIP_VERSION)
+    if(paket->Version != GRIP_VERSION && paket->Version != GRIP_VERSION_CRC32)
     {
         // Wrong version
         return RET_WRONG_VERSION;
@@ -290,3 +586,92 @@ static uint8_t CheckHeader(GrIP_PacketHeader_t *paket)
     // Everything OK
     return RET_OK;
 }
+
+
+// Returns 1, if packet is the next one in sequence
+static uint8_t CheckSequence(GrIP_PacketHeader_t *header, uint8_t *data)
+{
+    if(!RxSynced)
+    {
+        RxExpected = header->Counter;
+        RxSynced = 1;
+    }
+
+    uint8_t diff = header->Counter - RxExpected;
+
+    if(diff == 0)
+    {
+        return 1;
+    }
+
+    if(diff < GRIP_WINDOW_SIZE)
+    {
+        // Ahead of a lost packet, keep it until the gap is filled
+        GrIP_Slot_t *slot = &Window[header->Counter % GRIP_WINDOW_SIZE];
+
+        if(!slot->Used)
+        {
+            slot->Header = *header;
+            memcpy(slot->Data, data, header->Length);
+            slot->Used = 1;
+        }
+
+        GrIP_SendAck(RET_NOK, RxExpected);
+    }
+    else if(diff >= 0x80)
+    {
+        // Already delivered, acknowledge got lost
+        GrIP_SendAck(RET_OK, RxExpected - 1);
+    }
+
+    // Outside of window: Drop
+
+    return 0;
+}
+
+
+static uint8_t GrIP_Output(uint8_t *data, uint16_t len, uint8_t dest)
+{
+    switch(dest)
+    {
+    case DEST_ALL:
+        return ComIf_Broadcast(data, len);
+
+    case DEST_REQUESTER:
+        return ComIf_Reply(data, len);
+
+    default:
+        return ComIf_Send(data, len);
+    }
+}
+
+
+static void GrIP_SendAck(uint8_t ReturnCode, uint8_t Counter)
+{
+    uint8_t ack[1 + GRIP_HEADER_SIZE + 2 + GRIP_CRC32_SIZE];
+    uint8_t payload[2];
+    GrIP_PacketHeader_t header;
+    uint16_t credits = GrIP_Credits ? GrIP_Credits() : ComIf_FreeSpace();
+
+    header.MsgType = MSG_RESPONSE;
+    header.ReturnCode = ReturnCode;
+    header.Counter = Counter;
+
+    payload[0] = credits >> 8;
+    payload[1] = credits & 0xFF;
+
+    // If the acknowledge gets lost, the host retransmits and gets it again
+    ComIf_Send(ack, BuildPacket(ack, &header, payload, 2));
+}
+
+
+static void GrIP_ResetWindow(void)
+{
+    for(uint8_t i = 0; i < GRIP_WINDOW_SIZE; i++)
+    {
+        Window[i].Used = 0;
+    }
+
+    RxExpected = 0;
+    RxSynced = 0;
+}
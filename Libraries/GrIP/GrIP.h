@@ -24,10 +24,15 @@
 
 // Current protocol version
 #define GRIP_VERSION            1
+// Same header, payload is followed by a CRC32 (big endian). CRC8 field is 0.
+#define GRIP_VERSION_CRC32      2
 
 // Transmit/Receive buffer size - Do not exceed (GRIP_BUFFER_SIZE - 10)
 #define GRIP_BUFFER_SIZE        256
-#define GRIP_RX_NUM             3
+
+// Max number of MSG_DATA packets in flight. Packets received ahead of a lost one are held
+// until it is retransmitted, each one takes GRIP_BUFFER_SIZE bytes of RAM.
+#define GRIP_WINDOW_SIZE        4
 
 
 
@@ -49,9 +54,23 @@ typedef enum
     MSG_NOTIFICATION        = 4,
     MSG_RESPONSE            = 5,
     MSG_ERROR               = 6,
-    MSG_MAX_NUM             = 7
+    MSG_MOTION              = 7,
+    MSG_MAX_NUM             = 8
 } MessageType_e;
 
+// MSG_MOTION carries pre-parsed binary motion commands instead of text (see MotionStream.h).
+// Numbered, windowed and acknowledged like MSG_DATA.
+#define GRIP_SEQUENCED(type)    ((type) == MSG_DATA || (type) == MSG_MOTION)
+
+
+/**
+  * Payload of MSG_SYSTEM_CMD packets, which are handled by GrIP.
+  * A packet with one of these bytes selects the checksum for the rest of the session.
+  * It is acknowledged with MSG_RESPONSE/RET_OK in the old format.
+  */
+#define GRIP_SYS_CRC8           0x00
+#define GRIP_SYS_CRC32          0x01
+
 
 /**
   * Return Types.
@@ -65,7 +84,8 @@ typedef enum
     RET_WRONG_CRC           = 3,
     RET_WRONG_MAGIC         = 4,
     RET_WRONG_PARAM         = 5,
-    RET_WRONG_TYPE          = 6
+    RET_WRONG_TYPE          = 6,
+    RET_BUSY                = 7
 } ReturnType_e;
 
 
@@ -99,14 +119,31 @@ typedef struct
 
 /**
   * GrIP Receive Packet
+  * Data points into the receive buffer of the interface.
   */
 typedef struct
 {
     GrIP_PacketHeader_t RX_Header;
     uint8_t isValid;
-    uint8_t Data[GRIP_BUFFER_SIZE];
+    uint8_t *Data;
+    // Index of reorder slot holding the payload or GRIP_NO_SLOT
+    uint8_t Slot;
 } RX_Packet_t;
 
+#define GRIP_NO_SLOT            0xFF
+
+
+/**
+  * Returns how many payload bytes the receiver can accept. Advertised with every acknowledge.
+  * Defaults to the free space of the interface buffer.
+  */
+typedef uint16_t (*GrIP_Credits_t)(void);
+
+/**
+  * Executes the payload of a MSG_REALTIME_CMD packet.
+  */
+typedef void (*GrIP_Realtime_t)(uint8_t *data, uint16_t len);
+
 
 /**
   * Data struct.
@@ -121,25 +158,53 @@ typedef struct
 
 
 /**
-  * Initialize the module
+  * Initialize the module on IF_USB, IF_ETH or IF_ETH_RAW.
+  * On IF_ETH_RAW, received data is returned as MSG_DATA_NO_RESPONSE packets as it arrives,
+  * realtime commands are passed to the realtime callback and transmitted data is sent without header.
   */
-void GrIP_Init(void);
+void GrIP_Init(uint8_t interface);
 
 /**
-  * Transmit a message over GrIP
+  * Transmit a message over GrIP. Returns RET_BUSY if the interface can't take the packet right now.
   */
 uint8_t GrIP_Transmit(uint8_t MsgType, uint8_t ReturnCode, Pdu_t *data);
 
+/**
+  * Transmit a message to all connected clients (status, notifications)
+  */
+uint8_t GrIP_Broadcast(uint8_t MsgType, Pdu_t *data);
+
+/**
+  * Transmit a message only to the observers, which requested a status report
+  */
+uint8_t GrIP_Reply(uint8_t MsgType, Pdu_t *data);
+
 /**
   * Returns the current response state
   */
 uint8_t GrIP_ResponseStatus(void);
 
 /**
-  * Get data if available
+  * Get data if available. The payload is not copied and stays valid until GrIP_Release() is called.
   */
 uint8_t GrIP_Receive(RX_Packet_t *pData);
 
+/**
+  * Releases the packet returned by GrIP_Receive(). MSG_DATA packets are acknowledged here.
+  */
+void GrIP_Release(void);
+
+/**
+  * Sets the function, which returns the free space of the receiver
+  */
+void GrIP_SetCreditCallback(GrIP_Credits_t callback);
+
+/**
+  * Sets the function, which executes realtime packets. They are never returned by GrIP_Receive(),
+  * but executed as soon as they arrive, even while a data packet is held.
+  */
+void GrIP_SetRealtimeCallback(GrIP_Realtime_t callback);
+
 /**
   * Continuously call this function to process RX messages
   */
@@ -4,6 +4,7 @@
 #include "stm32f4xx_i2c.h"
 #include "stm32f4xx_gpio.h"
 #include "stm32f4xx_it.h"
+#include <string.h>
 
 
 #define I2C_SPEED               200000
@@ -21,12 +22,38 @@
 
 #define M24C0X_PAGE_SIZE        16
 
+// Size of the EEPROM (M24C08: 1KB). Max 64 pages.
+#ifndef M24C0X_SIZE
+    #define M24C0X_SIZE         1024
+#endif
+
+// Attempts of a page write, before it is reported as failed
+#define M24C0X_WRITE_RETRIES    3
+
 #define WP_DISABLE              0
 #define WP_ENABLE               1
 
 
 
+// Contents of the EEPROM. Reads are served from here, writes mark pages to be written in background.
+static uint8_t Mirror[M24C0X_SIZE];
+static uint8_t MirrorValid = 0;
+
+static volatile uint64_t PagesDirty = 0;
+// Pages, which failed M24C0X_WRITE_RETRIES times. Retried with the next write.
+static volatile uint64_t PagesFailed = 0;
+static volatile uint8_t FailCount = 0;
+// Pages in the I2C queue, in order of submission. 0xFF is the final ACK poll.
+static volatile uint8_t InFlight[I2C_QUEUE_SIZE];
+static volatile uint8_t InFlightHead = 0;
+static volatile uint8_t InFlightCount = 0;
+static volatile uint8_t PollNeeded = 0;
+static volatile uint8_t WriteError = 0;
+
+
 static inline void M24C0X_WriteProtection(uint8_t enable);
+static void M24C0X_Pump(void);
+static void M24C0X_WriteDone(uint8_t status);
 
 
 
@@ -49,121 +76,205 @@ void M24C0X_Init(void)
 
     I2C_Mode_t mode = {I2C_SPEED, I2C_Mode_I2C, I2C_Ack_Enable};
     I2C_Initialize(M24C0X_I2C, &mode);
+
+    // Read whole EEPROM once. Upper address bits (A8, A9, A10) are coded into slave address.
+    MirrorValid = 1;
+
+    for(uint16_t addr = 0; addr < M24C0X_SIZE; addr += 256)
+    {
+        uint16_t len = (M24C0X_SIZE - addr) < 256 ? (M24C0X_SIZE - addr) : 256;
+
+        if(I2C_ReadByteArray(M24C0X_I2C, M24C0X_ADDRESS | (0x07 & (addr>>8)), addr, &Mirror[addr], len))
+        {
+            MirrorValid = 0;
+        }
+    }
 }
 
 
 uint8_t M24C0X_ReadByte(uint16_t addr)
 {
-    uint8_t slave_adr = M24C0X_ADDRESS;
-
-    if(addr > UINT8_MAX)
+    if(addr >= M24C0X_SIZE)
     {
-        // If address is bigger than 255 (8 Bit), upper address bits (A8, A9, A10) are coded into slave address (up to 2KB, bigger EEPROMs use 2 Bytes for addressing)
-        slave_adr |=  0x07 & (addr>>8);
+        return 0xFF;
     }
 
-    return I2C_ReadByte(M24C0X_I2C, slave_adr, addr);
+    return Mirror[addr];
 }
 
 
 uint8_t M24C0X_WriteByte(uint16_t addr, uint8_t data)
 {
-    uint8_t slave_adr = M24C0X_ADDRESS;
+    return M24C0X_WriteByteArray(addr, &data, 1);
+}
+
 
-    if(addr > UINT8_MAX)
+uint8_t M24C0X_ReadByteArray(uint16_t addr, uint8_t *pData, uint16_t len)
+{
+    if(!MirrorValid || addr + len > M24C0X_SIZE)
     {
-        // If address is bigger than 255 (8 Bit), upper address bits (A8, A9, A10) are coded into slave address (up to 2KB, bigger EEPROMs use 2 Bytes for addressing)
-        slave_adr |=  0x07 & (addr>>8);
+        return 0;
     }
 
-    M24C0X_WriteProtection(WP_DISABLE);
-    uint8_t ret = I2C_WriteByte(M24C0X_I2C, slave_adr, addr, data);
-    M24C0X_WriteProtection(WP_ENABLE);
+    memcpy(pData, &Mirror[addr], len);
 
-    Delay_ms(5);
-
-    return ret;
+    return 1;
 }
 
 
-uint8_t M24C0X_ReadByteArray(uint16_t addr, uint8_t *pData, uint16_t len)
+uint8_t M24C0X_WriteByteArray(uint16_t addr, uint8_t *pData, uint16_t len)
 {
-    uint8_t slave_adr = M24C0X_ADDRESS;
+    if(addr + len > M24C0X_SIZE)
+    {
+        return 1;
+    }
+    if(len == 0)
+    {
+        return 0;
+    }
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
 
-    if(addr > UINT8_MAX)
+    PagesDirty |= PagesFailed;
+    PagesFailed = 0;
+
+    // Changed pages only. A page already in the queue is written again.
+    for(uint16_t i = 0; i < len; i++)
     {
-        // If address is bigger than 255 (8 Bit), upper address bits (A8, A9, A10) are coded into slave address (up to 2KB, bigger EEPROMs use 2 Bytes for addressing)
-        slave_adr |=  0x07 & (addr>>8);
+        if(Mirror[addr+i] != pData[i])
+        {
+            Mirror[addr+i] = pData[i];
+            PagesDirty |= (1ULL << ((addr+i) / M24C0X_PAGE_SIZE));
+        }
     }
 
-    I2C_ReadByteArray(M24C0X_I2C, slave_adr, addr, pData, len);
-    return 1;
+    M24C0X_Pump();
+
+    __set_PRIMASK(primask);
+
+    return 0;
 }
 
 
-uint8_t M24C0X_WriteByteArray(uint16_t addr, uint8_t *pData, uint16_t len)
+uint8_t M24C0X_WriteBlocking(uint16_t addr, uint16_t len)
 {
-    uint8_t ret = 0;
-    uint8_t bytes2write = len;
-    uint16_t remainingBytes = len;
-    uint16_t bytesWritten = 0;
-    uint8_t timeout = 0;
+    (void)addr;
+    (void)len;
 
-    uint8_t slave_adr = M24C0X_ADDRESS;
+    // Writes only update the mirror. Pages are transferred by interrupt as the queue drains.
+    return 0;
+}
+
+
+uint8_t M24C0X_WriteFailed(void)
+{
+    uint8_t failed = WriteError;
 
+    WriteError = 0;
 
-    // Disable write protection
-    M24C0X_WriteProtection(WP_DISABLE);
+    return failed;
+}
+
+
+// Queues dirty pages while there is room, followed by an ACK poll. Called with interrupts
+// disabled or from interrupt context.
+static void M24C0X_Pump(void)
+{
+    I2C_Request_t req;
 
-    while(remainingBytes)
+    while(I2C_QueueFree(M24C0X_I2C) > 0)
     {
-        bytes2write = remainingBytes;
+        uint8_t page = 0xFF;
 
-        if(addr > UINT8_MAX)
+        if(PagesDirty)
         {
-            // If address is bigger than 255 (8 Bit), upper address bits (A8, A9, A10) are coded into slave address (up to 2KB, bigger EEPROMs use 2 Bytes for addressing)
-            slave_adr |=  0x07 & (addr>>8);
+            // Keep one entry for the final poll
+            if(I2C_QueueFree(M24C0X_I2C) < 2)
+            {
+                break;
+            }
+
+            page = __builtin_ctzll(PagesDirty);
+            PagesDirty &= ~(1ULL << page);
+
+            uint16_t addr = page * M24C0X_PAGE_SIZE;
+
+            req.Type = I2C_REQ_WRITE;
+            // Upper address bits (A8, A9, A10) are coded into slave address
+            req.SlaveAddr = M24C0X_ADDRESS | (0x07 & (addr>>8));
+            req.RegAddr = addr & 0xFF;
+            req.Len = M24C0X_PAGE_SIZE;
+            memcpy(req.Data, &Mirror[addr], M24C0X_PAGE_SIZE);
+
+            if(InFlightCount == 0)
+            {
+                M24C0X_WriteProtection(WP_DISABLE);
+            }
+            PollNeeded = 1;
         }
-
-        // We can write max M24C0X_PAGE_SIZE bytes per write
-        if(bytes2write > M24C0X_PAGE_SIZE)
+        else if(PollNeeded)
         {
-            bytes2write = M24C0X_PAGE_SIZE;
+            // Finished when EEPROM acknowledges again after last write cycle.
+            // Page write cycle (up to 5ms) of the other pages is detected by ACK polling of the next request.
+            req.Type = I2C_REQ_POLL;
+            req.SlaveAddr = M24C0X_ADDRESS;
+            req.Len = 0;
+            PollNeeded = 0;
         }
-
-        // Check if page write is aligned
-        if(((addr %  M24C0X_PAGE_SIZE) + bytes2write) > M24C0X_PAGE_SIZE)
+        else
         {
-            bytes2write = M24C0X_PAGE_SIZE - (addr %  M24C0X_PAGE_SIZE);
+            break;
         }
 
-        // If eeprom is busy (write takes up to 5ms), try again until success or timeout
-        while((ret = I2C_WriteByteArray(M24C0X_I2C, slave_adr, addr, &pData[bytesWritten], bytes2write)) && (timeout < 4))
-        {
-            Delay_ms(2);
-            timeout++;
-        }
+        req.Callback = M24C0X_WriteDone;
+        I2C_Submit(M24C0X_I2C, &req);
 
-        if(timeout >= 4)
-        {
-            // Failed to write
-            return 1;
-        }
+        InFlight[(InFlightHead + InFlightCount) % I2C_QUEUE_SIZE] = page;
+        InFlightCount++;
+    }
+}
 
-        // Reset timeout
-        timeout = 0;
 
-        remainingBytes -= bytes2write;
-        bytesWritten += bytes2write;
-        addr += bytes2write;
+static void M24C0X_WriteDone(uint8_t status)
+{
+    uint8_t page = InFlight[InFlightHead];
 
-        Delay_ms(5);
+    InFlightHead = (InFlightHead + 1) % I2C_QUEUE_SIZE;
+    InFlightCount--;
+
+    if(status == 0)
+    {
+        if(page != 0xFF)
+        {
+            FailCount = 0;
+        }
+    }
+    else if(page != 0xFF)
+    {
+        if(++FailCount < M24C0X_WRITE_RETRIES)
+        {
+            PagesDirty |= (1ULL << page);
+        }
+        else
+        {
+            // Reported by M24C0X_WriteFailed()
+            PagesFailed |= (1ULL << page);
+            WriteError = 1;
+        }
+    }
+    else
+    {
+        // Last write cycle didn't finish
+        WriteError = 1;
     }
 
-    // Enable write protection
-    M24C0X_WriteProtection(WP_ENABLE);
+    if(InFlightCount == 0 && !PagesDirty && !PollNeeded)
+    {
+        M24C0X_WriteProtection(WP_ENABLE);
+    }
 
-    return 0;
+    M24C0X_Pump();
 }
 
 
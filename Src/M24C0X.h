@@ -15,9 +15,17 @@ void M24C0X_Init(void);
 uint8_t M24C0X_ReadByte(uint16_t addr);
 uint8_t M24C0X_WriteByte(uint16_t addr, uint8_t data);
 
+// Reads are served from a RAM copy of the EEPROM, which is read once by M24C0X_Init()
 uint8_t M24C0X_ReadByteArray(uint16_t addr, uint8_t *pData, uint16_t len);
+// Updates the RAM copy. Changed pages are written in background by interrupt, never waits.
 uint8_t M24C0X_WriteByteArray(uint16_t addr, uint8_t *pData, uint16_t len);
 
+// Always 0, see M24C0X_WriteByteArray()
+uint8_t M24C0X_WriteBlocking(uint16_t addr, uint16_t len);
+
+// Returns 1 once, if a page write failed since the last call
+uint8_t M24C0X_WriteFailed(void);
+
 
 #ifdef __cplusplus
 }
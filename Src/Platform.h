@@ -12,6 +12,15 @@
 //---- SPI ----//
 #define SPI_W5500			SPI3
 
+// W5500 interrupt output (INTn), active low. Uses EXTI line 4.
+#define W5500_INT_PORT		GPIOC
+#define W5500_INT_PIN		GPIO_Pin_4
+#define W5500_INT_EXTI_PORT	EXTI_PortSourceGPIOC
+#define W5500_INT_EXTI_PIN	EXTI_PinSource4
+// Uncomment, if INTn is not connected. SEND_OK is then read from the socket before each send,
+// instead of waiting for the next poll (W5500_POLL_INTERVAL).
+//#define W5500_NO_INT
+
 
 //---- USART ----//
 // Number of used USARTs on this device
@@ -27,6 +36,17 @@
 #define STDOUT_NUM			USART2_NUM
 //#define STDOUT_BAUD			115200
 
+// RTS/CTS flow control for STDOUT, needed above 230400 baud. RTS (output) goes high when the
+// receive buffer runs full. Output stalls while CTS (input, pulled low) is high. The hardware
+// pins of USART2 (PA0/PA1) are used by the control inputs, so this is done by software.
+//#define USART_FLOW_CONTROL
+#define USART_RTS_PORT		GPIOC
+#define USART_RTS_PIN		GPIO_Pin_2
+#define USART_CTS_PORT		GPIOC
+#define USART_CTS_PIN		GPIO_Pin_3
+// Time [ms] output waits for CTS, before it's sent anyway
+#define USART_CTS_TIMEOUT	100
+
 
 //---- Defines ----//
 
@@ -41,6 +61,13 @@
 
 #define ETH_SOCK            0
 #define ETH_PORT            30501
+// Exchange plain Grbl text over TCP (like telnet) instead of GrIP packets
+//#define ETH_RAW
+// Number of simultaneous clients (sockets ETH_SOCK...). First one streams, others observe.
+#define ETH_MAX_CLIENTS     3
+// Serial and TCP run side by side. The interface, which sent the last g-code line, owns the
+// stream. The other one may take over after the owner was silent for this time [ms] while idle.
+#define STREAM_LOCK_TIME    1000
 
 
 #endif /* PLATFORM_H_INCLUDED */
@@ -7,19 +7,55 @@
 #include "USART.h"
 #include "FIFO_USART.h"
 #include "Settings.h"
+#include "System.h"
+#include "Protocol.h"
 #include "GrIP.h"
+#include "ComIf.h"
 #include "Platform.h"
+#include "stm32f4xx_it.h"
 
 
 #define MAX_BUFFER_SIZE     128
 
+// Time [ms] a response waits for a peer, which doesn't read, before its connection is dropped
+#define PRINT_TX_TIMEOUT    5000
+
 
 char buf[512] = {0};
 uint16_t buf_idx = 0;
 
+// Serial link uses GrIP framing. Changes are applied after the next output, so the
+// response to the switching command is still sent in the old format.
+static uint8_t serial_grip = 0;
+static uint8_t serial_grip_next = 0;
+
+// Interfaces, which get responses. Set to origin of the line being executed.
+static uint8_t print_target = PRINT_ALL;
+// Interfaces, which requested a status report
+static volatile uint8_t report_target = 0;
+
+// Serial baud rate. A new rate is applied after the response to the switching command and
+// falls back to the old one, if the host doesn't confirm it in time.
+static const uint32_t baud_rates[] = {115200, 230400, 460800, 921600, 1000000, 1500000, 2000000};
+static uint32_t baud_rate = BAUD_RATE;
+static uint32_t baud_next = 0;
+static uint32_t baud_fallback = 0;
+static uint32_t baud_time = 0;
+
+// Output can't be throttled without flow control, faster rates overrun the host
+#ifdef USART_FLOW_CONTROL
+    #define BAUD_LIMIT      BAUD_RATE_MAX
+#else
+    #define BAUD_LIMIT      (BAUD_RATE_MAX < 230400 ? BAUD_RATE_MAX : 230400)
+#endif
+
 
 void Print_Init(void)
 {
+	baud_rate = BAUD_RATE;
+	baud_next = 0;
+	baud_fallback = 0;
+
 	Usart_Init(STDOUT, BAUD_RATE);
 }
 
@@ -71,22 +107,235 @@ int Putc(const char c)
 }
 
 
-void Print_Flush(void)
+static void Print_WaitGrIP(Pdu_t *data)
+{
+    char pending[sizeof(buf)];
+    uint16_t len = buf_idx;
+    uint32_t start = millis();
+
+    // Realtime processing may print, keep this response apart meanwhile
+    memcpy(pending, buf, len);
+    data->Data = (uint8_t*)pending;
+    buf_idx = 0;
+
+    do
+    {
+        // Keep the stepper fed and execute feed hold and reset. Only feeds the stepper,
+        // if this output comes from the realtime processing itself.
+        Protocol_ExecRtSystem();
+
+        if(sys.abort || (millis() - start) > PRINT_TX_TIMEOUT)
+        {
+            // Peer stopped reading. Dropping it also ends a zero window.
+            if(!sys.abort)
+            {
+                ComIf_Disconnect();
+            }
+            break;
+        }
+
+        ComIf_Flush();
+    } while(GrIP_Transmit(MSG_DATA_NO_RESPONSE, 0, data) == RET_BUSY);
+
+    memcpy(buf, pending, len);
+    buf_idx = len;
+}
+
+
+static void Print_TransmitGrIP(uint8_t critical, uint8_t broadcast)
 {
-#ifdef ETH_IF
     Pdu_t data;
+    uint8_t ret;
 
     data.Data = (uint8_t*)buf;
     data.Length = buf_idx;
 
-    uint8_t ret = GrIP_Transmit(MSG_DATA_NO_RESPONSE, 0, &data);
-    (void)ret;  // TODO: Handle transmit error
+    if(broadcast)
+    {
+        ret = GrIP_Broadcast(MSG_DATA_NO_RESPONSE, &data);
+    }
+    else
+    {
+        ret = GrIP_Transmit(MSG_DATA_NO_RESPONSE, 0, &data);
+    }
+
+    // Responses must not get lost, wait until the socket accepts them.
+    // Observers already got their copy, retry only for the stream owner.
+    if(critical && ret == RET_BUSY)
+    {
+        Print_WaitGrIP(&data);
+    }
+}
+
+
+static void Print_Transmit(uint8_t critical, uint8_t broadcast, uint8_t target)
+{
+#ifdef ETH_IF
+    // GrIP runs on TCP, serial link is always text
+    if(target & PRINT_ETH)
+    {
+        Print_TransmitGrIP(critical, broadcast);
+    }
+    else if(target & PRINT_OBSERVER)
+    {
+        // Status report only for the observers, which asked for it
+        Pdu_t data;
+
+        data.Data = (uint8_t*)buf;
+        data.Length = buf_idx;
+
+        GrIP_Reply(MSG_DATA_NO_RESPONSE, &data);
+    }
+    if(target & PRINT_SERIAL)
+    {
+        Usart_Write(STDOUT, false, buf, buf_idx);
+    }
 #else
-    Usart_Write(STDOUT, false, buf, buf_idx);
+    (void)target;
+
+    if(serial_grip)
+    {
+        Print_TransmitGrIP(critical, broadcast);
+    }
+    else
+    {
+        Usart_Write(STDOUT, false, buf, buf_idx);
+    }
 #endif
 
     memset(buf, 0, 512);
     buf_idx = 0;
+
+    serial_grip = serial_grip_next;
+
+    if(baud_next)
+    {
+        Usart_SetBaud(STDOUT, baud_next);
+
+        baud_fallback = baud_rate;
+        baud_rate = baud_next;
+        baud_time = millis();
+        baud_next = 0;
+    }
+}
+
+
+void Print_Flush(void)
+{
+    Print_Transmit(1, 0, print_target);
+}
+
+
+void Print_FlushReport(void)
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    // Status goes to whoever asked for it
+    uint8_t target = report_target ? report_target : PRINT_ALL;
+    report_target = 0;
+
+    __set_PRIMASK(primask);
+
+    Print_Transmit(0, 1, target);
+}
+
+
+void Print_FlushNotify(void)
+{
+    Print_Transmit(1, 1, PRINT_ALL);
+}
+
+
+void Print_Drain(void)
+{
+#ifdef ETH_IF
+    ComIf_Flush();
+#endif
+}
+
+
+void Print_SetTarget(uint8_t target)
+{
+    print_target = target;
+}
+
+
+uint8_t Print_GetTarget(void)
+{
+    return print_target;
+}
+
+
+void Print_RequestReport(uint8_t origin)
+{
+    report_target |= origin;
+}
+
+
+void Print_SetGrIP(uint8_t enable)
+{
+    serial_grip_next = enable;
+}
+
+
+uint8_t Print_SerialGrIP(void)
+{
+    return serial_grip;
+}
+
+
+uint8_t Print_SetBaud(uint32_t baud)
+{
+    for(uint8_t i = 0; i < sizeof(baud_rates)/sizeof(baud_rates[0]); i++)
+    {
+        if(baud_rates[i] == baud && baud <= BAUD_LIMIT)
+        {
+            baud_next = baud;
+
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+
+uint32_t Print_GetBaud(void)
+{
+    return baud_rate;
+}
+
+
+void Print_ConfirmBaud(void)
+{
+    baud_fallback = 0;
+}
+
+
+void Print_CheckBaud(void)
+{
+    if(baud_fallback && (millis() - baud_time) > BAUD_CONFIRM_TIME)
+    {
+        // Host didn't get through at new rate
+        Usart_SetBaud(STDOUT, baud_fallback);
+
+        baud_rate = baud_fallback;
+        baud_fallback = 0;
+    }
+}
+
+
+void Print_ReportBaudRates(void)
+{
+    Printf("[BAUD:%lu|", (unsigned long)baud_rate);
+
+    for(uint8_t i = 0; i < sizeof(baud_rates)/sizeof(baud_rates[0]) && baud_rates[i] <= BAUD_LIMIT; i++)
+    {
+        Printf(i ? ",%lu" : "%lu", (unsigned long)baud_rates[i]);
+    }
+
+    Printf("]\r\n");
 }
 
 
@@ -7,6 +7,14 @@ extern "C" {
 #endif
 
 
+// Output targets
+#define PRINT_SERIAL        0x01
+#define PRINT_ETH           0x02
+#define PRINT_ALL           (PRINT_SERIAL | PRINT_ETH)
+// Observer connections, which requested a status report. Only used for reports.
+#define PRINT_OBSERVER      0x04
+
+
 void Print_Init(void);
 int Printf(const char *str, ...);
 void PrintFloat(float n, uint8_t decimal_places);
@@ -14,6 +22,35 @@ int8_t Getc(char *c);
 int Putc(const char c);
 
 void Print_Flush(void);
+// Like Print_Flush(), but the output is dropped if the interface is congested.
+// Used for periodic reports, the next one supersedes it anyway.
+// Reports also go to observer connections.
+void Print_FlushReport(void);
+// Like Print_Flush(), but the output also goes to observer connections (alarms, messages).
+void Print_FlushNotify(void);
+// Pushes output, which is still staged for TCP, out now. Serial output is always sent right away.
+void Print_Drain(void);
+
+// Sends output of Print_Flush() only to target (PRINT_SERIAL, PRINT_ETH or PRINT_ALL)
+void Print_SetTarget(uint8_t target);
+uint8_t Print_GetTarget(void);
+// Next status report also goes to origin. May be called from interrupt.
+void Print_RequestReport(uint8_t origin);
+
+// Switches serial link between text and GrIP framing. Takes effect after the next flush.
+void Print_SetGrIP(uint8_t enable);
+// Serial link uses GrIP framing. Input is not checked for realtime commands then.
+uint8_t Print_SerialGrIP(void);
+
+// Switches serial baud rate after the next flush. Returns 1, if rate is not supported.
+// The host has to confirm the new rate with '$BAUD' within BAUD_CONFIRM_TIME.
+uint8_t Print_SetBaud(uint32_t baud);
+uint32_t Print_GetBaud(void);
+void Print_ConfirmBaud(void);
+// Restores previous rate, if the new one wasn't confirmed. Called from main loop.
+void Print_CheckBaud(void);
+// Prints '[BAUD:<current>|<supported>,...]'
+void Print_ReportBaudRates(void);
 
 void PrintFloat_CoordValue(float n);
 void PrintFloat_RateValue(float n);
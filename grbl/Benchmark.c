@@ -0,0 +1,80 @@
+/*
+  Benchmark.c - Cycle counters for performance measurements
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "Benchmark.h"
+#include "Print.h"
+#include "util.h"
+
+
+typedef struct {
+	uint32_t Count;
+	uint32_t KCycles;	// Sum in 1000 cycles, so 32 bit last for hours
+	uint32_t Cycles;	// Remainder < 1000
+	uint32_t Max;
+} Benchmark_t;
+
+
+static volatile Benchmark_t bench[BENCH_NUM];
+
+static const char *bench_name[BENCH_NUM] = {"ISR", "LOOP", "WAIT"};
+
+
+void Benchmark_Init(void)
+{
+	memset((void*)bench, 0, sizeof(bench));
+}
+
+
+void Benchmark_Add(uint8_t idx, uint32_t cycles)
+{
+	volatile Benchmark_t *b = &bench[idx];
+
+	b->Count++;
+	b->Cycles += cycles;
+	b->KCycles += b->Cycles / 1000;
+	b->Cycles %= 1000;
+
+	if(cycles > b->Max) {
+		b->Max = cycles;
+	}
+}
+
+
+void Benchmark_Report(void)
+{
+	Benchmark_t copy[BENCH_NUM];
+	uint8_t idx;
+
+	// Take a consistent snapshot, stepper ISR keeps adding
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	memcpy(copy, (void*)bench, sizeof(copy));
+	memset((void*)bench, 0, sizeof(bench));
+	__set_PRIMASK(primask);
+
+	Printf("[BENCH:CLK,%lu]\r\n", (unsigned long)(SysTick->LOAD + 1));
+
+	for(idx = 0; idx < BENCH_NUM; idx++) {
+		Printf("[BENCH:%s,%lu,%lu,%lu]\r\n", bench_name[idx], (unsigned long)copy[idx].Count,
+				(unsigned long)copy[idx].KCycles, (unsigned long)copy[idx].Max);
+	}
+
+	Print_Flush();
+}
@@ -0,0 +1,53 @@
+/*
+  Benchmark.h - Cycle counters for performance measurements
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef BENCHMARK_H_INCLUDED
+#define BENCHMARK_H_INCLUDED
+
+
+#include <stdint.h>
+#include "System32.h"
+
+
+// Measured code sections
+#define BENCH_STEPPER_ISR			0	// Stepper_MainISR
+#define BENCH_MAIN_LOOP				1	// Processing of one line in main loop
+#define BENCH_PLANNER_WAIT			2	// Waiting for free planner block in MC_Line
+#define BENCH_NUM					3
+
+
+#define Benchmark_GetCycles()		SysTick_GetCycles()
+
+
+void Benchmark_Init(void);
+
+/**
+ * \brief   Adds a measurement to section idx.
+ * \param   idx     Section
+ * \param   cycles  Core clock cycles spent
+ */
+void Benchmark_Add(uint8_t idx, uint32_t cycles);
+
+/**
+ * \brief   Prints and clears all counters.
+ */
+void Benchmark_Report(void);
+
+
+#endif /* BENCHMARK_H_INCLUDED */
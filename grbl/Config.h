@@ -39,10 +39,17 @@
 #define DEFAULTS_GENERIC
 
 
-// Serial baud rate
+// Serial baud rate after reset
 #define BAUD_RATE	115200
 //#define BAUD_RATE	230400
 
+// Highest rate the host may switch to with '$BAUD=<rate>'. Rates above 230400 need
+// USART_FLOW_CONTROL (Platform.h) and a USB-serial adapter with RTS/CTS, without it
+// '$BAUD=<rate>' is limited to 230400.
+#define BAUD_RATE_MAX		2000000
+// Time [ms] for the host to confirm a new rate with '$BAUD', before the old one is restored
+#define BAUD_CONFIRM_TIME	2000
+
 
 // Uncomment to use external I2C EEPROM
 //#define USE_EXT_EEPROM
@@ -419,6 +426,34 @@
 #define DWELL_TIME_STEP				50 // Integer (1-255) (milliseconds)
 
 
+// Canned cycles: G83 rapids back into the hole up to this distance above the last peck. G73 breaks
+// the chip by retracting this distance after each peck. G86 stops the spindle for the retract and
+// waits the spin-up delay after restarting it, before moving to the next hole.
+#define CANNED_CYCLE_PECK_CLEARANCE		0.4 // (mm)
+#define CANNED_CYCLE_CHIP_BREAK			0.2 // (mm)
+#define CANNED_CYCLE_SPINDLE_DELAY		1.0 // (seconds)
+
+// Program mode ('%' line at start and end of a job): Spindle, coolant and G4 dwell commands are
+// queued in the planner instead of emptying the buffer. A spindle or coolant change stops the
+// machine for this short dwell, while the change is applied. Increase it to let the spindle spin up.
+#define PROGRAM_ACCESSORY_DWELL			0.001 // (seconds) Min 0.001
+
+// Tool length sensor probing after a tool change ($14=2). A tool is probed from TLS_PROBE_HEIGHT above
+// the TLS position down to TLS_PROBE_DISTANCE. If the length of the previous tool is known, the new
+// tool first approaches TLS_PROBE_CLEARANCE above the trigger height of the previous one at
+// TLS_APPROACH_RATE. This is a probe move, so a longer tool stops on the sensor. Then it searches
+// twice the clearance at TLS_SEEK_RATE, before probing the rest of the distance. After the touch,
+// the tool backs off TLS_PROBE_BACKOFF from the trigger point and touches again at TLS_FEED_RATE.
+// NOTE: The sensor must take the overtravel of a stop from TLS_APPROACH_RATE.
+#define TLS_APPROACH_RATE				600.0 // (mm/min)
+#define TLS_SEEK_RATE					180.0 // (mm/min)
+#define TLS_FEED_RATE					12.0 // (mm/min)
+#define TLS_PROBE_HEIGHT				90.0 // (mm)
+#define TLS_PROBE_DISTANCE				200.0 // (mm)
+#define TLS_PROBE_CLEARANCE				5.0 // (mm)
+#define TLS_PROBE_BACKOFF				1.5 // (mm)
+
+
 // The number of linear motions in the planner buffer to be planned at any give time. The vast
 // majority of RAM that Grbl uses is based on this buffer size. Only increase if there is extra
 // available RAM, like when re-compiling for a Mega2560. Or decrease if the Arduino begins to
@@ -526,7 +561,10 @@
 // one of these commands before sending more data to eliminate this issue.
 // NOTE: Most EEPROM write commands are implicitly blocked during a job (all '$' commands). However,
 // coordinate set g-code commands (G10,G28/30.1) are not, since they are part of an active streaming
-// job. At this time, this option only forces a planner buffer sync with these g-code commands.
+// job.
+// NOTE: Coordinate data (G10 L2/L20, G28.1, G30.1), the tool table (G10 L1) and the tool length
+// sensor position are kept in RAM. They are written back when idle or, if the write doesn't disturb
+// motion, after SETTINGS_WRITE_DELAY. So this option now only affects startup lines ($N).
 #define FORCE_BUFFER_SYNC_DURING_EEPROM_WRITE // Default enabled. Comment to disable.
 
 
@@ -599,6 +637,22 @@
 #define DUAL_Y_AXIS
 #define INVERT_DUAL_Y_AXIS
 
+
+// Enables the input recorder. Every byte received over serial or GrIP, including realtime commands,
+// and every limit/control pin edge is logged with a millisecond timestamp. The log can be dumped
+// with '$REC' and loaded back with '$REC+<hex>' lines. '$REC=P' replays it on a virtual clock, so
+// the parser, planner and stepper see exactly the same input with the same timing as during the
+// recording. Use '$REC=1' to start, '$REC=0' to stop and '$REC=C' to clear the log.
+// NOTE: Requires 4 bytes of RAM per event, see RECORDER_BUFFER_SIZE in Recorder.h.
+//#define ENABLE_RECORDER // Default disabled. Uncomment to enable.
+
+
+// Enables cycle counters for the stepper ISR, the processing of each line in the main loop and the
+// time MC_Line() waits for a free planner block. '$B' prints and clears the counters. Cycles are
+// derived from SysTick.
+// NOTE: Adds a few cycles to every stepper interrupt. Also enabled by 'make BENCH=1'.
+//#define ENABLE_BENCHMARK // Default disabled. Uncomment to enable.
+
 /* ---------------------------------------------------------------------------------------
    OEM Single File Configuration Option
 
@@ -83,7 +83,8 @@ uint8_t Coolant_GetState(void)
 // Main program only. Immediately sets flood coolant running state and also mist coolant,
 // if enabled. Also sets a flag to report an update to a coolant state.
 // Called by coolant toggle override, parking restore, parking retract, sleep mode, g-code
-// parser program end, and g-code parser coolant_sync().
+// parser program end, and g-code parser coolant_sync(). Exception: Stepper ISR applies
+// coolant changes queued in program mode.
 void Coolant_SetState(uint8_t mode)
 {
 	if(sys.abort) {
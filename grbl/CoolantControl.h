@@ -23,14 +23,16 @@
 
 
 #include <stdint.h>
+#include "Planner.h"
 
 
 #define COOLANT_NO_SYNC     	false
 #define COOLANT_FORCE_SYNC  	true
 
+// Same bits as planner condition, so the state can be used as restore condition
 #define COOLANT_STATE_DISABLE   0  // Must be zero
-#define COOLANT_STATE_FLOOD     BIT(0)
-#define COOLANT_STATE_MIST      BIT(1)
+#define COOLANT_STATE_FLOOD     PL_COND_FLAG_COOLANT_FLOOD
+#define COOLANT_STATE_MIST      PL_COND_FLAG_COOLANT_MIST
 
 
 // Initializes coolant control pins.
@@ -0,0 +1,680 @@
+/*
+  Expression.c - #parameters and expressions in g-code lines
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <math.h>
+#include <string.h>
+#include "Expression.h"
+#include "GCode.h"
+#include "System.h"
+#include "Report.h"
+#include "Config.h"
+#include "util.h"
+
+
+// Expressions follow LinuxCNC: [1 + #2 * SIN[30]], angles in degrees, comparisons and logic
+// operators return 1.0 or 0.0. The line has been upcased and stripped of whitespace by the
+// protocol, so operators are matched as 'MOD', 'EQ', 'AND', ...
+#define EXPR_MAX_DEPTH				8
+// Values closer than this are equal (EQ, NE)
+#define EXPR_TOLERANCE_EQUAL		0.0001
+
+// Precedence levels, lowest first
+#define PREC_LOGIC					0
+#define PREC_COMPARE				1
+#define PREC_ADD					2
+#define PREC_MUL					3
+#define PREC_POWER					4
+
+// Read-only parameters
+#define PARAM_PROBE					5061	// #5061-#5063: Last probe position (work coordinates)
+#define PARAM_TOOL					5400	// Current tool number
+#define PARAM_POSITION				5420	// #5420-#5422: Current position (work coordinates)
+
+// Parameter reference of a named parameter
+#define PARAM_NAMED					0x8000
+
+
+typedef struct {
+	const char *Text;
+	uint8_t Prec;
+	uint8_t Op;
+} Expr_Operator_t;
+
+enum {OP_POW = 1, OP_MUL, OP_DIV, OP_MOD, OP_ADD, OP_SUB, OP_EQ, OP_NE, OP_GT, OP_GE, OP_LT, OP_LE, OP_AND, OP_OR, OP_XOR};
+
+// '**' must be checked before '*'
+static const Expr_Operator_t operators[] = {
+	{"**", PREC_POWER, OP_POW}, {"*", PREC_MUL, OP_MUL}, {"/", PREC_MUL, OP_DIV}, {"MOD", PREC_MUL, OP_MOD},
+	{"+", PREC_ADD, OP_ADD}, {"-", PREC_ADD, OP_SUB},
+	{"EQ", PREC_COMPARE, OP_EQ}, {"NE", PREC_COMPARE, OP_NE}, {"GT", PREC_COMPARE, OP_GT},
+	{"GE", PREC_COMPARE, OP_GE}, {"LT", PREC_COMPARE, OP_LT}, {"LE", PREC_COMPARE, OP_LE},
+	{"AND", PREC_LOGIC, OP_AND}, {"OR", PREC_LOGIC, OP_OR}, {"XOR", PREC_LOGIC, OP_XOR}
+};
+
+enum {FN_ABS = 1, FN_ACOS, FN_ASIN, FN_ATAN, FN_COS, FN_EXP, FN_FIX, FN_FUP, FN_LN, FN_ROUND, FN_SIN, FN_SQRT, FN_TAN, FN_EXISTS};
+
+static const char *functions[] = {
+	"ABS", "ACOS", "ASIN", "ATAN", "COS", "EXP", "FIX", "FUP", "LN", "ROUND", "SIN", "SQRT", "TAN", "EXISTS"
+};
+
+typedef struct {
+	char Name[PARAMETER_NAME_LENGTH];
+	uint8_t Used;
+	float Value;
+} Expr_Named_t;
+
+typedef struct {
+	uint16_t Ref;
+	float Value;
+} Expr_Assignment_t;
+
+
+static float param[PARAMETER_COUNT];	// #1 is param[0]
+static Expr_Named_t named[PARAMETER_NAMED_COUNT];
+static uint8_t named_count = 0;
+
+static Expr_Assignment_t assignment[PARAMETER_MAX_ASSIGN];
+static uint8_t assignment_count = 0;
+
+static uint8_t expr_depth = 0;
+
+
+static uint8_t Expr_Binary(char *line, uint8_t *char_counter, float *value, uint8_t prec);
+static uint8_t Expr_Unary(char *line, uint8_t *char_counter, float *value);
+static uint8_t Expr_Bracket(char *line, uint8_t *char_counter, float *value);
+static uint8_t Expr_Function(char *line, uint8_t *char_counter, float *value);
+static uint8_t Expr_Apply(uint8_t op, float *value, float rhs);
+static uint8_t Expr_ReadReference(char *line, uint8_t *char_counter, uint16_t *ref, uint8_t create);
+static uint8_t Expr_Get(uint16_t ref, float *value);
+static uint8_t Expr_ReadName(char *line, uint8_t *char_counter, char *name);
+
+
+void Expr_Init(void)
+{
+	memset(param, 0, sizeof(param));
+	memset(named, 0, sizeof(named));
+	named_count = 0;
+	assignment_count = 0;
+}
+
+
+uint8_t Expr_ReadValue(char *line, uint8_t *char_counter, float *value)
+{
+	char c = line[*char_counter];
+
+	if(c == '[') {
+		return Expr_Bracket(line, char_counter, value);
+	}
+	else if(c == '#') {
+		uint16_t ref;
+		uint8_t status;
+
+		// '##1' recurses like brackets
+		if(expr_depth >= EXPR_MAX_DEPTH) {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		expr_depth++;
+		status = Expr_ReadReference(line, char_counter, &ref, 0);
+		expr_depth--;
+
+		if(status == STATUS_OK) {
+			status = Expr_Get(ref, value);
+		}
+
+		return status;
+	}
+	else if(c >= 'A' && c <= 'Z') {
+		return Expr_Function(line, char_counter, value);
+	}
+	else if((c == '-' || c == '+') && (line[*char_counter+1] == '[' || line[*char_counter+1] == '#')) {
+		// Sign of parameter or expression: X-#1
+		return Expr_Unary(line, char_counter, value);
+	}
+
+	if(!Read_Float(line, char_counter, value) || !isfinite(*value)) {
+		return STATUS_BAD_NUMBER_FORMAT;
+	}
+
+	return STATUS_OK;
+}
+
+
+uint8_t Expr_ReadAssignment(char *line, uint8_t *char_counter)
+{
+	uint16_t ref;
+	float value;
+	uint8_t status = Expr_ReadReference(line, char_counter, &ref, 1);
+
+	if(status == STATUS_OK && ref > PARAMETER_COUNT && !(ref & PARAM_NAMED)) {
+		// Read-only
+		status = STATUS_PARAMETER_INVALID;
+	}
+	if(status == STATUS_OK && line[*char_counter] != '=') {
+		status = STATUS_EXPRESSION_INVALID;
+	}
+	if(status == STATUS_OK) {
+		(*char_counter)++;
+		status = Expr_ReadValue(line, char_counter, &value);
+	}
+	if(status == STATUS_OK && assignment_count >= PARAMETER_MAX_ASSIGN) {
+		status = STATUS_PARAMETER_INVALID;
+	}
+
+	if(status != STATUS_OK) {
+		// Drop a named parameter created by this assignment
+		Expr_DiscardAssignments();
+		return status;
+	}
+
+	assignment[assignment_count].Ref = ref;
+	assignment[assignment_count].Value = value;
+	assignment_count++;
+
+	return STATUS_OK;
+}
+
+
+void Expr_Assign(void)
+{
+	for(uint8_t i = 0; i < assignment_count; i++) {
+		uint16_t ref = assignment[i].Ref;
+
+		if(ref & PARAM_NAMED) {
+			named[ref & ~PARAM_NAMED].Value = assignment[i].Value;
+			named[ref & ~PARAM_NAMED].Used = 1;
+		}
+		else {
+			param[ref-1] = assignment[i].Value;
+		}
+	}
+
+	assignment_count = 0;
+}
+
+
+void Expr_DiscardAssignments(void)
+{
+	assignment_count = 0;
+
+	// Named parameters without value were created by these assignments. They are always the
+	// last ones, as Expr_Assign() gives all of them a value.
+	while(named_count > 0 && !named[named_count-1].Used) {
+		named_count--;
+	}
+}
+
+
+void Expr_SaveLocals(float *locals)
+{
+	memcpy(locals, param, PARAMETER_LOCALS*sizeof(float));
+}
+
+
+void Expr_RestoreLocals(const float *locals)
+{
+	memcpy(param, locals, PARAMETER_LOCALS*sizeof(float));
+}
+
+
+void Expr_SetLocal(uint8_t idx, float value)
+{
+	if(idx >= 1 && idx <= PARAMETER_LOCALS) {
+		param[idx-1] = value;
+	}
+}
+
+
+// Operators of precedence 'prec' and higher, left to right
+static uint8_t Expr_Binary(char *line, uint8_t *char_counter, float *value, uint8_t prec)
+{
+	uint8_t status;
+
+	if(prec > PREC_POWER) {
+		return Expr_Unary(line, char_counter, value);
+	}
+
+	status = Expr_Binary(line, char_counter, value, prec+1);
+
+	while(status == STATUS_OK) {
+		const Expr_Operator_t *op = 0;
+		float rhs;
+
+		for(uint8_t i = 0; i < sizeof(operators)/sizeof(operators[0]); i++) {
+			uint8_t len = strlen(operators[i].Text);
+
+			if(strncmp(&line[*char_counter], operators[i].Text, len) == 0) {
+				op = &operators[i];
+				break;
+			}
+		}
+
+		if(op == 0 || op->Prec != prec) {
+			// End of expression or operator of lower precedence
+			break;
+		}
+		*char_counter += strlen(op->Text);
+
+		status = Expr_Binary(line, char_counter, &rhs, prec+1);
+		if(status == STATUS_OK) {
+			status = Expr_Apply(op->Op, value, rhs);
+		}
+	}
+
+	return status;
+}
+
+
+static uint8_t Expr_Unary(char *line, uint8_t *char_counter, float *value)
+{
+	if(line[*char_counter] == '-') {
+		(*char_counter)++;
+
+		uint8_t status = Expr_Unary(line, char_counter, value);
+		*value = -*value;
+
+		return status;
+	}
+	else if(line[*char_counter] == '+') {
+		(*char_counter)++;
+
+		return Expr_Unary(line, char_counter, value);
+	}
+
+	return Expr_ReadValue(line, char_counter, value);
+}
+
+
+static uint8_t Expr_Bracket(char *line, uint8_t *char_counter, float *value)
+{
+	uint8_t status;
+
+	if(line[*char_counter] != '[' || expr_depth >= EXPR_MAX_DEPTH) {
+		return STATUS_EXPRESSION_INVALID;
+	}
+	(*char_counter)++;
+
+	expr_depth++;
+	status = Expr_Binary(line, char_counter, value, PREC_LOGIC);
+	expr_depth--;
+
+	if(status == STATUS_OK) {
+		if(line[*char_counter] != ']') {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		(*char_counter)++;
+	}
+
+	return status;
+}
+
+
+static uint8_t Expr_Function(char *line, uint8_t *char_counter, float *value)
+{
+	uint8_t fn = 0;
+	uint8_t status;
+
+	for(uint8_t i = 0; i < sizeof(functions)/sizeof(functions[0]); i++) {
+		uint8_t len = strlen(functions[i]);
+
+		if(strncmp(&line[*char_counter], functions[i], len) == 0 && line[*char_counter + len] == '[') {
+			fn = i + 1;
+			*char_counter += len;
+			break;
+		}
+	}
+
+	if(fn == 0) {
+		// Also plain words without value: 'G1XY10'
+		return STATUS_BAD_NUMBER_FORMAT;
+	}
+
+	if(fn == FN_EXISTS) {
+		// EXISTS[#<name>]
+		char name[PARAMETER_NAME_LENGTH];
+
+		if(line[*char_counter + 1] != '#') {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		*char_counter += 2;
+
+		status = Expr_ReadName(line, char_counter, name);
+		if(status != STATUS_OK || line[*char_counter] != ']') {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		(*char_counter)++;
+
+		*value = 0.0;
+		for(uint8_t i = 0; i < named_count; i++) {
+			if(named[i].Used && strcmp(named[i].Name, name) == 0) {
+				*value = 1.0;
+			}
+		}
+
+		return STATUS_OK;
+	}
+
+	status = Expr_Bracket(line, char_counter, value);
+	if(status != STATUS_OK) {
+		return status;
+	}
+
+	switch(fn)
+	{
+	case FN_ABS:
+		*value = fabsf(*value);
+		break;
+
+	case FN_ACOS:
+	case FN_ASIN:
+		if(*value < -1.0 || *value > 1.0) {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		*value = ((fn == FN_ACOS) ? acosf(*value) : asinf(*value)) * (180.0/M_PI);
+		break;
+
+	case FN_ATAN:
+		// ATAN[y]/[x]
+		if(line[*char_counter] == '/') {
+			float x;
+
+			(*char_counter)++;
+			status = Expr_Bracket(line, char_counter, &x);
+			if(status != STATUS_OK) {
+				return status;
+			}
+			*value = atan2f(*value, x) * (180.0/M_PI);
+		}
+		else {
+			*value = atanf(*value) * (180.0/M_PI);
+		}
+		break;
+
+	case FN_COS:
+		*value = cosf(*value * (M_PI/180.0));
+		break;
+
+	case FN_EXP:
+		*value = expf(*value);
+		break;
+
+	case FN_FIX:
+		*value = floorf(*value);
+		break;
+
+	case FN_FUP:
+		*value = ceilf(*value);
+		break;
+
+	case FN_LN:
+		if(*value <= 0.0) {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		*value = logf(*value);
+		break;
+
+	case FN_ROUND:
+		*value = roundf(*value);
+		break;
+
+	case FN_SIN:
+		*value = sinf(*value * (M_PI/180.0));
+		break;
+
+	case FN_SQRT:
+		if(*value < 0.0) {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		*value = sqrtf(*value);
+		break;
+
+	case FN_TAN:
+		*value = tanf(*value * (M_PI/180.0));
+		break;
+
+	default:
+		break;
+	}
+
+	if(!isfinite(*value)) {
+		// EXP[100], ...
+		return STATUS_EXPRESSION_INVALID;
+	}
+
+	return STATUS_OK;
+}
+
+
+static uint8_t Expr_Apply(uint8_t op, float *value, float rhs)
+{
+	float lhs = *value;
+
+	switch(op)
+	{
+	case OP_POW:
+		*value = powf(lhs, rhs);
+		break;
+
+	case OP_MUL:
+		*value = lhs * rhs;
+		break;
+
+	case OP_DIV:
+	case OP_MOD:
+		if(rhs == 0.0) {
+			return STATUS_EXPRESSION_INVALID;
+		}
+		if(op == OP_DIV) {
+			*value = lhs / rhs;
+		}
+		else {
+			// Result has the sign of the divisor, like in LinuxCNC
+			*value = fmodf(lhs, rhs);
+			if(*value != 0.0 && ((*value < 0.0) != (rhs < 0.0))) {
+				*value += rhs;
+			}
+		}
+		break;
+
+	case OP_ADD:
+		*value = lhs + rhs;
+		break;
+
+	case OP_SUB:
+		*value = lhs - rhs;
+		break;
+
+	case OP_EQ:
+		*value = (fabsf(lhs - rhs) < EXPR_TOLERANCE_EQUAL);
+		break;
+
+	case OP_NE:
+		*value = (fabsf(lhs - rhs) >= EXPR_TOLERANCE_EQUAL);
+		break;
+
+	case OP_GT:
+		*value = (lhs > rhs);
+		break;
+
+	case OP_GE:
+		*value = (lhs >= rhs);
+		break;
+
+	case OP_LT:
+		*value = (lhs < rhs);
+		break;
+
+	case OP_LE:
+		*value = (lhs <= rhs);
+		break;
+
+	case OP_AND:
+		*value = (lhs != 0.0 && rhs != 0.0);
+		break;
+
+	case OP_OR:
+		*value = (lhs != 0.0 || rhs != 0.0);
+		break;
+
+	case OP_XOR:
+		*value = ((lhs != 0.0) != (rhs != 0.0));
+		break;
+
+	default:
+		return STATUS_EXPRESSION_INVALID;
+	}
+
+	if(!isfinite(*value)) {
+		// 0**-1, 10**40, overflow of * and /
+		return STATUS_EXPRESSION_INVALID;
+	}
+
+	return STATUS_OK;
+}
+
+
+// Reads '#1', '#<name>' or '#[expr]'. Named parameters are created, if 'create' is set.
+static uint8_t Expr_ReadReference(char *line, uint8_t *char_counter, uint16_t *ref, uint8_t create)
+{
+	uint8_t status;
+
+	if(line[*char_counter] != '#') {
+		return STATUS_EXPRESSION_INVALID;
+	}
+	(*char_counter)++;
+
+	if(line[*char_counter] == '<') {
+		char name[PARAMETER_NAME_LENGTH];
+		uint8_t i;
+
+		status = Expr_ReadName(line, char_counter, name);
+		if(status != STATUS_OK) {
+			return status;
+		}
+
+		for(i = 0; i < named_count; i++) {
+			if(strcmp(named[i].Name, name) == 0) {
+				break;
+			}
+		}
+
+		if(i == named_count) {
+			if(!create || named_count >= PARAMETER_NAMED_COUNT) {
+				return STATUS_PARAMETER_INVALID;
+			}
+			// Value is valid after the assignment
+			strcpy(named[i].Name, name);
+			named[i].Used = 0;
+			named_count++;
+		}
+
+		*ref = PARAM_NAMED | i;
+
+		return STATUS_OK;
+	}
+
+	// Number, another parameter or expression
+	float index;
+
+	status = Expr_ReadValue(line, char_counter, &index);
+	if(status != STATUS_OK) {
+		return status;
+	}
+
+	uint16_t idx = lroundf(index);
+
+	if(fabsf(index - idx) > 0.0001 || idx < 1 ||
+	   (idx > PARAMETER_COUNT && !(idx >= PARAM_PROBE && idx < PARAM_PROBE+N_AXIS) && idx != PARAM_TOOL &&
+	   !(idx >= PARAM_POSITION && idx < PARAM_POSITION+N_AXIS))) {
+		return STATUS_PARAMETER_INVALID;
+	}
+
+	*ref = idx;
+
+	return STATUS_OK;
+}
+
+
+static uint8_t Expr_Get(uint16_t ref, float *value)
+{
+	if(ref & PARAM_NAMED) {
+		if(!named[ref & ~PARAM_NAMED].Used) {
+			return STATUS_PARAMETER_INVALID;
+		}
+		*value = named[ref & ~PARAM_NAMED].Value;
+
+		return STATUS_OK;
+	}
+
+	if(ref <= PARAMETER_COUNT) {
+		*value = param[ref-1];
+
+		return STATUS_OK;
+	}
+
+	if(ref == PARAM_TOOL) {
+		*value = gc_state.tool;
+
+		return STATUS_OK;
+	}
+
+	// Positions in work coordinates and current units
+	uint8_t idx;
+
+	if(ref >= PARAM_POSITION) {
+		idx = ref - PARAM_POSITION;
+		*value = gc_state.position[idx];
+	}
+	else {
+		idx = ref - PARAM_PROBE;
+		*value = System_ConvertAxisSteps2Mpos(sys_probe_position, idx);
+	}
+
+	*value -= gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+	if(idx == TOOL_LENGTH_OFFSET_AXIS) {
+		*value -= gc_state.tool_length_offset;
+	}
+	if(gc_state.modal.units == UNITS_MODE_INCHES) {
+		*value *= INCH_PER_MM;
+	}
+
+	return STATUS_OK;
+}
+
+
+// Reads '<name>'
+static uint8_t Expr_ReadName(char *line, uint8_t *char_counter, char *name)
+{
+	uint8_t len = 0;
+
+	if(line[*char_counter] != '<') {
+		return STATUS_PARAMETER_INVALID;
+	}
+	(*char_counter)++;
+
+	while(line[*char_counter] != '>') {
+		if(line[*char_counter] == 0 || len >= PARAMETER_NAME_LENGTH-1) {
+			return STATUS_PARAMETER_INVALID;
+		}
+		name[len++] = line[(*char_counter)++];
+	}
+	name[len] = 0;
+	(*char_counter)++;
+
+	return STATUS_OK;
+}
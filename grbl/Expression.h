@@ -0,0 +1,67 @@
+/*
+  Expression.h - #parameters and expressions in g-code lines
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef EXPRESSION_H_INCLUDED
+#define EXPRESSION_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// Numbered parameters #1 - #PARAMETER_COUNT. #1 - #30 are local to a subroutine call.
+#ifndef PARAMETER_COUNT
+  #define PARAMETER_COUNT			200
+#endif
+#define PARAMETER_LOCALS			30
+
+// Named parameters #<name>. Always global.
+#ifndef PARAMETER_NAMED_COUNT
+  #define PARAMETER_NAMED_COUNT		16
+#endif
+#define PARAMETER_NAME_LENGTH		16
+
+// Assignments per line
+#define PARAMETER_MAX_ASSIGN		8
+
+
+void Expr_Init(void);
+
+/**
+ * \brief   Reads a real value at char_counter: A number, a parameter (#1, #<name>, #[expr]),
+ *          an expression in brackets or a unary function like SIN[30].
+ * \return  STATUS_OK or error code
+ */
+uint8_t Expr_ReadValue(char *line, uint8_t *char_counter, float *value);
+
+/**
+ * \brief   Reads '#<param>=<value>' at char_counter. Like in LinuxCNC, all assignments of a line
+ *          are applied by Expr_Assign() after the line was read, so the line sees the old values.
+ */
+uint8_t Expr_ReadAssignment(char *line, uint8_t *char_counter);
+void Expr_Assign(void);
+// Discards assignments of a line that was not executed
+void Expr_DiscardAssignments(void);
+
+// Copies #1 - #30 for a subroutine call
+void Expr_SaveLocals(float *locals);
+void Expr_RestoreLocals(const float *locals);
+void Expr_SetLocal(uint8_t idx, float value);
+
+
+#endif /* EXPRESSION_H_INCLUDED */
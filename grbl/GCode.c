@@ -32,6 +32,8 @@
 #include "util.h"
 #include "ToolChange.h"
 #include "GCode.h"
+#include "Expression.h"
+#include "OWord.h"
 
 #include <math.h>
 
@@ -46,17 +48,19 @@
 #endif
 
 
-// NOTE: Max line number is defined by the g-code standard to be 99999. It seems to be an
-// arbitrary value, and some GUIs may require more. So we increased it based on a max safe
-// value when converting a float (7.2 digit precision)s to an integer.
-#define MAX_LINE_NUMBER 				10000000
 #define MAX_TOOL_NUMBER 				255 // Limited by max unsigned 8-bit value
+#define MAX_POCKET_TURNS 				1000 // Helix turns and spiral revolutions of G12/G13
 
 #define AXIS_COMMAND_NONE 				0
 #define AXIS_COMMAND_NON_MODAL 			1
 #define AXIS_COMMAND_MOTION_MODE 		2
 #define AXIS_COMMAND_TOOL_LENGTH_OFFSET 3 // *Undefined but required
 
+#define IS_CANNED_CYCLE(motion)			((motion) == MOTION_MODE_DRILL || (motion) == MOTION_MODE_DRILL_DWELL || (motion) == MOTION_MODE_DRILL_PECK || \
+										 (motion) == MOTION_MODE_DRILL_CHIP_BREAK || (motion) == MOTION_MODE_BORE || \
+										 (motion) == MOTION_MODE_BORE_SPINDLE_STOP || (motion) == MOTION_MODE_BORE_DWELL)
+#define CYCLE_WORDS						(BIT(WORD_P)|BIT(WORD_Q)|BIT(WORD_R)|BIT(WORD_Z))
+
 
 // Declare gc extern struct
 Parser_State_t gc_state;
@@ -99,7 +103,8 @@ uint8_t GC_ExecuteLine(char *line)
 
 	uint8_t axis_command = AXIS_COMMAND_NONE;
 	uint8_t axis_0, axis_1, axis_linear;
-	uint8_t coord_select = 0; // Tracks G10 P coordinate selection for execution
+	uint8_t coord_select = 0; // Tracks G10 P coordinate selection (tool for L1/L11) for execution
+	Tool_Data_t tool_data = {0}; // Tool table entry written by G10 L1/L11
 
 	// Initialize bitflag tracking variables for axis indices compatible operations.
 	uint8_t axis_words = 0; // XYZ tracking
@@ -111,6 +116,18 @@ uint8_t GC_ExecuteLine(char *line)
 	uint8_t gc_parser_flags = GC_PARSER_NONE;
 
 
+	Expr_DiscardAssignments();
+
+	if(line[0] != '$') {
+		// Lines of a subroutine or block are stored until it is complete
+		if(OWord_IsRecording()) {
+			return OWord_Record(line);
+		}
+		if(line[0] == 'O') {
+			return OWord_ExecuteLine(line);
+		}
+	}
+
 	memset(&gc_block, 0, sizeof(Parser_Block_t)); // Initialize the parser block struct.
 	memcpy(&gc_block.modal,&gc_state.modal,sizeof(GC_Modal_t)); // Copy current modes
 
@@ -154,15 +171,27 @@ uint8_t GC_ExecuteLine(char *line)
     {
         // Import the next g-code word, expecting a letter followed by a value. Otherwise, error out.
 		letter = line[char_counter];
+		if(letter == '#')
+		{
+			// Parameter assignment: #1=[#2+1]
+			uint8_t status = Expr_ReadAssignment(line, &char_counter);
+			if(status != STATUS_OK)
+			{
+				return status;
+			}
+			continue;
+		}
 		if((letter < 'A') || (letter > 'Z'))
         {
 			return STATUS_EXPECTED_COMMAND_LETTER;
 		} // [Expected word letter]
 
 		char_counter++;
-		if(!Read_Float(line, &char_counter, &value))
+		// Number, parameter or expression
+		uint8_t status = Expr_ReadValue(line, &char_counter, &value);
+		if(status != STATUS_OK)
         {
-			return STATUS_BAD_NUMBER_FORMAT;
+			return status;
 		} // [Expected word value]
 
 		// Convert values to smaller uint8 significand and mantissa values for parsing this word.
@@ -187,8 +216,8 @@ uint8_t GC_ExecuteLine(char *line)
 			// Determine 'G' command and its modal group
 			switch(int_value)
 			{
-			case 10: case 28: case 30: case 92:
-				// Check for G10/28/30/92 being called with G0/1/2/3/38 on same block.
+			case 10: case 12: case 13: case 28: case 30: case 92:
+				// Check for G10/12/13/28/30/92 being called with G0/1/2/3/38 on same block.
 				// * G43.1 is also an axis command but is not explicitly defined this way.
 				if(mantissa == 0) // Ignore G28.1, G30.1, and G92.1
                 {
@@ -242,7 +271,8 @@ uint8_t GC_ExecuteLine(char *line)
 				}
 				break;
 
-            case 81: case 82: case 83:  // Canned drilling cycles
+            case 73: case 81: case 82: case 83:  // Canned drilling cycles
+            case 85: case 86: case 89:  // Canned boring cycles
                 word_bit = MODAL_GROUP_G1;
                 //gc_block.modal.motion = MOTION_MODE_DRILL;
                 gc_block.modal.motion = int_value;
@@ -316,6 +346,10 @@ uint8_t GC_ExecuteLine(char *line)
 				else if(mantissa == 10) // G43.1
 				{
                     gc_block.modal.tool_length = TOOL_LENGTH_OFFSET_ENABLE_DYNAMIC;
+				}
+				else if(mantissa == 0) // G43
+				{
+                    gc_block.modal.tool_length = TOOL_LENGTH_OFFSET_ENABLE;
 				}
 				else
                 {
@@ -466,7 +500,14 @@ uint8_t GC_ExecuteLine(char *line)
 			// case 'C': // Not supported
 			// case 'D': // Not supported
 			case 'F': word_bit = WORD_F; gc_block.values.f = value; break;
-			// case 'H': // Not supported
+			case 'H': word_bit = WORD_H;
+				if(value > MAX_TOOL_NUMBER)
+                {
+					return STATUS_GCODE_MAX_VALUE_EXCEEDED;
+				}
+				gc_block.values.h = int_value;
+				break;
+
 			case 'I': word_bit = WORD_I; gc_block.values.ijk[X_AXIS] = value; ijk_words |= (1<<X_AXIS); break;
 			case 'J': word_bit = WORD_J; gc_block.values.ijk[Y_AXIS] = value; ijk_words |= (1<<Y_AXIS); break;
 			case 'K': word_bit = WORD_K; gc_block.values.ijk[Z_AXIS] = value; ijk_words |= (1<<Z_AXIS); break;
@@ -498,9 +539,9 @@ uint8_t GC_ExecuteLine(char *line)
 				return STATUS_GCODE_WORD_REPEATED;
 			} // [Word repeated]
 
-			// Check for invalid negative values for words F, N, P, T, and S.
+			// Check for invalid negative values for words F, N, P, T, H and S.
 			// NOTE: Negative value check is done here simply for code-efficiency.
-			if(BIT(word_bit) & (BIT(WORD_F)|BIT(WORD_N)|BIT(WORD_P)|BIT(WORD_T)|BIT(WORD_S)))
+			if(BIT(word_bit) & (BIT(WORD_F)|BIT(WORD_N)|BIT(WORD_P)|BIT(WORD_T)|BIT(WORD_H)|BIT(WORD_S)))
             {
 				if(value < 0.0)
 				{
@@ -554,6 +595,44 @@ uint8_t GC_ExecuteLine(char *line)
 		}
 	}
 
+	// Canned cycle words R, Q, P and Z are sticky, like in LinuxCNC. Following holes of a cycle
+	// only need their position. The words are stored as programmed, before any conversion.
+	uint16_t cycle_words = 0;
+	GC_Values_t cycle_values;
+
+	if(IS_CANNED_CYCLE(gc_block.modal.motion) && axis_words && (axis_command == AXIS_COMMAND_MOTION_MODE))
+	{
+		if(IS_CANNED_CYCLE(gc_state.modal.motion))
+		{
+			// Only words used by this cycle, P of a former G82 would be an unused word for G81
+			uint16_t used = BIT(WORD_R)|BIT(WORD_Z);
+
+			if(gc_block.modal.motion == MOTION_MODE_DRILL_PECK || gc_block.modal.motion == MOTION_MODE_DRILL_CHIP_BREAK)
+			{
+				used |= BIT(WORD_Q);
+			}
+			if(gc_block.modal.motion == MOTION_MODE_DRILL_DWELL || gc_block.modal.motion == MOTION_MODE_BORE_DWELL)
+			{
+				used |= BIT(WORD_P);
+			}
+
+			uint16_t sticky = gc_state.cycle_words & ~value_words & used;
+
+			if(sticky & BIT(WORD_P)) { gc_block.values.p = gc_state.cycle.p; }
+			if(sticky & BIT(WORD_Q)) { gc_block.values.q = gc_state.cycle.q; }
+			if(sticky & BIT(WORD_R)) { gc_block.values.r = gc_state.cycle.r; }
+			if(sticky & BIT(WORD_Z))
+			{
+				gc_block.values.xyz[Z_AXIS] = gc_state.cycle.xyz[Z_AXIS];
+				axis_words |= BIT(Z_AXIS);
+			}
+			value_words |= sticky;
+		}
+
+		cycle_words = value_words & CYCLE_WORDS;
+		cycle_values = gc_block.values;
+	}
+
 	// Check for valid line number N value.
 	if(BIT_IS_TRUE(value_words,BIT(WORD_N)))
     {
@@ -645,6 +724,10 @@ uint8_t GC_ExecuteLine(char *line)
 	// bit_false(value_words,bit(WORD_S)); // NOTE: Single-meaning value word. Set at end of error-checking.
 
 	// [5. Select tool ]: NOT SUPPORTED. Only tracks value. T is negative (done.) Not an integer. Greater than max tool value.
+	if(BIT_IS_FALSE(value_words, BIT(WORD_T)))
+    {
+		gc_block.values.t = gc_state.tool;
+	}
 	// bit_false(value_words,bit(WORD_T)); // NOTE: Single-meaning value word. Set at end of error-checking.
 
 	// [6. Change tool ]: N/A
@@ -675,8 +758,8 @@ uint8_t GC_ExecuteLine(char *line)
 		BIT_FALSE(value_words, BIT(WORD_P));
 	}
 
-	// [10.1 Canned drilling cycle]: R/P/Q value missing.
-	if(gc_block.modal.motion == MOTION_MODE_DRILL || gc_block.modal.motion == MOTION_MODE_DRILL_DWELL || gc_block.modal.motion == MOTION_MODE_DRILL_PECK)
+	// [10.1 Canned cycles]: R/P/Q value missing. Q not positive. R and Q are converted to millimeters.
+	if(IS_CANNED_CYCLE(gc_block.modal.motion) && (axis_command == AXIS_COMMAND_MOTION_MODE))
     {
         if(BIT_IS_FALSE(value_words, BIT(WORD_R)))
         {
@@ -685,26 +768,40 @@ uint8_t GC_ExecuteLine(char *line)
         }
         BIT_FALSE(value_words, BIT(WORD_R));
 
-        if(gc_block.modal.motion == MOTION_MODE_DRILL_DWELL)
+        if(gc_block.modal.motion == MOTION_MODE_DRILL_DWELL || gc_block.modal.motion == MOTION_MODE_BORE_DWELL)
         {
             if(BIT_IS_FALSE(value_words, BIT(WORD_P)))
             {
                 // [P word missing]
                 return STATUS_GCODE_VALUE_WORD_MISSING;
             }
-            // TODO: Check validity of P
             BIT_FALSE(value_words, BIT(WORD_P));
         }
-        if(gc_block.modal.motion == MOTION_MODE_DRILL_PECK)
+        else if(gc_block.modal.motion == MOTION_MODE_BORE_SPINDLE_STOP)
         {
-            if(BIT_IS_FALSE(value_words, BIT(WORD_Q)))
+            // Optional dwell before the spindle stops
+            if(BIT_IS_FALSE(value_words, BIT(WORD_P)))
             {
-                // [Q word missing]
+                gc_block.values.p = 0.0;
+            }
+            BIT_FALSE(value_words, BIT(WORD_P));
+        }
+
+        if(gc_block.modal.motion == MOTION_MODE_DRILL_PECK || gc_block.modal.motion == MOTION_MODE_DRILL_CHIP_BREAK)
+        {
+            if(BIT_IS_FALSE(value_words, BIT(WORD_Q)) || gc_block.values.q <= 0.0)
+            {
+                // [Q word missing or not positive]
                 return STATUS_GCODE_VALUE_WORD_MISSING;
             }
-            // TODO: Check validity of Q
             BIT_FALSE(value_words, BIT(WORD_Q));
         }
+
+        if(gc_block.modal.units == UNITS_MODE_INCHES)
+        {
+            gc_block.values.r *= MM_PER_INCH;
+            gc_block.values.q *= MM_PER_INCH;
+        }
     }
 
 	// [11. Set active plane ]: N/A
@@ -746,11 +843,13 @@ uint8_t GC_ExecuteLine(char *line)
 	//   NOTE: Since cutter radius compensation is never enabled, these G40 errors don't apply. Grbl supports G40
 	//   only for the purpose to not error when G40 is sent with a g-code program header to setup the default modes.
 
-	// [14. Cutter length compensation ]: G43 NOT SUPPORTED, but G43.1 and G49 are.
+	// [14. Cutter length compensation ]: G43, G43.1 and G49 are supported.
 	// [G43.1 Errors]: Motion command in same line.
 	//   NOTE: Although not explicitly stated so, G43.1 should be applied to only one valid
 	//   axis that is configured (in config.h). There should be an error if the configured axis
 	//   is absent or if any of the other axis words are present.
+	// [G43 Errors]: Axis words. H (or current T, if H is missing) not in tool table or length unknown.
+	//   NOTE: H0 cancels the offset like G49, but keeps G43 active.
 	if(axis_command == AXIS_COMMAND_TOOL_LENGTH_OFFSET ) { // Indicates called in block.
 		if(gc_block.modal.tool_length == TOOL_LENGTH_OFFSET_ENABLE_DYNAMIC)
 		{
@@ -759,6 +858,35 @@ uint8_t GC_ExecuteLine(char *line)
 				return STATUS_GCODE_G43_DYNAMIC_AXIS_ERROR;
 			}
 		}
+		else if(gc_block.modal.tool_length == TOOL_LENGTH_OFFSET_ENABLE)
+		{
+			if(axis_words)
+            {
+				return STATUS_GCODE_AXIS_WORDS_EXIST;
+			}
+
+			if(BIT_IS_FALSE(value_words, BIT(WORD_H)))
+			{
+				gc_block.values.h = gc_block.values.t;
+			}
+			BIT_FALSE(value_words, BIT(WORD_H));
+
+			// NOTE: Length is passed to execution like a G43.1 axis word and made relative
+			// to the reference tool there.
+			gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS] = 0.0;
+
+			if(gc_block.values.h > 0)
+			{
+				Tool_Data_t tool;
+
+				if(!Settings_ReadToolData(gc_block.values.h, &tool) || !tool.valid)
+				{
+					// [Unknown tool]
+					return STATUS_TOOL_UNKNOWN;
+				}
+				gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS] = tool.length + tool.wear;
+			}
+		}
 	}
 
 	// [15. Coordinate system selection ]: *N/A. Error, if cutter radius comp is active.
@@ -797,9 +925,83 @@ uint8_t GC_ExecuteLine(char *line)
 	switch (gc_block.non_modal_command)
 	{
     case NON_MODAL_SET_COORDINATE_DATA:
-		// [G10 Errors]: L missing and is not 2 or 20. P word missing. (Negative P value done.)
+		// [G10 Errors]: L missing and is not 1, 2, 11 or 20. P word missing. (Negative P value done.)
+		// [G10 L1 Errors]: P not a tool of the table. Axis words other than tool length axis.
+		// [G10 L11 Errors]: P not a tool of the table. Axis words. R missing.
 		// [G10 L2 Errors]: R word NOT SUPPORTED. P value not 0 to nCoordSys(max 9). Axis words missing.
 		// [G10 L20 Errors]: P must be 0 to nCoordSys(max 9). Axis words missing.
+		if(BIT_IS_TRUE(value_words, BIT(WORD_L)) && (gc_block.values.l == 1 || gc_block.values.l == 11))
+		{
+			// Tool table: L1 sets length (Z) and radius (R), L11 sets the length wear (R).
+			if(BIT_IS_FALSE(value_words, BIT(WORD_P)))
+			{
+				// [P word missing]
+				return STATUS_GCODE_VALUE_WORD_MISSING;
+			}
+
+			if(gc_block.values.p < 1.0 || gc_block.values.p >= TOOL_TABLE_SIZE+1)
+			{
+				// [Not in tool table]
+				return STATUS_TOOL_UNKNOWN;
+			}
+
+			uint8_t tool = trunc(gc_block.values.p);
+			Settings_ReadToolData(tool, &tool_data);
+
+			if(gc_block.values.l == 1)
+			{
+				if(axis_words & ~(1<<TOOL_LENGTH_OFFSET_AXIS))
+				{
+					return STATUS_GCODE_AXIS_WORDS_EXIST;
+				}
+				if(!axis_words && BIT_IS_FALSE(value_words, BIT(WORD_R)))
+				{
+					// Neither Z nor R: Clears the entry. Tool is measured again on the next tool change.
+					memset(&tool_data, 0, sizeof(tool_data));
+				}
+
+				if(axis_words)
+				{
+					// NOTE: Axis word is already converted to mm
+					tool_data.length = gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
+					tool_data.valid = TOOL_LENGTH_SET;
+				}
+			}
+			else
+			{
+				if(axis_words)
+				{
+					return STATUS_GCODE_AXIS_WORDS_EXIST;
+				}
+				if(BIT_IS_FALSE(value_words, BIT(WORD_R)))
+				{
+					// [R word missing]
+					return STATUS_GCODE_VALUE_WORD_MISSING;
+				}
+			}
+
+			if(BIT_IS_TRUE(value_words, BIT(WORD_R)))
+			{
+				if(gc_block.modal.units == UNITS_MODE_INCHES)
+				{
+					gc_block.values.r *= MM_PER_INCH;
+				}
+
+				if(gc_block.values.l == 1)
+				{
+					tool_data.diameter = 2.0*gc_block.values.r;
+				}
+				else
+				{
+					tool_data.wear = gc_block.values.r;
+				}
+			}
+
+			coord_select = tool;
+			BIT_FALSE(value_words, (BIT(WORD_L) | BIT(WORD_P) | BIT(WORD_R)));
+			break;
+		}
+
 		if(!axis_words)
         {
 			// [No axis words]
@@ -984,6 +1186,68 @@ uint8_t GC_ExecuteLine(char *line)
 			}
 			break;
 
+		case NON_MODAL_POCKET_CW: // G12
+		case NON_MODAL_POCKET_CCW: // G13
+			// [G12/13 Errors]: Feed rate undefined or inverse time. I (radius) missing or not positive.
+			//   Q (stepover) not positive. K (pitch) missing or not positive, when the depth changes.
+			// NOTE: Axis words in the plane give the center, the linear axis gives the final depth.
+			if(!axis_words)
+			{
+				memcpy(gc_block.values.xyz, gc_state.position, sizeof(gc_block.values.xyz));
+			}
+
+			if(gc_block.modal.feed_rate == FEED_RATE_MODE_INVERSE_TIME)
+			{
+				return STATUS_GCODE_UNSUPPORTED_COMMAND;
+			}
+			if(gc_block.values.f == 0.0)
+			{
+				// [Feed rate undefined]
+				return STATUS_GCODE_UNDEFINED_FEED_RATE;
+			}
+
+			if(BIT_IS_FALSE(value_words, BIT(WORD_I)) || gc_block.values.ijk[X_AXIS] <= 0.0)
+			{
+				// [I word missing or not positive]
+				return STATUS_GCODE_VALUE_WORD_MISSING;
+			}
+			if(BIT_IS_FALSE(value_words, BIT(WORD_Q)))
+			{
+				gc_block.values.q = 0.0;
+			}
+			else if(gc_block.values.q <= 0.0)
+			{
+				return STATUS_NEGATIVE_VALUE;
+			}
+			if(gc_block.values.xyz[axis_linear] != gc_state.position[axis_linear])
+			{
+				if(BIT_IS_FALSE(value_words, BIT(WORD_K)) || gc_block.values.ijk[Z_AXIS] <= 0.0)
+				{
+					// [K word missing or not positive]
+					return STATUS_GCODE_VALUE_WORD_MISSING;
+				}
+			}
+			BIT_FALSE(value_words, (BIT(WORD_I) | BIT(WORD_K) | BIT(WORD_Q)));
+
+			if(gc_block.modal.units == UNITS_MODE_INCHES)
+			{
+				gc_block.values.ijk[X_AXIS] *= MM_PER_INCH;
+				gc_block.values.ijk[Z_AXIS] *= MM_PER_INCH;
+				gc_block.values.q *= MM_PER_INCH;
+			}
+
+			// Every turn is expanded into arcs, don't let a tiny K or Q block the controller for ages
+			if(gc_block.values.xyz[axis_linear] != gc_state.position[axis_linear] &&
+			   fabs(gc_block.values.xyz[axis_linear] - gc_state.position[axis_linear]) / gc_block.values.ijk[Z_AXIS] > MAX_POCKET_TURNS)
+			{
+				return STATUS_GCODE_MAX_VALUE_EXCEEDED;
+			}
+			if(gc_block.values.q > 0.0 && gc_block.values.ijk[X_AXIS] / gc_block.values.q > MAX_POCKET_TURNS)
+			{
+				return STATUS_GCODE_MAX_VALUE_EXCEEDED;
+			}
+			break;
+
 		case NON_MODAL_SET_HOME_0: // G28.1
 		case NON_MODAL_SET_HOME_1: // G30.1
 			// [G28.1/30.1 Errors]: Cutter compensation is enabled.
@@ -1010,7 +1274,8 @@ uint8_t GC_ExecuteLine(char *line)
     {
 		// [G80 Errors]: Axis word are programmed while G80 is active.
 		// NOTE: Even non-modal commands or TLO that use axis words will throw this strict error.
-		if(axis_words)
+		// Exception: G12/G13 take the pocket center and depth from the axis words.
+		if(axis_words && gc_block.non_modal_command != NON_MODAL_POCKET_CW && gc_block.non_modal_command != NON_MODAL_POCKET_CCW)
 		{
 			// [No axis words allowed]
 			return STATUS_GCODE_AXIS_WORDS_EXIST;
@@ -1256,7 +1521,8 @@ uint8_t GC_ExecuteLine(char *line)
 				}
 				break;
 
-            case MOTION_MODE_DRILL: case MOTION_MODE_DRILL_DWELL: case MOTION_MODE_DRILL_PECK:
+            case MOTION_MODE_DRILL: case MOTION_MODE_DRILL_DWELL: case MOTION_MODE_DRILL_PECK: case MOTION_MODE_DRILL_CHIP_BREAK:
+            case MOTION_MODE_BORE: case MOTION_MODE_BORE_SPINDLE_STOP: case MOTION_MODE_BORE_DWELL:
                 if(BIT_TRUE(value_words, (BIT(WORD_L))))
                 {
                 }
@@ -1393,6 +1659,9 @@ uint8_t GC_ExecuteLine(char *line)
 	gc_state.feed_rate = gc_block.values.f; // Always copy this value. See feed rate error-checking.
 	pl_data->feed_rate = gc_state.feed_rate; // Record data for planner use.
 
+	// In program mode, spindle and coolant changes are queued in the planner instead of a buffer sync.
+	uint8_t accessory_queued = 0;
+
 	// [4. Set spindle speed ]:
 	if((gc_state.spindle_speed != gc_block.values.s) || BIT_IS_TRUE(gc_parser_flags,GC_PARSER_LASER_FORCE_SYNC))
     {
@@ -1400,7 +1669,11 @@ uint8_t GC_ExecuteLine(char *line)
 		{
 			if(BIT_IS_FALSE(gc_parser_flags, GC_PARSER_LASER_ISMOTION))
 			{
-				if(BIT_IS_TRUE(gc_parser_flags, GC_PARSER_LASER_DISABLE))
+				if(sys.program_mode)
+				{
+					accessory_queued = 1;
+				}
+				else if(BIT_IS_TRUE(gc_parser_flags, GC_PARSER_LASER_DISABLE))
 				{
 					Spindle_Sync(gc_state.modal.spindle, 0.0);
 				}
@@ -1443,7 +1716,14 @@ uint8_t GC_ExecuteLine(char *line)
 		// Update spindle control and apply spindle speed when enabling it in this block.
 		// NOTE: All spindle state changes are synced, even in laser mode. Also, pl_data,
 		// rather than gc_state, is used to manage laser state for non-laser motions.
-		Spindle_Sync(gc_block.modal.spindle, pl_data->spindle_speed);
+		if(sys.program_mode)
+		{
+			accessory_queued = 1;
+		}
+		else
+		{
+			Spindle_Sync(gc_block.modal.spindle, pl_data->spindle_speed);
+		}
 		gc_state.modal.spindle = gc_block.modal.spindle;
 	}
 
@@ -1454,11 +1734,23 @@ uint8_t GC_ExecuteLine(char *line)
     {
 		// NOTE: Coolant M-codes are modal. Only one command per line is allowed. But, multiple states
 		// can exist at the same time, while coolant disable clears all states.
-		Coolant_Sync(gc_block.modal.coolant);
+		if(sys.program_mode)
+		{
+			accessory_queued = 1;
+		}
+		else
+		{
+			Coolant_Sync(gc_block.modal.coolant);
+		}
 		gc_state.modal.coolant = gc_block.modal.coolant;
 	}
 	pl_data->condition |= gc_state.modal.coolant; // Set condition flag for planner use.
 
+	if(accessory_queued)
+	{
+		MC_BufferAccessory(pl_data);
+	}
+
 	// [9. Override control ]: NOT SUPPORTED. Always enabled. Except for a Grbl-only parking control.
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
     if(gc_state.modal.override != gc_block.modal.override)
@@ -1471,7 +1763,14 @@ uint8_t GC_ExecuteLine(char *line)
 	// [10. Dwell ]:
 	if(gc_block.non_modal_command == NON_MODAL_DWELL)
     {
-		MC_Dwell(gc_block.values.p);
+		if(sys.program_mode)
+		{
+			MC_BufferDwell(gc_block.values.p, pl_data);
+		}
+		else
+		{
+			MC_Dwell(gc_block.values.p);
+		}
 	}
 
 	// [11. Set active plane ]:
@@ -1483,16 +1782,18 @@ uint8_t GC_ExecuteLine(char *line)
 	// [13. Cutter radius compensation ]: G41/42 NOT SUPPORTED
 	// gc_state.modal.cutter_comp = gc_block.modal.cutter_comp; // NOTE: Not needed since always disabled.
 
-	// [14. Cutter length compensation ]: G43.1 and G49 supported. G43 NOT SUPPORTED.
-	// NOTE: If G43 were supported, its operation wouldn't be any different from G43.1 in terms
-	// of execution. The error-checking step would simply load the offset value into the correct
-	// axis of the block XYZ value array.
+	// [14. Cutter length compensation ]: G43, G43.1 and G49 supported.
+	// NOTE: G43 doesn't differ from G43.1 in terms of execution. The error-checking step loaded the
+	// offset of the tool table into the correct axis of the block XYZ value array.
 	if(axis_command == AXIS_COMMAND_TOOL_LENGTH_OFFSET) { // Indicates a change.
 		gc_state.modal.tool_length = gc_block.modal.tool_length;
 		if (gc_state.modal.tool_length == TOOL_LENGTH_OFFSET_CANCEL) { // G49
 			gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS] = 0.0;
 		}
-		// else G43.1
+		else if(gc_state.modal.tool_length == TOOL_LENGTH_OFFSET_ENABLE && gc_block.values.h > 0) { // G43 H<n>
+			gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS] = TC_GetToolOffset(gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS]);
+		}
+		// else G43 H0 or G43.1
 		if(gc_state.tool_length_offset != gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS])
         {
 			gc_state.tool_length_offset = gc_block.values.xyz[TOOL_LENGTH_OFFSET_AXIS];
@@ -1521,6 +1822,13 @@ uint8_t GC_ExecuteLine(char *line)
 	switch(gc_block.non_modal_command)
 	{
     case NON_MODAL_SET_COORDINATE_DATA:
+		if(gc_block.values.l == 1 || gc_block.values.l == 11)
+		{
+			// Tool table. Takes effect with the next G43 or tool change.
+			Settings_WriteToolData(coord_select, &tool_data);
+			break;
+		}
+
 		Settings_WriteCoordData(coord_select,gc_block.values.ijk);
 		// Update system coordinate system if currently active.
 		if(gc_state.modal.coord_select == coord_select)
@@ -1543,6 +1851,26 @@ uint8_t GC_ExecuteLine(char *line)
 		memcpy(gc_state.position, gc_block.values.ijk, N_AXIS*sizeof(float));
 		break;
 
+    case NON_MODAL_POCKET_CW: case NON_MODAL_POCKET_CCW:
+		// Rapid to the pocket center at current depth, like a canned cycle. Then mill the pocket.
+		if(axis_words & (BIT(axis_0)|BIT(axis_1)))
+		{
+			float center[N_AXIS];
+
+			memcpy(center, gc_state.position, sizeof(center));
+			center[axis_0] = gc_block.values.xyz[axis_0];
+			center[axis_1] = gc_block.values.xyz[axis_1];
+
+			pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
+			MC_Line(center, pl_data);
+			pl_data->condition &= ~PL_COND_FLAG_RAPID_MOTION;
+			memcpy(gc_state.position, center, sizeof(center));
+		}
+
+		MC_CircularPocket(gc_block.values.xyz, pl_data, gc_state.position, gc_block.values.ijk[X_AXIS], gc_block.values.q,
+			gc_block.values.ijk[Z_AXIS], axis_0, axis_1, axis_linear, gc_block.non_modal_command == NON_MODAL_POCKET_CW);
+		break;
+
     case NON_MODAL_SET_HOME_0:
 		Settings_WriteCoordData(SETTING_INDEX_G28, gc_state.position);
 		break;
@@ -1567,6 +1895,11 @@ uint8_t GC_ExecuteLine(char *line)
 	// NOTE: Commands G10,G28,G30,G92 lock out and prevent axis words from use in motion modes.
 	// Enter motion modes only if there are axis words or a motion mode command word in the block.
 	gc_state.modal.motion = gc_block.modal.motion;
+	if(!IS_CANNED_CYCLE(gc_state.modal.motion))
+	{
+		// Sticky cycle words end with the cycle (G80 or other motion mode)
+		gc_state.cycle_words = 0;
+	}
 	if(gc_state.modal.motion != MOTION_MODE_NONE)
     {
 		if(axis_command == AXIS_COMMAND_MOTION_MODE)
@@ -1586,7 +1919,7 @@ uint8_t GC_ExecuteLine(char *line)
 				MC_Arc(gc_block.values.xyz, pl_data, gc_state.position, gc_block.values.ijk, gc_block.values.r,
 				axis_0, axis_1, axis_linear, BIT_IS_TRUE(gc_parser_flags, GC_PARSER_ARC_IS_CLOCKWISE));
 			}
-			else if(gc_state.modal.motion == MOTION_MODE_DRILL || gc_state.modal.motion == MOTION_MODE_DRILL_DWELL || gc_state.modal.motion == MOTION_MODE_DRILL_PECK)
+			else if(IS_CANNED_CYCLE(gc_state.modal.motion))
             {
                 float xyz[N_AXIS] = {0.0};
                 float clear_z = gc_block.values.r + gc_state.coord_system[Z_AXIS] + gc_state.coord_offset[Z_AXIS];
@@ -1612,7 +1945,7 @@ uint8_t GC_ExecuteLine(char *line)
                     return STATUS_GCODE_INVALID_TARGET;
                 }
 
-                //-- [G81 - G83] --//
+                //-- [G73, G81 - G89] --//
 
                 // 0. Check if old_z < clear_z
                 if(old_xyz[Z_AXIS] < clear_z)
@@ -1636,6 +1969,14 @@ uint8_t GC_ExecuteLine(char *line)
                     gc_block.values.l = 1;
                 }
 
+                // Retract height after each hole
+                float retract_z = clear_z;
+                if((gc_state.modal.retract == RETRACT_OLD_Z) && clear_z < old_xyz[Z_AXIS])
+                {
+                    //-- G98 --//
+                    retract_z = old_xyz[Z_AXIS];
+                }
+
                 for(uint8_t repeat = 0; repeat < gc_block.values.l; repeat++)
                 {
                     // 1. Rapid move to XY (XY)
@@ -1649,21 +1990,15 @@ uint8_t GC_ExecuteLine(char *line)
                     pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
                     MC_Line(xyz, pl_data);
 
-                    if(gc_state.modal.motion != MOTION_MODE_DRILL_PECK)
+                    if(gc_state.modal.motion == MOTION_MODE_DRILL_PECK || gc_state.modal.motion == MOTION_MODE_DRILL_CHIP_BREAK)
                     {
-						//-- G81 -- G82 --//
-                        // 3. Move the Z-axis at the current feed rate to the Z position.
-                        pl_data->condition &= ~PL_COND_FLAG_RAPID_MOTION;   // Clear rapid move
-                        xyz[Z_AXIS] = gc_block.values.xyz[Z_AXIS];
-                        MC_Line(xyz, pl_data);
-                    }
-                    else
-                    {
-                        //-- G83 --//
-                        for(float curr_z = clear_z - gc_block.values.q; curr_z >= gc_block.values.xyz[Z_AXIS] - 0.001; curr_z -= gc_block.values.q)
+                        //-- G73 -- G83 --//
+                        float curr_z = clear_z;
+                        while(curr_z > gc_block.values.xyz[Z_AXIS])
                         {
-                            // Check if target depth exceeds final depth
-                            if(curr_z < gc_block.values.xyz[Z_AXIS])
+                            // Don't go deeper than final depth
+                            curr_z -= gc_block.values.q;
+                            if(curr_z < gc_block.values.xyz[Z_AXIS] + 0.001)
                             {
                                 curr_z = gc_block.values.xyz[Z_AXIS];
                             }
@@ -1673,43 +2008,99 @@ uint8_t GC_ExecuteLine(char *line)
                             xyz[Z_AXIS] = curr_z;
                             MC_Line(xyz, pl_data);
 
-                            // Rapid move to R
-                            xyz[Z_AXIS] = clear_z;
-                            pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
-                            MC_Line(xyz, pl_data);
+                            if(curr_z <= gc_block.values.xyz[Z_AXIS])
+                            {
+                                // Final depth, retract below
+                                break;
+                            }
 
-                            // Rapid move to bottom of hole (backed off a bit)
-                            xyz[Z_AXIS] = curr_z + 0.4;
                             pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
-                            MC_Line(xyz, pl_data);
+                            if(gc_state.modal.motion == MOTION_MODE_DRILL_PECK)
+                            {
+                                // Rapid move to R to clear chips
+                                xyz[Z_AXIS] = clear_z;
+                                MC_Line(xyz, pl_data);
+
+                                // Rapid move to bottom of hole (backed off a bit)
+                                xyz[Z_AXIS] = curr_z + CANNED_CYCLE_PECK_CLEARANCE;
+                                MC_Line(xyz, pl_data);
+                            }
+                            else
+                            {
+                                // Short retract to break the chip. Next peck starts from the bottom.
+                                xyz[Z_AXIS] = curr_z + CANNED_CYCLE_CHIP_BREAK;
+                                MC_Line(xyz, pl_data);
+                            }
                         }
                     }
-
-                    if(gc_state.modal.motion == MOTION_MODE_DRILL_DWELL)
+                    else
                     {
-                        //-- G82 --//
-                        MC_Dwell(gc_block.values.p);
+                        //-- G81 -- G82 -- G85 -- G86 -- G89 --//
+                        // 3. Move the Z-axis at the current feed rate to the Z position.
+                        pl_data->condition &= ~PL_COND_FLAG_RAPID_MOTION;   // Clear rapid move
+                        xyz[Z_AXIS] = gc_block.values.xyz[Z_AXIS];
+                        MC_Line(xyz, pl_data);
                     }
 
-                    // 4. The Z-axis does a rapid move to clear Z.
-                    if((gc_state.modal.retract == RETRACT_OLD_Z) && clear_z < old_xyz[Z_AXIS])
+                    if(gc_block.values.p > 0.0 && (gc_state.modal.motion == MOTION_MODE_DRILL_DWELL || gc_state.modal.motion == MOTION_MODE_BORE_DWELL ||
+                                                   gc_state.modal.motion == MOTION_MODE_BORE_SPINDLE_STOP))
                     {
-						//-- G98 --//
-                        // Retract to OLD_Z
-                        xyz[Z_AXIS] = old_xyz[Z_AXIS];
+                        //-- G82 -- G86 -- G89 --//
+                        // Dwell is queued in the planner, the buffer keeps running.
+                        MC_BufferDwell(gc_block.values.p, pl_data);
                     }
-                    else
+
+                    // 4. Retract Z
+                    if(gc_state.modal.motion == MOTION_MODE_BORE || gc_state.modal.motion == MOTION_MODE_BORE_DWELL)
                     {
-						//-- G99 --//
-                        // Retract to r
+                        //-- G85 -- G89 --//
+                        // Feed out to R, then rapid to old Z (G98)
                         xyz[Z_AXIS] = clear_z;
+                        MC_Line(xyz, pl_data);
+
+                        if(retract_z > clear_z)
+                        {
+                            xyz[Z_AXIS] = retract_z;
+                            pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
+                            MC_Line(xyz, pl_data);
+                        }
                     }
+                    else if(gc_state.modal.motion == MOTION_MODE_BORE_SPINDLE_STOP)
+                    {
+                        //-- G86 --//
+                        // Spindle stops with the retract block and starts again after it
+                        uint8_t spindle = pl_data->condition & PL_COND_SPINDLE_MASK;
 
-                    pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
-                    MC_Line(xyz, pl_data);
+                        xyz[Z_AXIS] = retract_z;
+                        pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
+                        pl_data->condition &= ~PL_COND_SPINDLE_MASK;
+                        MC_Line(xyz, pl_data);
+
+                        pl_data->condition |= spindle;
+                        if(spindle)
+                        {
+                            // Spin up before moving on
+                            MC_BufferDwell(CANNED_CYCLE_SPINDLE_DELAY, pl_data);
+                        }
+                    }
+                    else
+                    {
+                        //-- G73 -- G81 -- G82 -- G83 --//
+                        xyz[Z_AXIS] = retract_z;
+                        pl_data->condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
+                        MC_Line(xyz, pl_data);
+                    }
                 }
+
                 // Update position
                 memcpy(gc_block.values.xyz, xyz, N_AXIS*sizeof(float));
+
+                // Store words for following holes of this cycle
+                if(cycle_words & BIT(WORD_P)) { gc_state.cycle.p = cycle_values.p; }
+                if(cycle_words & BIT(WORD_Q)) { gc_state.cycle.q = cycle_values.q; }
+                if(cycle_words & BIT(WORD_R)) { gc_state.cycle.r = cycle_values.r; }
+                if(cycle_words & BIT(WORD_Z)) { gc_state.cycle.xyz[Z_AXIS] = cycle_values.xyz[Z_AXIS]; }
+                gc_state.cycle_words |= cycle_words;
             }
 			else
 			{
@@ -1757,6 +2148,7 @@ uint8_t GC_ExecuteLine(char *line)
 			// and [M-code 7,8,9] reset to [G1,G17,G90,G94,G40,G54,M5,M9,M48]. The remaining modal groups
 			// [G-code 4,6,8,10,13,14,15] and [M-code 4,5,6] and the modal words [F,S,T,H] do not reset.
 			gc_state.modal.motion = MOTION_MODE_LINEAR;
+			gc_state.cycle_words = 0;
 			gc_state.modal.plane_select = PLANE_SELECT_XY;
 			gc_state.modal.distance = DISTANCE_MODE_ABSOLUTE;
 			gc_state.modal.feed_rate = FEED_RATE_MODE_UNITS_PER_MIN;
@@ -1790,12 +2182,17 @@ uint8_t GC_ExecuteLine(char *line)
 				Spindle_SetState(SPINDLE_DISABLE, 0.0);
 				Coolant_SetState(COOLANT_DISABLE);
 			}
+			// Subroutines are defined per program
+			OWord_Clear();
 			Report_FeedbackMessage(MESSAGE_PROGRAM_END);
 		}
 
 		gc_state.modal.program_flow = PROGRAM_FLOW_RUNNING; // Reset program flow.
 	}
 
+	// Parameters assigned in this line
+	Expr_Assign();
+
 	// TODO: % to denote start of program.
 
 	return STATUS_OK;
@@ -64,6 +64,8 @@
 #define NON_MODAL_NO_ACTION 				0 // (Default: Must be zero)
 #define NON_MODAL_DWELL 					4 // G4 (Do not alter value)
 #define NON_MODAL_SET_COORDINATE_DATA 		10 // G10 (Do not alter value)
+#define NON_MODAL_POCKET_CW 				12 // G12 (Do not alter value)
+#define NON_MODAL_POCKET_CCW 				13 // G13 (Do not alter value)
 #define NON_MODAL_GO_HOME_0 				28 // G28 (Do not alter value)
 #define NON_MODAL_SET_HOME_0 				38 // G28.1 (Do not alter value)
 #define NON_MODAL_GO_HOME_1 				30 // G30 (Do not alter value)
@@ -86,6 +88,10 @@
 #define MOTION_MODE_DRILL                   81  // G81
 #define MOTION_MODE_DRILL_DWELL             82  // G82
 #define MOTION_MODE_DRILL_PECK              83  // G83
+#define MOTION_MODE_DRILL_CHIP_BREAK        73  // G73
+#define MOTION_MODE_BORE                    85  // G85
+#define MOTION_MODE_BORE_SPINDLE_STOP       86  // G86
+#define MOTION_MODE_BORE_DWELL              89  // G89
 
 // Modal Group G2: Plane select
 #define PLANE_SELECT_XY 					0 // G17 (Default: Must be zero)
@@ -137,6 +143,7 @@
 // Modal Group G8: Tool length offset
 #define TOOL_LENGTH_OFFSET_CANCEL 			0 // G49 (Default: Must be zero)
 #define TOOL_LENGTH_OFFSET_ENABLE_DYNAMIC 	1 // G43.1
+#define TOOL_LENGTH_OFFSET_ENABLE 			2 // G43
 
 
 // Modal Group G12: Active work coordinate system
@@ -157,6 +164,7 @@
 #define WORD_Y		11
 #define WORD_Z		12
 #define WORD_Q      13
+#define WORD_H      14
 
 // Define g-code parser position updating flags
 #define GC_UPDATE_POS_TARGET	0 // Must be zero
@@ -187,6 +195,11 @@
 #define GC_PARSER_LASER_DISABLE         BIT(6)
 #define GC_PARSER_LASER_ISMOTION        BIT(7)
 
+// NOTE: Max line number is defined by the g-code standard to be 99999. It seems to be an
+// arbitrary value, and some GUIs may require more. So we increased it based on a max safe
+// value when converting a float (7.2 digit precision)s to an integer.
+#define MAX_LINE_NUMBER 				10000000
+
 
 // NOTE: When this struct is zeroed, the above defines set the defaults for the system.
 typedef struct {
@@ -198,7 +211,7 @@ typedef struct {
 	// uint8_t distance_arc; // {G91.1} NOTE: Don't track. Only default supported.
 	uint8_t plane_select;    // {G17,G18,G19}
 	// uint8_t cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
-	uint8_t tool_length;     // {G43.1,G49}
+	uint8_t tool_length;     // {G43,G43.1,G49}
 	uint8_t coord_select;    // {G54,G55,G56,G57,G58,G59}
 	// uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
 	uint8_t program_flow;    // {M0,M1,M2,M30}
@@ -209,6 +222,7 @@ typedef struct {
 
 typedef struct {
 	float f;         // Feed
+	uint8_t h;       // G43 tool length offset
 	float ijk[3];    // I,J,K Axis arc offsets
 	uint8_t l;       // G10 or canned cycles parameters
 	int32_t n;       // Line number
@@ -225,7 +239,7 @@ typedef struct {
 
 	float spindle_speed;          	// RPM
 	float feed_rate;              	// Millimeters/min
-	uint8_t tool;                 	// Tracks tool number. NOT USED.
+	uint8_t tool;                 	// Tracks tool number. Selects tool table entry for tool change and G43.
 	int32_t line_number;          	// Last line number sent
 
 	float position[N_AXIS];       	// Where the interpreter considers the tool to be at this point in the code
@@ -234,6 +248,9 @@ typedef struct {
 	float coord_offset[N_AXIS];   	// Retains the G92 coordinate offset (work coordinates) relative to
 									// machine zero in mm. Non-persistent. Cleared upon reset and boot.
 	float tool_length_offset;      	// Tracks tool length offset value when enabled.
+
+	GC_Values_t cycle;             	// Canned cycle words R, Q, P and Z as programmed. Sticky while a cycle is active.
+	uint16_t cycle_words;          	// Value word bits of the stored cycle words
 } Parser_State_t;
 
 typedef struct {
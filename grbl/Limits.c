@@ -29,6 +29,7 @@
 #include "Protocol.h"
 #include "Limits.h"
 #include "GPIO.h"
+#include "Recorder.h"
 
 #include "System32.h"
 
@@ -70,6 +71,12 @@ uint8_t Limits_GetState(void)
 {
 	uint8_t limit_state = 0;
 
+#ifdef ENABLE_RECORDER
+	if(Recorder_GetState() == REC_STATE_REPLAY) {
+		return Recorder_GetLimitState();
+	}
+#endif
+
 	limit_state = (GPIO_ReadInputDataBit(GPIO_LIM_X_PORT, GPIO_LIM_X_PIN)<<X_LIMIT_BIT);
 	#ifdef DUAL_X_AXIS
         limit_state |= (GPIO_ReadInputDataBit(GPIO_LIM_X2_PORT, GPIO_LIM_X2_PIN)<<X2_LIMIT_BIT);
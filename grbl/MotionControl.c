@@ -32,6 +32,7 @@
 #include "Report.h"
 #include "CoolantControl.h"
 #include "MotionControl.h"
+#include "Benchmark.h"
 #include "defaults.h"
 
 
@@ -43,6 +44,8 @@ static float target_prev[N_AXIS] = {0.0};
 static uint8_t dir_negative[N_AXIS] = {DIR_NEGATIV};
 static uint8_t backlash_enable = 0;
 
+static uint8_t MC_WaitForBuffer(void);
+
 
 void MC_Init(void)
 {
@@ -120,6 +123,9 @@ void MC_Line(float *target, Planner_LineData_t *pl_data)
 
 	// If the buffer is full: good! That means we are well ahead of the robot.
 	// Remain in this loop until there is room in the buffer.
+#ifdef ENABLE_BENCHMARK
+	uint32_t cycles = Benchmark_GetCycles();
+#endif
 	do {
 		Protocol_ExecuteRealtime(); // Check for any run-time commands
 
@@ -136,6 +142,9 @@ void MC_Line(float *target, Planner_LineData_t *pl_data)
 			break;
 		}
 	} while(1);
+#ifdef ENABLE_BENCHMARK
+	Benchmark_Add(BENCH_PLANNER_WAIT, Benchmark_GetCycles() - cycles);
+#endif
 
 #ifdef ENABLE_BACKLASH_COMPENSATION
     pl_backlash.backlash_motion = 1;
@@ -179,6 +188,9 @@ void MC_Line(float *target, Planner_LineData_t *pl_data)
     memcpy(target_prev, target, N_AXIS*sizeof(float));
 
     // Backlash move needs a slot in planner buffer, so we have to check again, if planner is free
+#ifdef ENABLE_BENCHMARK
+	cycles = Benchmark_GetCycles();
+#endif
     do {
 		Protocol_ExecuteRealtime(); // Check for any run-time commands
 
@@ -195,6 +207,9 @@ void MC_Line(float *target, Planner_LineData_t *pl_data)
 			break;
 		}
 	} while(1);
+#ifdef ENABLE_BENCHMARK
+	Benchmark_Add(BENCH_PLANNER_WAIT, Benchmark_GetCycles() - cycles);
+#endif
 #else
 	(void)backlash_update;
 	(void)pl_backlash;
@@ -333,6 +348,93 @@ void MC_Arc(float *target, Planner_LineData_t *pl_data, float *position, float *
 }
 
 
+// Circular pocket, helical bore and spiral entry (G12/G13). The tool starts at the center, given by
+// position. target holds the depth on axis_linear, which is reached on a helix with the given pitch.
+// With a stepover, the pocket is cleared by half circles of growing radius, which alternate their
+// centers by stepover/4 on axis_0. This is a spiral, where each revolution adds one stepover.
+// All moves are arcs around the pocket center, so the planner gets a continuous path.
+void MC_CircularPocket(float *target, Planner_LineData_t *pl_data, float *position, float radius, float stepover,
+  float pitch, uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear, uint8_t is_clockwise_arc)
+{
+	float xyz[N_AXIS];
+	float offset[N_AXIS] = {0.0};
+	float center = position[axis_0];
+	float depth = target[axis_linear];
+	float r = 0.0; // Distance of tool from center on axis_0. Sign gives the side.
+
+	memcpy(xyz, position, sizeof(xyz));
+
+	if(depth != position[axis_linear]) {
+		// Helix at final radius (bore) or at half stepover (pocket)
+		float start = position[axis_linear];
+		r = radius;
+		if(stepover > 0.0 && 0.5*stepover < radius) {
+			r = 0.5*stepover;
+		}
+
+		xyz[axis_0] = center + r;
+		MC_Line(xyz, pl_data);
+		memcpy(position, xyz, sizeof(xyz));
+
+		uint16_t turns = ceil(fabs(start - depth) / pitch);
+		for(uint16_t i = 1; i <= turns; i++) {
+			xyz[axis_linear] = start + (depth - start)*i/turns;
+			offset[axis_0] = -r;
+			MC_Arc(xyz, pl_data, position, offset, r, axis_0, axis_1, axis_linear, is_clockwise_arc);
+			memcpy(position, xyz, sizeof(xyz));
+
+			if(sys.abort) {
+				return;
+			}
+		}
+	}
+
+	if(stepover > 0.0) {
+		// Spiral out to final radius
+		while(fabs(r) < radius) {
+			float next = fabs(r) + 0.5*stepover;
+			if(next > radius) {
+				next = radius;
+			}
+			if(r > 0.0) {
+				next = -next;
+			}
+
+			xyz[axis_0] = center + next;
+			offset[axis_0] = 0.5*(next - r);
+			MC_Arc(xyz, pl_data, position, offset, fabs(offset[axis_0]), axis_0, axis_1, axis_linear, is_clockwise_arc);
+			memcpy(position, xyz, sizeof(xyz));
+			r = next;
+
+			if(sys.abort) {
+				return;
+			}
+		}
+	}
+	else if(r == 0.0) {
+		// Single circle
+		r = radius;
+		xyz[axis_0] = center + r;
+		MC_Line(xyz, pl_data);
+		memcpy(position, xyz, sizeof(xyz));
+	}
+
+	// Full circle at final radius and depth
+	offset[axis_0] = -r;
+	MC_Arc(xyz, pl_data, position, offset, radius, axis_0, axis_1, axis_linear, is_clockwise_arc);
+	memcpy(position, xyz, sizeof(xyz));
+
+	if(sys.abort) {
+		return;
+	}
+
+	// Back to center
+	xyz[axis_0] = center;
+	MC_Line(xyz, pl_data);
+	memcpy(position, xyz, sizeof(xyz));
+}
+
+
 // Execute dwell in seconds.
 void MC_Dwell(float seconds)
 {
@@ -346,6 +448,50 @@ void MC_Dwell(float seconds)
 }
 
 
+void MC_BufferDwell(float seconds, Planner_LineData_t *pl_data)
+{
+	if(MC_WaitForBuffer()) {
+		Planner_BufferDwell(seconds, pl_data, 0);
+	}
+}
+
+
+// Queues a spindle or coolant change of program mode. The machine stops at this point, like with
+// a buffer sync, but the planner keeps the following blocks.
+void MC_BufferAccessory(Planner_LineData_t *pl_data)
+{
+	if(MC_WaitForBuffer()) {
+		Planner_BufferDwell(PROGRAM_ACCESSORY_DWELL, pl_data, 1);
+	}
+}
+
+
+// Waits for room in the buffer, like MC_Line. Returns 0 in check mode or upon abort.
+static uint8_t MC_WaitForBuffer(void)
+{
+	if(sys.state == STATE_CHECK_MODE) {
+		return 0;
+	}
+
+	do {
+		Protocol_ExecuteRealtime();
+
+		if(sys.abort) {
+			return 0;
+		}
+
+		if(Planner_CheckBufferFull()) {
+			Protocol_AutoCycleStart();
+		}
+		else {
+			break;
+		}
+	} while(1);
+
+	return 1;
+}
+
+
 // Perform homing cycle to locate and set machine zero. Only '$H' executes this command.
 // NOTE: There should be no motions in the buffer and Grbl must be in an idle state before
 // executing the homing cycle. This prevents incorrect buffered plans after homing.
@@ -52,9 +52,21 @@ void MC_Line(float *target, Planner_LineData_t *pl_data);
 void MC_Arc(float *target, Planner_LineData_t *pl_data, float *position, float *offset, float radius,
   uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear, uint8_t is_clockwise_arc);
 
+// Circular pocket (G12/G13) around position in the plane of axis_0/axis_1. Enters to the depth of
+// target[axis_linear] on a helix with pitch per turn. Without stepover, a helical bore or single
+// circle of the given radius. Ends at the center.
+void MC_CircularPocket(float *target, Planner_LineData_t *pl_data, float *position, float radius, float stepover,
+  float pitch, uint8_t axis_0, uint8_t axis_1, uint8_t axis_linear, uint8_t is_clockwise_arc);
+
 // Dwell for a specific number of seconds
 void MC_Dwell(float seconds);
 
+// Dwell as planner block. Motions before and after stay buffered. Used by canned cycles.
+void MC_BufferDwell(float seconds, Planner_LineData_t *pl_data);
+
+// Spindle or coolant change as planner block. Used in program mode instead of a buffer sync.
+void MC_BufferAccessory(Planner_LineData_t *pl_data);
+
 // Perform homing cycle to locate machine zero. Requires limit switches.
 void MC_HomigCycle(uint8_t cycle_mask);
 
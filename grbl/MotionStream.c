@@ -0,0 +1,278 @@
+/*
+  MotionStream.c - Decoder for pre-parsed binary motion packets
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "MotionStream.h"
+#include "GCode.h"
+#include "MotionControl.h"
+#include "SpindleControl.h"
+#include "CoolantControl.h"
+#include "Settings.h"
+#include "System.h"
+#include "Report.h"
+#include "Config.h"
+#include "util.h"
+
+
+#if (N_AXIS > 5)
+  #error "Motion stream supports up to 5 axes"
+#endif
+
+
+// The host has already done the work of the parser: Words are decoded, modal groups checked and
+// units converted. A move costs a few varint reads before it goes to MC_Line(). The parser state
+// is updated, as if the moves were text lines.
+static uint8_t MotionStream_ReadVarint(const uint8_t **data, const uint8_t *end, uint32_t *value);
+static void MotionStream_LineData(Planner_LineData_t *pl_data);
+
+
+static inline int32_t MotionStream_Zigzag(uint32_t value)
+{
+	return (int32_t)((value >> 1) ^ (~(value & 1) + 1));
+}
+
+
+static inline float MotionStream_WorkOffset(uint8_t idx)
+{
+	float offset = gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+
+	if(idx == TOOL_LENGTH_OFFSET_AXIS) {
+		offset += gc_state.tool_length_offset;
+	}
+
+	return offset;
+}
+
+
+uint8_t MotionStream_Execute(const uint8_t *data, uint16_t len)
+{
+	const uint8_t *end = data + len;
+	Planner_LineData_t pl_data;
+	// Target is base + count/MS_SCALE. Deltas are summed up as integers, so long
+	// sequences of short moves don't accumulate rounding errors.
+	float base[N_AXIS];
+	int32_t count[N_AXIS] = {0};
+	float target[N_AXIS];
+	uint32_t value;
+	uint8_t idx;
+
+	memcpy(base, gc_state.position, sizeof(base));
+
+	while(data < end) {
+		uint8_t op = *data++;
+		uint8_t mask = op & MS_OP_AXIS_MASK;
+
+		if((op & MS_OP_MASK) <= MS_OP_POSITION) {
+			if(mask >> N_AXIS) {
+				return STATUS_MOTION_INVALID;
+			}
+
+			for(idx = 0; idx < N_AXIS; idx++) {
+				if(mask & BIT(idx)) {
+					if(!MotionStream_ReadVarint(&data, end, &value)) {
+						return STATUS_MOTION_INVALID;
+					}
+
+					if((op & MS_OP_MASK) == MS_OP_POSITION) {
+						base[idx] = MotionStream_WorkOffset(idx);
+						count[idx] = MotionStream_Zigzag(value);
+					}
+					else {
+						count[idx] += MotionStream_Zigzag(value);
+					}
+				}
+			}
+
+			if((op & MS_OP_MASK) == MS_OP_POSITION) {
+				continue;
+			}
+
+			for(idx = 0; idx < N_AXIS; idx++) {
+				target[idx] = base[idx] + (float)count[idx] / MS_SCALE;
+			}
+
+			MotionStream_LineData(&pl_data);
+
+			if((op & MS_OP_MASK) == MS_OP_RAPID_MOVE) {
+				pl_data.condition |= PL_COND_FLAG_RAPID_MOTION;
+				gc_state.modal.motion = MOTION_MODE_SEEK;
+
+				// Laser is off during rapid motions
+				if(BIT_IS_TRUE(settings.flags, BITFLAG_LASER_MODE)) {
+					pl_data.spindle_speed = 0.0;
+				}
+			}
+			else {
+				if(gc_state.feed_rate <= 0.0 || gc_state.modal.feed_rate == FEED_RATE_MODE_INVERSE_TIME) {
+					return STATUS_GCODE_UNDEFINED_FEED_RATE;
+				}
+				gc_state.modal.motion = MOTION_MODE_LINEAR;
+			}
+
+			MC_Line(target, &pl_data);
+
+			if(sys.abort) {
+				return STATUS_OK;
+			}
+
+			memcpy(gc_state.position, target, sizeof(target));
+			gc_state.line_number++;
+
+			continue;
+		}
+
+		switch(op)
+		{
+		case MS_OP_FEED:
+			if(!MotionStream_ReadVarint(&data, end, &value)) {
+				return STATUS_MOTION_INVALID;
+			}
+			gc_state.modal.feed_rate = FEED_RATE_MODE_UNITS_PER_MIN;
+			gc_state.feed_rate = (float)value / MS_SCALE;
+			break;
+
+		case MS_OP_SPEED:
+			if(!MotionStream_ReadVarint(&data, end, &value)) {
+				return STATUS_MOTION_INVALID;
+			}
+			gc_state.spindle_speed = (float)value / MS_SCALE;
+
+			// In laser mode, the speed is passed with the next motion
+			if(gc_state.modal.spindle != SPINDLE_DISABLE && BIT_IS_FALSE(settings.flags, BITFLAG_LASER_MODE)) {
+				if(sys.program_mode) {
+					MotionStream_LineData(&pl_data);
+					MC_BufferAccessory(&pl_data);
+				}
+				else {
+					Spindle_Sync(gc_state.modal.spindle, gc_state.spindle_speed);
+				}
+			}
+			break;
+
+		case MS_OP_LINE:
+			if(!MotionStream_ReadVarint(&data, end, &value)) {
+				return STATUS_MOTION_INVALID;
+			}
+			if(value > MAX_LINE_NUMBER) {
+				return STATUS_GCODE_INVALID_LINE_NUMBER;
+			}
+			gc_state.line_number = value;
+			break;
+
+		case MS_OP_SPINDLE:
+			if(data >= end || *data > 2) {
+				return STATUS_MOTION_INVALID;
+			}
+			value = (*data == 0) ? SPINDLE_DISABLE : ((*data == 1) ? SPINDLE_ENABLE_CW : SPINDLE_ENABLE_CCW);
+			data++;
+
+			if(gc_state.modal.spindle != value) {
+				if(!sys.program_mode) {
+					Spindle_Sync(value, gc_state.spindle_speed);
+				}
+				gc_state.modal.spindle = value;
+
+				if(sys.program_mode) {
+					MotionStream_LineData(&pl_data);
+					MC_BufferAccessory(&pl_data);
+				}
+			}
+			break;
+
+		case MS_OP_COOLANT:
+			if(data >= end || *data > 3) {
+				return STATUS_MOTION_INVALID;
+			}
+			value = ((*data & 1) ? COOLANT_FLOOD_ENABLE : 0) | ((*data & 2) ? COOLANT_MIST_ENABLE : 0);
+			data++;
+
+			if(gc_state.modal.coolant != value) {
+				if(!sys.program_mode) {
+					Coolant_Sync(value);
+				}
+				gc_state.modal.coolant = value;
+
+				if(sys.program_mode) {
+					MotionStream_LineData(&pl_data);
+					MC_BufferAccessory(&pl_data);
+				}
+			}
+			break;
+
+		case MS_OP_DWELL:
+			if(!MotionStream_ReadVarint(&data, end, &value)) {
+				return STATUS_MOTION_INVALID;
+			}
+			if(sys.program_mode) {
+				MotionStream_LineData(&pl_data);
+				MC_BufferDwell((float)value / 1000.0, &pl_data);
+			}
+			else {
+				MC_Dwell((float)value / 1000.0);
+			}
+			break;
+
+		default:
+			return STATUS_MOTION_INVALID;
+		}
+
+		if(sys.abort) {
+			return STATUS_OK;
+		}
+	}
+
+	return STATUS_OK;
+}
+
+
+// Planner data of the current parser state
+static void MotionStream_LineData(Planner_LineData_t *pl_data)
+{
+	memset(pl_data, 0, sizeof(Planner_LineData_t));
+	pl_data->feed_rate = gc_state.feed_rate;
+	pl_data->spindle_speed = gc_state.spindle_speed;
+	pl_data->line_number = gc_state.line_number;
+	pl_data->condition = gc_state.modal.spindle | gc_state.modal.coolant;
+}
+
+
+// Returns 0, if the varint is incomplete or longer than 32 bit
+static uint8_t MotionStream_ReadVarint(const uint8_t **data, const uint8_t *end, uint32_t *value)
+{
+	const uint8_t *p = *data;
+	uint32_t result = 0;
+	uint8_t shift = 0;
+
+	while(p < end && shift < 35) {
+		uint8_t b = *p++;
+
+		result |= (uint32_t)(b & 0x7F) << shift;
+
+		if((b & 0x80) == 0) {
+			*data = p;
+			*value = result;
+
+			return 1;
+		}
+
+		shift += 7;
+	}
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+  MotionStream.h - Decoder for pre-parsed binary motion packets
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef MOTIONSTREAM_H_INCLUDED
+#define MOTIONSTREAM_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// Payload of GrIP MSG_MOTION packets: A sequence of records, each starting with an opcode byte.
+// Coordinates are work coordinates in mm, all values are fixed-point with MS_SCALE units per mm
+// (mm/min, rpm). Varints are LEB128, signed ones zigzag encoded. tools/motion_encoder.py
+// converts g-code into this format.
+#define MS_SCALE					1000
+
+// Bits 0-4: Axis mask. Followed by a signed varint per axis in the mask.
+#define MS_OP_FEED_MOVE				0x00	// G1, delta to last target
+#define MS_OP_RAPID_MOVE			0x20	// G0, delta to last target
+#define MS_OP_POSITION				0x40	// Sets absolute position of following deltas. No motion.
+#define MS_OP_AXIS_MASK				0x1F
+#define MS_OP_MASK					0xE0
+
+// Single opcodes
+#define MS_OP_FEED					0x60	// F: Unsigned varint
+#define MS_OP_SPEED					0x61	// S: Unsigned varint
+#define MS_OP_LINE					0x62	// N: Unsigned varint. Incremented after every move.
+#define MS_OP_SPINDLE				0x63	// 1 byte: 0 = M5, 1 = M3, 2 = M4
+#define MS_OP_COOLANT				0x64	// 1 byte: Bit 0 = M8, bit 1 = M7, 0 = M9
+#define MS_OP_DWELL					0x65	// G4: Unsigned varint in ms
+
+
+/**
+ * \brief   Executes all records of a packet. The first delta is relative to the current
+ *          position of the parser. Motions are passed to MC_Line(), the parser state is kept
+ *          up to date, so text g-code may follow.
+ * \return  STATUS_OK or error code. Records after an error are not executed.
+ */
+uint8_t MotionStream_Execute(const uint8_t *data, uint16_t len);
+
+
+#endif /* MOTIONSTREAM_H_INCLUDED */
@@ -71,6 +71,24 @@ uint8_t Nvm_Write(uint16_t Address, uint8_t *DataIn, uint16_t size)
 #endif
 }
 
+uint8_t Nvm_WriteBlocking(uint16_t Address, uint16_t size)
+{
+#ifdef USE_EXT_EEPROM
+	return M24C0X_WriteBlocking(Address, size);
+#else
+	return EE_ProgramBlocking(Address, size);
+#endif
+}
+
+uint8_t Nvm_WriteFailed(void)
+{
+#ifdef USE_EXT_EEPROM
+	return M24C0X_WriteFailed();
+#else
+	return 0;
+#endif
+}
+
 void Nvm_Update(void)
 {
 #ifdef USE_EXT_EEPROM
@@ -37,6 +37,20 @@ void Nvm_WriteByte(uint16_t Address, uint8_t Data);
 uint8_t Nvm_Read(uint8_t *DataOut, uint16_t Address, uint16_t size);
 uint8_t Nvm_Write(uint16_t Address, uint8_t *DataIn, uint16_t size);
 
+/**
+ * \brief   Checks if a write of 'size' bytes followed by Nvm_Update() stalls the CPU
+ *          long enough to disturb a running motion.
+ * \return  1 if write is blocking, 0 otherwise
+ */
+uint8_t Nvm_WriteBlocking(uint16_t Address, uint16_t size);
+
+/**
+ * \brief   Background writes (external EEPROM) are retried a few times. Reports a write that
+ *          failed anyway, once.
+ * \return  1 if a write failed since the last call, 0 otherwise
+ */
+uint8_t Nvm_WriteFailed(void);
+
 void Nvm_Update(void);
 
 
@@ -0,0 +1,651 @@
+/*
+  OWord.c - O-word subroutines and loops
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string.h>
+#include "OWord.h"
+#include "Expression.h"
+#include "Report.h"
+#include "Config.h"
+#include "util.h"
+
+
+// Lines are stored as the protocol passes them to the parser: Without whitespace and comments,
+// terminated by '\n'. Subroutines stay at the start of the buffer until program end. A top level
+// while/if/repeat block is recorded behind them, executed and discarded.
+// Like in LinuxCNC, control lines belong together by their label: 'O100 while [...]' is closed
+// by 'O100 endwhile'. Jumps search the body of the running subroutine or block for the label.
+#define OWORD_NONE					0xFFFF
+
+enum {KW_NONE = 0, KW_SUB, KW_ENDSUB, KW_CALL, KW_RETURN, KW_WHILE, KW_ENDWHILE, KW_BREAK, KW_CONTINUE,
+	  KW_IF, KW_ELSEIF, KW_ELSE, KW_ENDIF, KW_REPEAT, KW_ENDREPEAT};
+
+// Same order as above. 'ELSEIF' must be checked before 'ELSE'.
+static const char *keywords[] = {
+	"SUB", "ENDSUB", "CALL", "RETURN", "WHILE", "ENDWHILE", "BREAK", "CONTINUE",
+	"IF", "ELSEIF", "ELSE", "ENDIF", "REPEAT", "ENDREPEAT"
+};
+
+typedef struct {
+	char Label[OWORD_LABEL_LENGTH];
+	uint16_t Start;		// First line of body
+	uint16_t End;		// Behind 'endsub'
+} OWord_Sub_t;
+
+typedef struct {
+	uint8_t Call;		// Subroutine or top level block
+	uint16_t Start;
+	uint16_t End;
+	uint16_t Return;
+	float Locals[PARAMETER_LOCALS];		// #1-#30 of caller
+} OWord_Frame_t;
+
+typedef struct {
+	char Label[OWORD_LABEL_LENGTH];
+	uint8_t Depth;
+	uint32_t Count;
+} OWord_Repeat_t;
+
+
+static char ow_buffer[OWORD_BUFFER_SIZE];
+// End of subroutines and end of recorded data
+static uint16_t ow_used = 0;
+static uint16_t ow_top = 0;
+
+static OWord_Sub_t subs[OWORD_MAX_SUBS];
+static uint8_t sub_count = 0;
+
+// Keyword, which closes the recorded subroutine or block. KW_NONE if not recording.
+static uint8_t rec_end = KW_NONE;
+static char rec_label[OWORD_LABEL_LENGTH];
+static uint16_t rec_start = 0;
+
+static OWord_Frame_t stack[OWORD_STACK_DEPTH];
+static uint8_t stack_depth = 0;
+// Next character and start of line being executed
+static uint16_t exec_ptr = 0;
+static uint16_t exec_line = 0;
+
+static OWord_Repeat_t repeats[OWORD_MAX_REPEAT];
+static uint8_t repeat_count = 0;
+
+// If block, whose next elseif/else is evaluated
+static char if_label[OWORD_LABEL_LENGTH];
+
+
+static uint8_t OWord_Parse(const char *line, char *label, uint8_t *keyword);
+static uint8_t OWord_Control(char *line, uint8_t char_counter, const char *label, uint8_t keyword);
+static uint8_t OWord_Call(const char *label, char *line, uint8_t char_counter, uint16_t ret, uint8_t call);
+static void OWord_Pop(void);
+static uint8_t OWord_Store(const char *line);
+static uint16_t OWord_Find(uint16_t from, uint16_t to, const char *label, uint16_t mask, uint8_t last, uint8_t *keyword);
+static uint16_t OWord_NextLine(uint16_t pos);
+static uint8_t OWord_Condition(char *line, uint8_t char_counter, float *value);
+static uint8_t OWord_SkipIf(const char *label);
+
+
+void OWord_Init(void)
+{
+	OWord_Clear();
+}
+
+
+uint8_t OWord_ExecuteLine(char *line)
+{
+	char label[OWORD_LABEL_LENGTH];
+	uint8_t keyword;
+	uint8_t char_counter = OWord_Parse(line, label, &keyword);
+	uint8_t i;
+
+	if(char_counter == 0) {
+		return STATUS_OWORD_INVALID;
+	}
+
+	if(stack_depth) {
+		// Line of a running subroutine or block
+		return OWord_Control(line, char_counter, label, keyword);
+	}
+
+	switch(keyword)
+	{
+	case KW_SUB:
+		for(i = 0; i < sub_count && strcmp(subs[i].Label, label) != 0; i++);
+
+		if(line[char_counter] != 0) {
+			return STATUS_OWORD_INVALID;
+		}
+		if(i == OWORD_MAX_SUBS) {
+			return STATUS_OWORD_OVERFLOW;
+		}
+
+		// Body follows
+		rec_end = KW_ENDSUB;
+		strcpy(rec_label, label);
+		rec_start = ow_top;
+
+		return STATUS_OK;
+
+	case KW_WHILE:
+	case KW_IF:
+	case KW_REPEAT:
+		// Recorded up to the closing line, then executed
+		rec_start = ow_top;
+		if(OWord_Store(line) != STATUS_OK) {
+			return STATUS_OWORD_OVERFLOW;
+		}
+
+		rec_end = (keyword == KW_WHILE) ? KW_ENDWHILE : ((keyword == KW_IF) ? KW_ENDIF : KW_ENDREPEAT);
+		strcpy(rec_label, label);
+
+		return STATUS_OK;
+
+	case KW_CALL:
+		return OWord_Call(label, line, char_counter, OWORD_NONE, 1);
+
+	default:
+		// Closing line without block
+		return STATUS_OWORD_INVALID;
+	}
+}
+
+
+uint8_t OWord_IsRecording(void)
+{
+	return (rec_end != KW_NONE);
+}
+
+
+uint8_t OWord_Record(const char *line)
+{
+	char label[OWORD_LABEL_LENGTH];
+	uint8_t keyword = KW_NONE;
+
+	if(OWord_Parse(line, label, &keyword) && keyword == KW_SUB) {
+		// Subroutines can't be nested
+		OWord_Abort();
+		return STATUS_OWORD_INVALID;
+	}
+
+	if(OWord_Store(line) != STATUS_OK) {
+		OWord_Abort();
+		return STATUS_OWORD_OVERFLOW;
+	}
+
+	if(keyword != rec_end || strcmp(label, rec_label) != 0) {
+		return STATUS_OK;
+	}
+
+	// Complete
+	rec_end = KW_NONE;
+
+	if(keyword == KW_ENDSUB) {
+		uint8_t i;
+
+		// A new definition replaces an existing one. Its memory is freed at program end.
+		for(i = 0; i < sub_count && strcmp(subs[i].Label, label) != 0; i++);
+		if(i == sub_count) {
+			sub_count++;
+		}
+
+		strcpy(subs[i].Label, label);
+		subs[i].Start = rec_start;
+		subs[i].End = ow_top;
+		ow_used = ow_top;
+	}
+	else {
+		stack[0].Call = 0;
+		stack[0].Start = rec_start;
+		stack[0].End = ow_top;
+		stack_depth = 1;
+		exec_ptr = rec_start;
+	}
+
+	return STATUS_OK;
+}
+
+
+int8_t OWord_GetChar(char *c)
+{
+	// End of block
+	while(stack_depth && exec_ptr >= stack[stack_depth-1].End) {
+		OWord_Pop();
+	}
+
+	if(stack_depth == 0) {
+		return -1;
+	}
+
+	if(exec_ptr == stack[stack_depth-1].Start || ow_buffer[exec_ptr-1] == '\n') {
+		exec_line = exec_ptr;
+	}
+
+	*c = ow_buffer[exec_ptr++];
+
+	return 0;
+}
+
+
+uint8_t OWord_IsRunning(void)
+{
+	return (stack_depth != 0);
+}
+
+
+void OWord_Abort(void)
+{
+	// Locals of the top level
+	for(uint8_t i = 0; i < stack_depth; i++) {
+		if(stack[i].Call) {
+			Expr_RestoreLocals(stack[i].Locals);
+			break;
+		}
+	}
+
+	stack_depth = 0;
+	repeat_count = 0;
+	rec_end = KW_NONE;
+	if_label[0] = 0;
+	ow_top = ow_used;
+}
+
+
+void OWord_Clear(void)
+{
+	OWord_Abort();
+
+	sub_count = 0;
+	ow_used = 0;
+	ow_top = 0;
+}
+
+
+// Splits 'O<label><keyword>' into label and keyword. Works on lines terminated by 0 or '\n'.
+// Returns index behind keyword or 0, if the line is no valid O-word.
+static uint8_t OWord_Parse(const char *line, char *label, uint8_t *keyword)
+{
+	uint8_t idx = 1;
+	uint8_t len = 0;
+
+	if(line[0] != 'O') {
+		return 0;
+	}
+
+	if(line[1] == '<') {
+		// Named: O<name>
+		while(line[idx] != '>') {
+			if(line[idx] == 0 || line[idx] == '\n' || len >= OWORD_LABEL_LENGTH-2) {
+				return 0;
+			}
+			label[len++] = line[idx++];
+		}
+		label[len++] = line[idx++];
+	}
+	else {
+		// Numbered: O100. Leading zeros don't matter.
+		while(line[idx] == '0' && line[idx+1] >= '0' && line[idx+1] <= '9') {
+			idx++;
+		}
+		while(line[idx] >= '0' && line[idx] <= '9') {
+			if(len >= OWORD_LABEL_LENGTH-1) {
+				return 0;
+			}
+			label[len++] = line[idx++];
+		}
+	}
+
+	if(len == 0) {
+		return 0;
+	}
+	label[len] = 0;
+
+	for(uint8_t i = 0; i < sizeof(keywords)/sizeof(keywords[0]); i++) {
+		uint8_t kw_len = strlen(keywords[i]);
+
+		if(strncmp(&line[idx], keywords[i], kw_len) == 0) {
+			*keyword = i + 1;
+
+			return idx + kw_len;
+		}
+	}
+
+	return 0;
+}
+
+
+// Control lines inside a running subroutine or block
+static uint8_t OWord_Control(char *line, uint8_t char_counter, const char *label, uint8_t keyword)
+{
+	OWord_Frame_t *frame = &stack[stack_depth-1];
+	uint16_t pos;
+	uint8_t status;
+	uint8_t kw;
+	float value;
+
+	if(keyword != KW_CALL && keyword != KW_WHILE && keyword != KW_IF && keyword != KW_ELSEIF &&
+	   keyword != KW_REPEAT && line[char_counter] != 0) {
+		return STATUS_OWORD_INVALID;
+	}
+
+	switch(keyword)
+	{
+	case KW_CALL:
+		return OWord_Call(label, line, char_counter, exec_ptr, 1);
+
+	case KW_ENDSUB:
+	case KW_RETURN:
+		if(!frame->Call) {
+			return STATUS_OWORD_INVALID;
+		}
+		OWord_Pop();
+		break;
+
+	case KW_WHILE:
+		status = OWord_Condition(line, char_counter, &value);
+		if(status != STATUS_OK) {
+			return status;
+		}
+
+		if(value == 0.0) {
+			pos = OWord_Find(exec_ptr, frame->End, label, BIT(KW_ENDWHILE), 0, 0);
+			if(pos == OWORD_NONE) {
+				return STATUS_OWORD_INVALID;
+			}
+			exec_ptr = OWord_NextLine(pos);
+		}
+		break;
+
+	case KW_ENDWHILE:
+		// Evaluate condition again
+		pos = OWord_Find(frame->Start, exec_line, label, BIT(KW_WHILE), 1, 0);
+		if(pos == OWORD_NONE) {
+			return STATUS_OWORD_INVALID;
+		}
+		exec_ptr = pos;
+		break;
+
+	case KW_BREAK:
+	case KW_CONTINUE:
+		pos = OWord_Find(exec_ptr, frame->End, label, BIT(KW_ENDWHILE) | BIT(KW_ENDREPEAT), 0, &kw);
+		if(pos == OWORD_NONE) {
+			return STATUS_OWORD_INVALID;
+		}
+
+		if(keyword == KW_CONTINUE) {
+			// Closing line jumps back or counts the repetition
+			exec_ptr = pos;
+		}
+		else {
+			exec_ptr = OWord_NextLine(pos);
+
+			if(kw == KW_ENDREPEAT && repeat_count) {
+				repeat_count--;
+			}
+		}
+		break;
+
+	case KW_IF:
+		status = OWord_Condition(line, char_counter, &value);
+		if(status != STATUS_OK) {
+			return status;
+		}
+
+		if(value == 0.0) {
+			return OWord_SkipIf(label);
+		}
+		break;
+
+	case KW_ELSEIF:
+		if(strcmp(if_label, label) == 0) {
+			// Previous branches were false
+			if_label[0] = 0;
+
+			status = OWord_Condition(line, char_counter, &value);
+			if(status != STATUS_OK) {
+				return status;
+			}
+
+			if(value == 0.0) {
+				return OWord_SkipIf(label);
+			}
+			break;
+		}
+		// Previous branch was executed
+		// No break
+
+	case KW_ELSE:
+		if(keyword == KW_ELSE && strcmp(if_label, label) == 0) {
+			if_label[0] = 0;
+			break;
+		}
+
+		pos = OWord_Find(exec_ptr, frame->End, label, BIT(KW_ENDIF), 0, 0);
+		if(pos == OWORD_NONE) {
+			return STATUS_OWORD_INVALID;
+		}
+		exec_ptr = OWord_NextLine(pos);
+		break;
+
+	case KW_ENDIF:
+		break;
+
+	case KW_REPEAT:
+		status = OWord_Condition(line, char_counter, &value);
+		if(status != STATUS_OK) {
+			return status;
+		}
+
+		if(value < 0.5) {
+			pos = OWord_Find(exec_ptr, frame->End, label, BIT(KW_ENDREPEAT), 0, 0);
+			if(pos == OWORD_NONE) {
+				return STATUS_OWORD_INVALID;
+			}
+			exec_ptr = OWord_NextLine(pos);
+			break;
+		}
+
+		if(repeat_count >= OWORD_MAX_REPEAT) {
+			return STATUS_OWORD_OVERFLOW;
+		}
+
+		strcpy(repeats[repeat_count].Label, label);
+		repeats[repeat_count].Depth = stack_depth;
+		repeats[repeat_count].Count = (uint32_t)(value + 0.5);
+		repeat_count++;
+		break;
+
+	case KW_ENDREPEAT:
+		if(repeat_count == 0 || repeats[repeat_count-1].Depth != stack_depth ||
+		   strcmp(repeats[repeat_count-1].Label, label) != 0) {
+			return STATUS_OWORD_INVALID;
+		}
+
+		if(--repeats[repeat_count-1].Count) {
+			// Start next repetition behind 'repeat'
+			pos = OWord_Find(frame->Start, exec_line, label, BIT(KW_REPEAT), 1, 0);
+			if(pos == OWORD_NONE) {
+				return STATUS_OWORD_INVALID;
+			}
+			exec_ptr = OWord_NextLine(pos);
+		}
+		else {
+			repeat_count--;
+		}
+		break;
+
+	default:
+		// Subroutines can only be defined at top level
+		return STATUS_OWORD_INVALID;
+	}
+
+	return STATUS_OK;
+}
+
+
+// Calls subroutine. Arguments are passed in #1 - #30, the locals of the caller are restored on return.
+static uint8_t OWord_Call(const char *label, char *line, uint8_t char_counter, uint16_t ret, uint8_t call)
+{
+	float args[PARAMETER_LOCALS];
+	uint8_t arg_count = 0;
+	uint8_t status;
+	uint8_t i;
+
+	for(i = 0; i < sub_count && strcmp(subs[i].Label, label) != 0; i++);
+
+	if(i == sub_count) {
+		return STATUS_OWORD_INVALID;
+	}
+	if(stack_depth >= OWORD_STACK_DEPTH) {
+		return STATUS_OWORD_OVERFLOW;
+	}
+
+	// Arguments are evaluated with the locals of the caller
+	while(line[char_counter] != 0) {
+		if(arg_count >= PARAMETER_LOCALS) {
+			return STATUS_OWORD_INVALID;
+		}
+
+		status = Expr_ReadValue(line, &char_counter, &args[arg_count++]);
+		if(status != STATUS_OK) {
+			return status;
+		}
+	}
+
+	OWord_Frame_t *frame = &stack[stack_depth];
+
+	Expr_SaveLocals(frame->Locals);
+	for(uint8_t idx = 0; idx < PARAMETER_LOCALS; idx++) {
+		Expr_SetLocal(idx + 1, (idx < arg_count) ? args[idx] : 0.0);
+	}
+
+	frame->Call = call;
+	frame->Start = subs[i].Start;
+	frame->End = subs[i].End;
+	frame->Return = ret;
+	stack_depth++;
+
+	exec_ptr = frame->Start;
+
+	return STATUS_OK;
+}
+
+
+static void OWord_Pop(void)
+{
+	OWord_Frame_t *frame = &stack[--stack_depth];
+
+	if(frame->Call) {
+		Expr_RestoreLocals(frame->Locals);
+		exec_ptr = frame->Return;
+	}
+
+	// Loops of the frame are left
+	while(repeat_count && repeats[repeat_count-1].Depth > stack_depth) {
+		repeat_count--;
+	}
+
+	if(stack_depth == 0) {
+		// Discard top level block
+		if_label[0] = 0;
+		ow_top = ow_used;
+	}
+}
+
+
+static uint8_t OWord_Store(const char *line)
+{
+	uint16_t len = strlen(line);
+
+	if(ow_top + len + 1 > OWORD_BUFFER_SIZE) {
+		return STATUS_OWORD_OVERFLOW;
+	}
+
+	memcpy(&ow_buffer[ow_top], line, len);
+	ow_top += len;
+	ow_buffer[ow_top++] = '\n';
+
+	return STATUS_OK;
+}
+
+
+// Searches [from, to) for a line with label and one of the keywords in mask. Returns start of
+// first (or last) matching line or OWORD_NONE.
+static uint16_t OWord_Find(uint16_t from, uint16_t to, const char *label, uint16_t mask, uint8_t last, uint8_t *keyword)
+{
+	char lbl[OWORD_LABEL_LENGTH];
+	uint16_t found = OWORD_NONE;
+	uint8_t kw;
+
+	while(from < to) {
+		if(OWord_Parse(&ow_buffer[from], lbl, &kw) && (mask & BIT(kw)) && strcmp(lbl, label) == 0) {
+			found = from;
+			if(keyword) {
+				*keyword = kw;
+			}
+			if(!last) {
+				break;
+			}
+		}
+
+		from = OWord_NextLine(from);
+	}
+
+	return found;
+}
+
+
+static uint16_t OWord_NextLine(uint16_t pos)
+{
+	while(pos < ow_top && ow_buffer[pos++] != '\n');
+
+	return pos;
+}
+
+
+// Reads '[expr]' at end of line
+static uint8_t OWord_Condition(char *line, uint8_t char_counter, float *value)
+{
+	uint8_t status = Expr_ReadValue(line, &char_counter, value);
+
+	if(status == STATUS_OK && line[char_counter] != 0) {
+		return STATUS_OWORD_INVALID;
+	}
+
+	return status;
+}
+
+
+// Continues at next elseif/else of the if block, which is evaluated, or behind endif
+static uint8_t OWord_SkipIf(const char *label)
+{
+	uint8_t kw;
+	uint16_t pos = OWord_Find(exec_ptr, stack[stack_depth-1].End, label, BIT(KW_ELSEIF) | BIT(KW_ELSE) | BIT(KW_ENDIF), 0, &kw);
+
+	if(pos == OWORD_NONE) {
+		return STATUS_OWORD_INVALID;
+	}
+
+	if(kw == KW_ENDIF) {
+		exec_ptr = OWord_NextLine(pos);
+	}
+	else {
+		strcpy(if_label, label);
+		exec_ptr = pos;
+	}
+
+	return STATUS_OK;
+}
@@ -0,0 +1,63 @@
+/*
+  OWord.h - O-word subroutines and loops
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef OWORD_H_INCLUDED
+#define OWORD_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// RAM for subroutine bodies and the loop or if block being executed
+#ifndef OWORD_BUFFER_SIZE
+  #define OWORD_BUFFER_SIZE			4096
+#endif
+#define OWORD_MAX_SUBS				16
+// Nested subroutine calls
+#define OWORD_STACK_DEPTH			8
+// Active repeat loops
+#define OWORD_MAX_REPEAT			8
+#define OWORD_LABEL_LENGTH			16
+
+
+void OWord_Init(void);
+
+/**
+ * \brief   Executes an O-word line (starting with 'O'). Subroutine definitions and top level
+ *          while/if/repeat blocks are recorded until they are complete. Blocks and calls are
+ *          then executed by reading the lines with OWord_GetChar().
+ */
+uint8_t OWord_ExecuteLine(char *line);
+
+// Returns 1, while lines are stored instead of executed
+uint8_t OWord_IsRecording(void);
+// Stores one line of a subroutine or block
+uint8_t OWord_Record(const char *line);
+
+// Next character of the subroutine or block being executed. Returns -1, if nothing is executed.
+int8_t OWord_GetChar(char *c);
+uint8_t OWord_IsRunning(void);
+
+// Cancels execution and recording after an error or reset. Subroutines are kept.
+void OWord_Abort(void);
+// Program end (M2, M30): Also deletes all subroutines
+void OWord_Clear(void);
+
+
+#endif /* OWORD_H_INCLUDED */
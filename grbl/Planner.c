@@ -267,6 +267,38 @@ uint8_t Planner_BufferLine(float *target, Planner_LineData_t *pl_data)
 }
 
 
+uint8_t Planner_BufferDwell(float seconds, Planner_LineData_t *pl_data, uint8_t accessory_sync)
+{
+	Planner_Block_t *block = &block_buffer[block_buffer_head];
+	memset(block, 0, sizeof(Planner_Block_t)); // Zero all block values.
+	block->condition = pl_data->condition & ~PL_COND_MOTION_MASK;
+	block->spindle_speed = pl_data->spindle_speed;
+	block->line_number = pl_data->line_number;
+	block->dwell = seconds;
+	block->accessory_sync = accessory_sync;
+
+	if(seconds <= 0.0) {
+		return PLAN_EMPTY_BLOCK;
+	}
+
+	// No distance to travel. Entry and exit speeds are forced to zero by the zero junction speed,
+	// the acceleration only keeps the profile computations of the segment generator finite.
+	block->acceleration = SOME_LARGE_VALUE;
+	block->rapid_rate = MINIMUM_FEED_RATE;
+	block->programmed_rate = MINIMUM_FEED_RATE;
+
+	// Next motion starts from rest
+	planner.previous_nominal_speed = 0.0;
+
+	block_buffer_head = next_buffer_head;
+	next_buffer_head = Planner_NextBlockIndex(block_buffer_head);
+
+	Planner_Recalculate();
+
+	return PLAN_OK;
+}
+
+
 void Planner_DiscardCurrentBlock(void)
 {
 	if(block_buffer_head != block_buffer_tail) { // Discard non-empty buffer.
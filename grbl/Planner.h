@@ -75,6 +75,9 @@ typedef struct {
 	float spindle_speed;    // Block spindle speed. Copied from pl_line_data.
 
 	uint8_t backlash_motion;
+
+	float dwell;            // Remaining dwell time in (s). Block without motion, if not zero.
+	uint8_t accessory_sync; // Dwell applies spindle direction and coolant of the block (program mode)
 } Planner_Block_t;
 
 
@@ -99,6 +102,11 @@ void Planner_ResetBuffer(void); // Reset buffer only.
 // rate is taken to mean "frequency" and would complete the operation in 1/feed_rate minutes.
 uint8_t Planner_BufferLine(float *target, Planner_LineData_t *pl_data);
 
+// Add a dwell to the buffer. The machine stops, waits for the given time in seconds and continues
+// with the next block, without synchronizing the buffer. Spindle state is taken from pl_data.
+// With accessory_sync, spindle direction and coolant of pl_data are switched when the dwell starts.
+uint8_t Planner_BufferDwell(float seconds, Planner_LineData_t *pl_data, uint8_t accessory_sync);
+
 // Called when the current block is no longer needed. Discards the block and makes the memory
 // availible for new blocks.
 void Planner_DiscardCurrentBlock(void);
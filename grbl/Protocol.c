@@ -19,6 +19,7 @@
   You should have received a copy of the GNU General Public License
   along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
 */
+#include <string.h>
 #include "System.h"
 #include "Report.h"
 #include "Config.h"
@@ -30,12 +31,19 @@
 #include "CoolantControl.h"
 #include "Protocol.h"
 #include "MotionControl.h"
+#include "Recorder.h"
+#include "Spool.h"
+#include "OWord.h"
+#include "MotionStream.h"
+#include "Benchmark.h"
 
 #include "GrIP.h"
 #include "Platform.h"
 #include "ServerTCP.h"
+#include "FIFO_USART.h"
 
 #include "Print.h"
+#include "stm32f4xx_it.h"
 
 
 // Line buffer size from the serial input stream to be executed.
@@ -53,10 +61,74 @@
 #define LINE_FLAG_OVERFLOW 				BIT(0)
 #define LINE_FLAG_COMMENT_PARENTHESES 	BIT(1)
 #define LINE_FLAG_COMMENT_SEMICOLON 	BIT(2)
+#define LINE_FLAG_PROGRAM			 	BIT(3) // '%' line. Rest of line is ignored.
 
 
 static char line[LINE_BUFFER_SIZE]; // Line to be executed. Zero-terminated.
+
+// Characters picked off by ProcessReceive() instead of going to the line buffer
+static inline uint8_t Protocol_IsRealtime(char c)
+{
+	return (c == CMD_RESET || c == CMD_RESET_HARD || c == CMD_STATUS_REPORT || c == CMD_CYCLE_START ||
+			c == CMD_FEED_HOLD || c == CMD_STEPPER_DISABLE || (uint8_t)c > 0x7F);
+}
 static void Protocol_ExecRtSuspend(void);
+static void Protocol_ExecRtCommands(void);
+static int8_t Protocol_GetChar(char *c);
+static uint8_t Protocol_ProgramMode(void);
+// GrIP input: Always with ETH_IF, on serial after '$GRIP=1'. The recorder needs all
+// serial input in text form.
+#if defined(ETH_IF) || !defined(ENABLE_RECORDER)
+  #define PROTOCOL_GRIP
+#endif
+
+#ifdef PROTOCOL_GRIP
+static void Protocol_ReceiveGrIP(void);
+static void Protocol_GrIPRealtime(uint8_t *data, uint16_t len);
+#ifdef ENABLE_RECORDER
+static uint16_t Protocol_GrIPCredits(void);
+#endif
+
+// Payload of GrIP data packet, which is read in place by the main loop
+static uint8_t *grip_data = 0;
+static uint16_t grip_len = 0;
+#ifndef ENABLE_RECORDER
+static void Protocol_ExecuteMotion(void);
+
+// Payload holds binary motion commands (MSG_MOTION)
+static uint8_t grip_motion = 0;
+#endif
+#endif
+
+// Origin of input for response routing. With ETH_IF, serial and TCP run side by side.
+// The recorder merges TCP data into the serial buffer, so its lines can't be told apart.
+#ifdef ETH_IF
+  #define GRIP_ORIGIN		PRINT_ETH
+  #ifdef ENABLE_RECORDER
+    #define FIFO_ORIGIN		PRINT_ALL
+  #else
+    #define FIFO_ORIGIN		PRINT_SERIAL
+  #endif
+#else
+  #define GRIP_ORIGIN		PRINT_SERIAL
+  #define FIFO_ORIGIN		PRINT_SERIAL
+#endif
+
+// Line is read from the job spool
+#define SPOOL_ORIGIN		0x80
+// Line of a running O-word subroutine or block
+#define OWORD_ORIGIN		0x40
+
+// Interface the current line is read from. 0 if no line started.
+static uint8_t line_origin = 0;
+
+#ifdef ETH_IF
+static uint8_t Protocol_ClaimStream(uint8_t origin, const char *cmd);
+
+// Interface, which streams g-code and time of its last line
+static uint8_t stream_owner = 0;
+static uint32_t stream_time = 0;
+#endif
 
 
 /*
@@ -101,11 +173,25 @@ void Protocol_MainLoop(void)
 	uint8_t char_counter = 0;
 	char c;
 
+#ifdef PROTOCOL_GRIP
+	GrIP_SetRealtimeCallback(Protocol_GrIPRealtime);
+#ifdef ENABLE_RECORDER
+	// Host may send as much as fits into the serial buffer
+	GrIP_SetCreditCallback(Protocol_GrIPCredits);
+#endif
+
+	// Drop rest of packet after a reset, like the serial buffer
+	if(grip_len) {
+		grip_len = 0;
+		GrIP_Release();
+	}
+#endif
+	line_origin = 0;
 
 	for(;;) {
 		// Process one line of incoming serial data, as the data becomes available. Performs an
 		// initial filtering by removing spaces and comments and capitalizing all letters.
-		while(Getc(&c) == 0) {
+		while(Protocol_GetChar(&c) == 0) {
 			if((c == '\n') || (c == '\r')) { // End of line reached
 				Protocol_ExecuteRealtime(); // Runtime command check point.
 
@@ -116,6 +202,19 @@ void Protocol_MainLoop(void)
 
 				line[char_counter] = 0; // Set string termination character.
 
+				// Responses go back to where the line came from. Lines of a spooled job or
+				// subroutine are acknowledged silently, errors go to all interfaces.
+				uint8_t spooled = (line_origin == SPOOL_ORIGIN || line_origin == OWORD_ORIGIN);
+				uint8_t origin = spooled ? PRINT_ALL : line_origin;
+				uint8_t status;
+
+				line_origin = 0;
+				Print_SetTarget(origin);
+
+#ifdef ENABLE_BENCHMARK
+				uint32_t cycles = Benchmark_GetCycles();
+#endif
+
 #ifdef REPORT_ECHO_LINE_RECEIVED
 				Report_EchoLineReceived(line);
 #endif
@@ -123,28 +222,62 @@ void Protocol_MainLoop(void)
 				// Direct and execute one line of formatted input, and report status of execution.
 				if(line_flags & LINE_FLAG_OVERFLOW) {
 					// Report line overflow error.
-					Report_StatusMessage(STATUS_OVERFLOW);
+					status = STATUS_OVERFLOW;
+				}
+#ifdef ETH_IF
+				else if(line[0] && !Protocol_ClaimStream(origin, line)) {
+					// Other interface is streaming
+					status = STATUS_STREAM_LOCKED;
 				}
+#endif
 				else if(line[0] == 0) {
 					// Empty or comment line. For syncing purposes.
-					Report_StatusMessage(STATUS_OK);
+					status = STATUS_OK;
 				}
 				else if(line[0] == '$') {
 					// Grbl '$' system command
-					Report_StatusMessage(System_ExecuteLine(line));
+					status = System_ExecuteLine(line);
+				}
+				else if(Spool_GetState() == SPOOL_STATE_RECORD) {
+					// Job upload. Stored instead of executed.
+					status = Spool_Append(line);
 				}
 				else if(sys.state & (STATE_ALARM | STATE_JOG | STATE_TOOL_CHANGE)) {
 					// Everything else is gcode. Block if in alarm or jog mode.
-					Report_StatusMessage(STATUS_SYSTEM_GC_LOCK);
+					status = STATUS_SYSTEM_GC_LOCK;
+				}
+				else if(line[0] == '%') {
+					// Program start or end
+					status = Protocol_ProgramMode();
 				}
 				else {
 					// Parse and execute g-code block.
-					Report_StatusMessage(GC_ExecuteLine(line));
+					status = GC_ExecuteLine(line);
+				}
+
+				if(!spooled) {
+					Report_StatusMessage(status);
+				}
+				else if(status != STATUS_OK) {
+					// Stop job on first error
+					Report_StatusMessage(status);
+					OWord_Abort();
+					if(Spool_GetState() == SPOOL_STATE_RUN) {
+						Spool_Abort();
+					}
+				}
+				if(spooled && !OWord_IsRunning()) {
+					Spool_LineDone();
 				}
 
+#ifdef ENABLE_BENCHMARK
+				Benchmark_Add(BENCH_MAIN_LOOP, Benchmark_GetCycles() - cycles);
+#endif
+
 				// Reset tracking data for next line.
 				line_flags = 0;
 				char_counter = 0;
+				Print_SetTarget(PRINT_ALL);
 
 			}
 			else {
@@ -161,8 +294,8 @@ void Protocol_MainLoop(void)
 					if(c <= ' ') {
 						// Throw away whitepace and control characters
 					}
-					else if(c == '/') {
-					// Block delete NOT SUPPORTED. Ignore character.
+					else if(c == '/' && char_counter == 0) {
+					// Block delete NOT SUPPORTED. Ignore character. Inside the line, it's a division.
 					// NOTE: If supported, would simply need to check the system if block delete is enabled.
 					}
 					else if(c == '(') {
@@ -175,13 +308,13 @@ void Protocol_MainLoop(void)
 					else if(c == ';') {
 						// NOTE: ';' comment to EOL is a LinuxCNC definition. Not NIST.
 						line_flags |= LINE_FLAG_COMMENT_SEMICOLON;
-						// TODO: Install '%' feature
-						// } else if (c == '%') {
-						// Program start-end percent sign NOT SUPPORTED.
-						// NOTE: This maybe installed to tell Grbl when a program is running vs manual input,
-						// where, during a program, the system auto-cycle start will continue to execute
-						// everything until the next '%' sign. This will help fix resuming issues with certain
-						// functions that empty the planner buffer to execute its task on-time.
+					}
+					else if(c == '%' && char_counter == 0) {
+						// Program start-end percent sign. Between the '%' lines, spindle, coolant and dwell
+						// commands are queued in the planner, so the buffer doesn't run empty during a job.
+						// Stored as '%' line for the job spool, everything after it is ignored.
+						line[char_counter++] = c;
+						line_flags |= LINE_FLAG_PROGRAM;
 					}
 					else if(char_counter >= (LINE_BUFFER_SIZE-1)) {
 						// Detect line buffer overflow and set flag.
@@ -197,11 +330,28 @@ void Protocol_MainLoop(void)
 			}
 		}
 
+#ifndef ENABLE_RECORDER
+		// Binary motion packets are executed between lines. A running spooled job or subroutine comes first.
+		if(grip_motion && grip_len && line_origin == 0 && Spool_GetState() != SPOOL_STATE_RUN && !OWord_IsRunning()) {
+			Protocol_ExecuteMotion();
+
+			if(sys.abort) {
+				return;
+			}
+		}
+#endif
+
 		// If there are no more characters in the serial read buffer to be processed and executed,
 		// this indicates that g-code streaming has either filled the planner buffer or has
 		// completed. In either case, auto-cycle start, if enabled, any queued moves.
 		Protocol_AutoCycleStart();
 
+		// Write back changed work offsets
+		Settings_Sync();
+
+		// Fall back to old baud rate, if host doesn't answer at the new one
+		Print_CheckBaud();
+
 		Protocol_ExecuteRealtime();  // Runtime command check point.
 
 		if(sys.abort) {
@@ -214,6 +364,28 @@ void Protocol_MainLoop(void)
 }
 
 
+// '%' line: Toggles program mode. The end is reported, when all motions of the program are executed.
+static uint8_t Protocol_ProgramMode(void)
+{
+	if(!sys.program_mode) {
+		sys.program_mode = 1;
+		Report_FeedbackMessage(MESSAGE_PROGRAM_START);
+
+		return STATUS_OK;
+	}
+
+	Protocol_BufferSynchronize();
+	if(sys.abort) {
+		return STATUS_OK;
+	}
+
+	sys.program_mode = 0;
+	Report_FeedbackMessage(MESSAGE_PROGRAM_DONE);
+
+	return STATUS_OK;
+}
+
+
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void Protocol_BufferSynchronize(void)
@@ -258,22 +430,10 @@ void Protocol_AutoCycleStart(void)
 // limit switches, or the main program.
 void Protocol_ExecuteRealtime(void)
 {
-    RX_Packet_t packet;
-
 	Protocol_ExecRtSystem();
 
-#ifdef ETH_IF
-    GrIP_Update();
-    if(GrIP_Receive(&packet))
-    {
-        for(int i = 0; i < packet.RX_Header.Length; i++)
-        {
-            ProcessReceive(packet.Data[i]);
-        }
-    }
-    ServerTCP_Update();
-#else
-    (void)packet;
+#ifdef PROTOCOL_GRIP
+    Protocol_ReceiveGrIP();
 #endif
 
 	if(sys.suspend) {
@@ -282,10 +442,29 @@ void Protocol_ExecuteRealtime(void)
 }
 
 
-// Executes run-time commands, when required. This function primarily operates as Grbl's state
-// machine and controls the various real-time features Grbl has to offer.
-// NOTE: Do not alter this unless you know exactly what you are doing!
+// Executes run-time commands, when required. Output waiting for a TCP peer, which doesn't read,
+// calls this again from within a command (e.g. an alarm message). Then only the stepper is fed.
 void Protocol_ExecRtSystem(void)
+{
+	static uint8_t active = 0;
+
+	if(active) {
+		if(sys.state & (STATE_CYCLE | STATE_HOLD | STATE_SAFETY_DOOR | STATE_HOMING | STATE_SLEEP| STATE_JOG)) {
+			Stepper_PrepareBuffer();
+		}
+		return;
+	}
+
+	active = 1;
+	Protocol_ExecRtCommands();
+	active = 0;
+}
+
+
+// This function primarily operates as Grbl's state machine and controls the various real-time
+// features Grbl has to offer.
+// NOTE: Do not alter this unless you know exactly what you are doing!
+static void Protocol_ExecRtCommands(void)
 {
 	uint8_t rt_exec; // Temp variable to avoid calling volatile multiple times.
 	rt_exec = sys_rt_exec_alarm; // Copy volatile sys_rt_exec_alarm.
@@ -300,6 +479,7 @@ void Protocol_ExecRtSystem(void)
 		// Halt everything upon a critical event flag. Currently hard and soft limits flag this.
 		if((rt_exec == EXEC_ALARM_HARD_LIMIT) || (rt_exec == EXEC_ALARM_SOFT_LIMIT)) {
 			Report_FeedbackMessage(MESSAGE_CRITICAL_EVENT);
+			Print_Drain();
 			System_ClearExecStateFlag(EXEC_RESET); // Disable any existing reset
 
 			do {
@@ -599,40 +779,26 @@ void Protocol_ExecRtSystem(void)
 			}
 		}
 
-		// NOTE: Since coolant state always performs a planner sync whenever it changes, the current
-		// run state can be determined by checking the parser state.
+		// NOTE: In program mode, coolant changes are queued and the parser state may already be ahead
+		// of the machine. So the override toggles the actual outputs. The parser state is toggled as
+		// well, a queued M7/M8/M9 still sets its own state when the machine gets there.
 		// NOTE: Coolant overrides only operate during IDLE, CYCLE, HOLD, and JOG states. Ignored otherwise.
 		if(rt_exec & (EXEC_COOLANT_FLOOD_OVR_TOGGLE | EXEC_COOLANT_MIST_OVR_TOGGLE)) {
 			if((sys.state == STATE_IDLE) || (sys.state & (STATE_CYCLE | STATE_HOLD | STATE_JOG))) {
-				uint8_t coolant_state = gc_state.modal.coolant;
+				uint8_t toggle = 0;
 #ifdef ENABLE_M7
 				if(rt_exec & EXEC_COOLANT_MIST_OVR_TOGGLE) {
-					if(coolant_state & COOLANT_MIST_ENABLE) {
-						BIT_FALSE(coolant_state,COOLANT_MIST_ENABLE);
-					}
-					else {
-						coolant_state |= COOLANT_MIST_ENABLE;
-					}
+					toggle |= COOLANT_MIST_ENABLE;
 				}
 
 				if(rt_exec & EXEC_COOLANT_FLOOD_OVR_TOGGLE) {
-					if(coolant_state & COOLANT_FLOOD_ENABLE) {
-						BIT_FALSE(coolant_state,COOLANT_FLOOD_ENABLE);
-					}
-					else {
-						coolant_state |= COOLANT_FLOOD_ENABLE;
-					}
+					toggle |= COOLANT_FLOOD_ENABLE;
 				}
 #else
-				if(coolant_state & COOLANT_FLOOD_ENABLE) {
-					BIT_FALSE(coolant_state,COOLANT_FLOOD_ENABLE);
-				}
-				else {
-					coolant_state |= COOLANT_FLOOD_ENABLE;
-				}
+				toggle = COOLANT_FLOOD_ENABLE;
 #endif
-				Coolant_SetState(coolant_state); // Report counter set in coolant_set_state().
-				gc_state.modal.coolant = coolant_state;
+				Coolant_SetState(Coolant_GetState() ^ toggle); // Report counter set in coolant_set_state().
+				gc_state.modal.coolant ^= toggle;
 			}
 		}
 	}
@@ -673,11 +839,20 @@ static void Protocol_ExecRtSuspend(void)
 
 	Planner_Block_t *block = Planner_GetCurrentBlock();
 	uint8_t restore_condition;
-	RX_Packet_t packet;
 
+    // Restore what the machine is doing, not the parser state. In program mode, the parser may already
+    // be past queued spindle and coolant changes.
     float restore_spindle_speed;
     if(block == 0) {
-		restore_condition = (gc_state.modal.spindle | gc_state.modal.coolant);
+		uint8_t spindle_state = Spindle_GetState();
+
+		restore_condition = Coolant_GetState();
+		if(spindle_state == SPINDLE_STATE_CW) {
+			restore_condition |= PL_COND_FLAG_SPINDLE_CW;
+		}
+		else if(spindle_state == SPINDLE_STATE_CCW) {
+			restore_condition |= PL_COND_FLAG_SPINDLE_CCW;
+		}
 		restore_spindle_speed = gc_state.spindle_speed;
     }
     else {
@@ -695,18 +870,8 @@ static void Protocol_ExecRtSuspend(void)
 			return;
 		}
 
-#ifdef ETH_IF
-        GrIP_Update();
-        if(GrIP_Receive(&packet))
-        {
-            for(int i = 0; i < packet.RX_Header.Length; i++)
-            {
-                ProcessReceive(packet.Data[i]);
-            }
-        }
-        ServerTCP_Update();
-#else
-        (void)packet;
+#ifdef PROTOCOL_GRIP
+        Protocol_ReceiveGrIP();
 #endif
 
 		// Block until initial hold is complete and the machine has stopped motion.
@@ -831,7 +996,7 @@ static void Protocol_ExecRtSuspend(void)
 #endif
 
 						// Delayed Tasks: Restart spindle and coolant, delay to power-up, then resume cycle.
-						if(gc_state.modal.spindle != SPINDLE_DISABLE) {
+						if(restore_condition & PL_COND_SPINDLE_MASK) {
 							// Block if safety door re-opened during prior restore actions.
 							if(BIT_IS_FALSE(sys.suspend,SUSPEND_RESTART_RETRACT)) {
 								if(BIT_IS_TRUE(settings.flags, BITFLAG_LASER_MODE)) {
@@ -845,7 +1010,7 @@ static void Protocol_ExecRtSuspend(void)
 							}
 						}
 
-						if(gc_state.modal.coolant != COOLANT_DISABLE) {
+						if(restore_condition & (PL_COND_FLAG_COOLANT_FLOOD | PL_COND_FLAG_COOLANT_MIST)) {
 							// Block if safety door re-opened during prior restore actions.
 							if(BIT_IS_FALSE(sys.suspend, SUSPEND_RESTART_RETRACT)) {
 								// NOTE: Laser mode will honor this delay. An exhaust system is often controlled by this pin.
@@ -890,7 +1055,7 @@ static void Protocol_ExecRtSuspend(void)
 				if(sys.spindle_stop_ovr) {
 					// Handles beginning of spindle stop
 					if(sys.spindle_stop_ovr & SPINDLE_STOP_OVR_INITIATE) {
-					if(gc_state.modal.spindle != SPINDLE_DISABLE) {
+					if(restore_condition & PL_COND_SPINDLE_MASK) {
 						Spindle_SetState(SPINDLE_DISABLE,0.0); // De-energize
 						sys.spindle_stop_ovr = SPINDLE_STOP_OVR_ENABLED; // Set stop override state to enabled, if de-energized.
 					}
@@ -900,7 +1065,7 @@ static void Protocol_ExecRtSuspend(void)
 					// Handles restoring of spindle state
 					}
 					else if(sys.spindle_stop_ovr & (SPINDLE_STOP_OVR_RESTORE | SPINDLE_STOP_OVR_RESTORE_CYCLE)) {
-						if (gc_state.modal.spindle != SPINDLE_DISABLE) {
+						if(restore_condition & PL_COND_SPINDLE_MASK) {
 							Report_FeedbackMessage(MESSAGE_SPINDLE_RESTORE);
 							if(BIT_IS_TRUE(settings.flags, BITFLAG_LASER_MODE)) {
 							// When in laser mode, ignore spindle spin-up delay. Set to turn on laser when cycle starts.
@@ -931,3 +1096,232 @@ static void Protocol_ExecRtSuspend(void)
 		Protocol_ExecRtSystem();
 	}
 }
+
+
+// Returns next character of the input stream. Lines of GrIP data packets are read directly
+// from the packet, which may hold many of them. Serial input comes from the FIFO.
+// A started line is completed from the same interface, before the other one is read.
+static int8_t Protocol_GetChar(char *c)
+{
+	// Subroutines and loops are executed from RAM. They may be called by the spooled job.
+	if((line_origin == 0 || line_origin == OWORD_ORIGIN) && OWord_GetChar(c) == 0) {
+		line_origin = OWORD_ORIGIN;
+
+		return 0;
+	}
+
+	// A spooled job is read at memory speed. Host input waits until it is complete.
+	if((line_origin == 0 || line_origin == SPOOL_ORIGIN) && Spool_GetChar(c) == 0) {
+		line_origin = SPOOL_ORIGIN;
+
+		return 0;
+	}
+
+#ifndef ENABLE_RECORDER
+	while(grip_len && !grip_motion && (line_origin == 0 || line_origin == GRIP_ORIGIN)) {
+		*c = *grip_data++;
+
+		if(--grip_len == 0) {
+			// Packet processed, host may send the next one
+			GrIP_Release();
+		}
+
+		if(Protocol_IsRealtime(*c)) {
+			// Sender didn't use MSG_REALTIME_CMD
+#ifdef ETH_IF
+			if(*c == CMD_STATUS_REPORT) {
+				Print_RequestReport(PRINT_ETH);
+			}
+#endif
+			ProcessReceive(*c);
+			continue;
+		}
+
+		line_origin = GRIP_ORIGIN;
+
+		return 0;
+	}
+
+#ifndef ETH_IF
+	if(Print_SerialGrIP()) {
+		// Serial buffer holds GrIP packets
+		return -1;
+	}
+#endif
+#endif
+
+	if(line_origin && line_origin != FIFO_ORIGIN) {
+		// Wait for rest of line
+		return -1;
+	}
+
+	int8_t ret = Getc(c);
+
+	if(ret == 0) {
+		line_origin = FIFO_ORIGIN;
+	}
+
+	return ret;
+}
+
+
+#ifdef ETH_IF
+// Only one interface streams g-code. Another one may take over once the machine is idle
+// and the owner has been silent for STREAM_LOCK_TIME, so a pendant can jog between jobs.
+// Read-only reports are always accepted. A spool upload stays with the interface that started it.
+static uint8_t Protocol_ClaimStream(uint8_t origin, const char *cmd)
+{
+	static const char *const reports[] = {"$", "$$", "$#", "$G", "$I", "$N", "$SPOOL"};
+
+	if(origin == PRINT_ALL) {
+		return 1;
+	}
+	for(uint8_t i = 0; i < sizeof(reports)/sizeof(reports[0]); i++) {
+		if(strcmp(cmd, reports[i]) == 0) {
+			return 1;
+		}
+	}
+
+	if(stream_owner && stream_owner != origin) {
+		if(!(sys.state == STATE_IDLE || sys.state == STATE_ALARM) || Planner_GetCurrentBlock() ||
+		   Spool_GetState() == SPOOL_STATE_RECORD || (millis() - stream_time) < STREAM_LOCK_TIME) {
+			return 0;
+		}
+	}
+
+	stream_owner = origin;
+	stream_time = millis();
+
+	return 1;
+}
+#endif
+
+
+#ifdef PROTOCOL_GRIP
+// Services the TCP server and takes the next GrIP packet. Realtime packets are executed
+// by Protocol_GrIPRealtime() as soon as they arrive.
+static void Protocol_ReceiveGrIP(void)
+{
+	RX_Packet_t packet;
+
+#ifndef ETH_IF
+	if(!Print_SerialGrIP()) {
+		// Text mode
+		return;
+	}
+#endif
+
+	GrIP_Update();
+
+#ifdef ENABLE_RECORDER
+	// The recorder logs every byte, so data goes through the serial buffer. A packet is
+	// only taken, if it fits. Otherwise it stays in the receive buffer, which holds back the host.
+	if(GrIP_Receive(&packet)) {
+		if(packet.RX_Header.MsgType == MSG_MOTION) {
+			// Binary data can't be logged as serial input
+			Print_SetTarget(GRIP_ORIGIN);
+			Report_StatusMessage(STATUS_MOTION_INVALID);
+			Print_SetTarget(PRINT_ALL);
+			GrIP_Release();
+		}
+		else if(packet.RX_Header.Length <= FifoUsart_Available(STDOUT_NUM)) {
+			for(int i = 0; i < packet.RX_Header.Length; i++) {
+				Recorder_Receive(REC_EVT_GRIP, packet.Data[i]);
+			}
+			GrIP_Release();
+		}
+	}
+#else
+	// Packet stays in the receive buffer until the main loop has read all lines
+	if(grip_len == 0 && GrIP_Receive(&packet)) {
+		if(packet.RX_Header.Length) {
+			grip_data = packet.Data;
+			grip_len = packet.RX_Header.Length;
+			grip_motion = (packet.RX_Header.MsgType == MSG_MOTION);
+		}
+		else {
+			GrIP_Release();
+		}
+	}
+#endif
+
+#ifdef ETH_IF
+	ServerTCP_Update();
+	if(ServerTCP_StatusRequested()) {
+		Print_RequestReport(PRINT_OBSERVER);
+		System_SetExecStateFlag(EXEC_STATUS_REPORT);
+	}
+#endif
+}
+
+
+#ifndef ENABLE_RECORDER
+// Executes a MSG_MOTION packet. Its status is reported like the one of a line.
+static void Protocol_ExecuteMotion(void)
+{
+	uint8_t status;
+
+#ifdef ENABLE_BENCHMARK
+	uint32_t cycles = Benchmark_GetCycles();
+#endif
+
+	Print_SetTarget(GRIP_ORIGIN);
+
+	if(sys.state & (STATE_ALARM | STATE_JOG | STATE_TOOL_CHANGE) || Spool_GetState() == SPOOL_STATE_RECORD ||
+	   OWord_IsRecording()) {
+		// Binary packets can't be spooled or recorded
+		status = STATUS_SYSTEM_GC_LOCK;
+	}
+#ifdef ETH_IF
+	else if(!Protocol_ClaimStream(GRIP_ORIGIN, "")) {
+		// Other interface is streaming
+		status = STATUS_STREAM_LOCKED;
+	}
+#endif
+	else {
+		status = MotionStream_Execute(grip_data, grip_len);
+	}
+
+	// Packet processed, host may send the next one
+	grip_len = 0;
+	GrIP_Release();
+
+	Report_StatusMessage(status);
+	Print_SetTarget(PRINT_ALL);
+
+#ifdef ENABLE_BENCHMARK
+	Benchmark_Add(BENCH_MAIN_LOOP, Benchmark_GetCycles() - cycles);
+#endif
+}
+#endif
+
+
+static void Protocol_GrIPRealtime(uint8_t *data, uint16_t len)
+{
+	for(uint16_t i = 0; i < len; i++) {
+		// Anything else has no business in a realtime packet
+		if(Protocol_IsRealtime(data[i])) {
+#ifdef ETH_IF
+			if(data[i] == CMD_STATUS_REPORT) {
+				Print_RequestReport(PRINT_ETH);
+			}
+#endif
+#ifdef ENABLE_RECORDER
+			Recorder_Receive(REC_EVT_GRIP, data[i]);
+#else
+			ProcessReceive(data[i]);
+#endif
+			// On raw TCP, data is read again by the main loop. Whitespace is ignored there.
+			data[i] = ' ';
+		}
+	}
+}
+
+
+#ifdef ENABLE_RECORDER
+static uint16_t Protocol_GrIPCredits(void)
+{
+	return FifoUsart_Available(STDOUT_NUM);
+}
+#endif
+#endif
@@ -0,0 +1,322 @@
+/*
+  Recorder.c - Record and replay of controller input streams
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "Recorder.h"
+#include "Config.h"
+#include "Report.h"
+#include "Print.h"
+#include "util.h"
+#include "stm32f4xx_it.h"
+
+
+// Every byte, realtime command and pin edge is stored together with the time since the previous
+// event. Replaying feeds the events back at their original time offsets, driven by the 1ms tick.
+// Since the input is identical, the parser, planner and stepper produce the same output.
+static Recorder_Event_t rec_log[RECORDER_BUFFER_SIZE];
+static volatile uint16_t rec_count = 0;
+static volatile uint16_t rec_pos = 0;
+static volatile uint8_t rec_state = REC_STATE_IDLE;
+static volatile uint8_t rec_overflow = 0;
+
+// Time of last recorded event
+static uint32_t rec_last_time = 0;
+// Virtual clock and time of next event during replay
+static volatile uint32_t rec_clock = 0;
+static volatile uint32_t rec_next_time = 0;
+
+static volatile uint8_t rec_limits = 0;
+static volatile uint8_t rec_controls = 0;
+
+
+static void Recorder_Append(uint8_t type, uint8_t data);
+static int8_t Recorder_HexValue(char c);
+
+
+void Recorder_Init(void)
+{
+	rec_count = 0;
+	rec_pos = 0;
+	rec_state = REC_STATE_IDLE;
+	rec_overflow = 0;
+	rec_limits = 0;
+	rec_controls = 0;
+}
+
+
+void Recorder_Start(void)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	rec_count = 0;
+	rec_overflow = 0;
+	rec_limits = 0;
+	rec_controls = 0;
+	rec_last_time = millis();
+	rec_state = REC_STATE_RECORD;
+
+	__set_PRIMASK(primask);
+}
+
+
+void Recorder_Stop(void)
+{
+	rec_state = REC_STATE_IDLE;
+	rec_limits = 0;
+	rec_controls = 0;
+}
+
+
+uint8_t Recorder_Replay(void)
+{
+	if(rec_count == 0) {
+		return 1;
+	}
+
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	rec_pos = 0;
+	rec_clock = 0;
+	rec_next_time = rec_log[0].Delta;
+	rec_limits = 0;
+	rec_controls = 0;
+	rec_state = REC_STATE_REPLAY;
+
+	__set_PRIMASK(primask);
+
+	return 0;
+}
+
+
+uint8_t Recorder_GetState(void)
+{
+	return rec_state;
+}
+
+
+void Recorder_Receive(uint8_t source, char c)
+{
+	if(rec_state == REC_STATE_REPLAY) {
+		// Ignore live input while replaying. A reset cancels the replay.
+		if(c == CMD_RESET) {
+			Recorder_Stop();
+			ProcessReceive(c);
+		}
+		return;
+	}
+
+	if(rec_state == REC_STATE_RECORD) {
+		Recorder_Append(source, c);
+	}
+
+	ProcessReceive(c);
+}
+
+
+void Recorder_LogPins(uint8_t limits, uint8_t controls)
+{
+	if(rec_state != REC_STATE_RECORD) {
+		return;
+	}
+
+	if(limits != rec_limits) {
+		rec_limits = limits;
+		Recorder_Append(REC_EVT_LIMITS, limits);
+	}
+	if(controls != rec_controls) {
+		rec_controls = controls;
+		Recorder_Append(REC_EVT_CONTROL, controls);
+	}
+}
+
+
+uint8_t Recorder_GetLimitState(void)
+{
+	return rec_limits;
+}
+
+
+uint8_t Recorder_GetControlState(void)
+{
+	return rec_controls;
+}
+
+
+void Recorder_Tick(void)
+{
+	if(rec_state != REC_STATE_REPLAY) {
+		return;
+	}
+
+	rec_clock++;
+
+	while(rec_next_time <= rec_clock) {
+		Recorder_Event_t *evt = &rec_log[rec_pos];
+
+		switch(evt->Type)
+		{
+		case REC_EVT_SERIAL:
+		case REC_EVT_GRIP:
+			ProcessReceive((char)evt->Data);
+			break;
+
+		case REC_EVT_LIMITS:
+			rec_limits = evt->Data;
+			break;
+
+		case REC_EVT_CONTROL:
+			rec_controls = evt->Data;
+			break;
+
+		default:
+			// REC_EVT_DELAY: Only advances time
+			break;
+		}
+
+		// Replay may have been cancelled by a replayed reset
+		if(rec_state != REC_STATE_REPLAY) {
+			return;
+		}
+
+		if(++rec_pos >= rec_count) {
+			Recorder_Stop();
+			return;
+		}
+
+		rec_next_time += rec_log[rec_pos].Delta;
+	}
+}
+
+
+void Recorder_Dump(void)
+{
+	uint16_t idx;
+
+	Printf("[REC:%d,%d]\r\n", rec_count, rec_overflow);
+	Print_Flush();
+
+	// Like '$$', the lines can be sent back as they are to load the log again
+	for(idx = 0; idx < rec_count; idx++) {
+		if((idx % 16) == 0) {
+			Printf("$REC+");
+		}
+
+		Printf("%04X%02X%02X", rec_log[idx].Delta, rec_log[idx].Type, rec_log[idx].Data);
+
+		if(((idx % 16) == 15) || (idx == rec_count-1)) {
+			Printf("\r\n");
+			Print_Flush();
+		}
+	}
+}
+
+
+uint8_t Recorder_Load(const char *hex)
+{
+	uint8_t raw[4];
+	uint8_t i;
+	// A bad line is dropped as a whole
+	uint16_t count = rec_count;
+
+	if(rec_state != REC_STATE_IDLE) {
+		return STATUS_IDLE_ERROR;
+	}
+
+	while(*hex) {
+		for(i = 0; i < 8; i++) {
+			int8_t val = Recorder_HexValue(hex[i]);
+
+			if(val < 0) {
+				rec_count = count;
+
+				return STATUS_INVALID_STATEMENT;
+			}
+			if(i & 1) {
+				raw[i/2] |= val;
+			}
+			else {
+				raw[i/2] = val << 4;
+			}
+		}
+
+		if(rec_count >= RECORDER_BUFFER_SIZE) {
+			rec_count = count;
+
+			return STATUS_OVERFLOW;
+		}
+
+		rec_log[rec_count].Delta = ((uint16_t)raw[0] << 8) | raw[1];
+		rec_log[rec_count].Type = raw[2];
+		rec_log[rec_count].Data = raw[3];
+		rec_count++;
+
+		hex += 8;
+	}
+
+	return STATUS_OK;
+}
+
+
+static void Recorder_Append(uint8_t type, uint8_t data)
+{
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	uint32_t now = millis();
+	uint32_t delta = now - rec_last_time;
+
+	rec_last_time = now;
+
+	// Fill gaps which don't fit into 16 bit
+	while(delta > UINT16_MAX && rec_count < RECORDER_BUFFER_SIZE) {
+		rec_log[rec_count].Delta = UINT16_MAX;
+		rec_log[rec_count].Type = REC_EVT_DELAY;
+		rec_log[rec_count].Data = 0;
+		rec_count++;
+		delta -= UINT16_MAX;
+	}
+
+	if(rec_count < RECORDER_BUFFER_SIZE) {
+		rec_log[rec_count].Delta = delta;
+		rec_log[rec_count].Type = type;
+		rec_log[rec_count].Data = data;
+		rec_count++;
+	}
+	else {
+		// Log is full. Stop recording, the beginning of the session is kept.
+		rec_overflow = 1;
+		rec_state = REC_STATE_IDLE;
+	}
+
+	__set_PRIMASK(primask);
+}
+
+
+static int8_t Recorder_HexValue(char c)
+{
+	if(c >= '0' && c <= '9') {
+		return c - '0';
+	}
+	if(c >= 'A' && c <= 'F') {
+		return c - 'A' + 10;
+	}
+
+	return -1;
+}
@@ -0,0 +1,111 @@
+/*
+  Recorder.h - Record and replay of controller input streams
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef RECORDER_H_INCLUDED
+#define RECORDER_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// Number of events the recorder can hold. Each event takes 4 bytes of RAM.
+#ifndef RECORDER_BUFFER_SIZE
+  #define RECORDER_BUFFER_SIZE		4096
+#endif
+
+// Event types
+#define REC_EVT_DELAY				0	// Time filler for gaps longer than 65535 ms
+#define REC_EVT_SERIAL				1	// Byte received on serial interface
+#define REC_EVT_GRIP				2	// Byte received in GrIP packet
+#define REC_EVT_LIMITS				3	// Limit pin state changed
+#define REC_EVT_CONTROL				4	// Control pin state changed
+
+// Recorder states
+#define REC_STATE_IDLE				0
+#define REC_STATE_RECORD			1
+#define REC_STATE_REPLAY			2
+
+
+// Compact log entry. Time is stored relative to the previous event.
+typedef struct __attribute__((packed)) {
+	uint16_t Delta;
+	uint8_t Type;
+	uint8_t Data;
+} Recorder_Event_t;
+
+
+void Recorder_Init(void);
+
+/**
+ * \brief   Starts a new recording. Previously recorded events are discarded.
+ */
+void Recorder_Start(void);
+
+/**
+ * \brief   Stops recording or replay.
+ */
+void Recorder_Stop(void);
+
+/**
+ * \brief   Starts replaying the recorded events on the virtual clock.
+ * \return  0 on success, 1 if log is empty
+ */
+uint8_t Recorder_Replay(void);
+
+uint8_t Recorder_GetState(void);
+
+/**
+ * \brief   Entry point for all received bytes. Logs the byte while recording and passes
+ *          it on to ProcessReceive(). During replay, live input is dropped except for a
+ *          reset, which cancels the replay.
+ * \param   source  REC_EVT_SERIAL or REC_EVT_GRIP
+ * \param   c       Received byte
+ */
+void Recorder_Receive(uint8_t source, char c);
+
+/**
+ * \brief   Logs limit and control pin states. Only state changes are stored.
+ */
+void Recorder_LogPins(uint8_t limits, uint8_t controls);
+
+/**
+ * \brief   Returns replayed pin states. Only valid while replaying.
+ */
+uint8_t Recorder_GetLimitState(void);
+uint8_t Recorder_GetControlState(void);
+
+/**
+ * \brief   Advances the virtual clock by 1ms and releases all due events.
+ *          Must be called from the 1ms system tick.
+ */
+void Recorder_Tick(void);
+
+/**
+ * \brief   Prints recorded events as hex lines.
+ */
+void Recorder_Dump(void);
+
+/**
+ * \brief   Appends events given as hex string (as printed by Recorder_Dump).
+ * \return  Status code
+ */
+uint8_t Recorder_Load(const char *hex);
+
+
+#endif /* RECORDER_H_INCLUDED */
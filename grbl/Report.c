@@ -61,6 +61,15 @@ static void Report_LineFeed(void)
 }
 
 
+// Alarms and messages are also sent to observing clients
+static void Report_NotifyLineFeed(void)
+{
+	Putc('\r');
+	Putc('\n');
+	Print_FlushNotify();
+}
+
+
 static void report_util_feedback_line_feed(void)
 {
 	Putc(']');
@@ -139,9 +148,10 @@ void Report_AlarmMessage(uint8_t alarm_code)
 {
 	Printf("ALARM:");
 	Printf("%d", alarm_code);
-	Report_LineFeed();
+	Report_NotifyLineFeed();
 
-	Delay_ms(200); // Force delay to ensure message clears serial write buffer.
+	// A critical alarm blocks the main loop, don't leave the message staged
+	Print_Drain();
 }
 
 
@@ -199,9 +209,22 @@ void Report_FeedbackMessage(uint8_t message_code)
 	case MESSAGE_SLEEP_MODE:
 		Printf("Sleeping");
 		break;
+
+	case MESSAGE_PROGRAM_START:
+		Printf("Pgm Start");
+		break;
+
+	case MESSAGE_PROGRAM_DONE:
+		Printf("Pgm Done");
+		break;
+
+	case MESSAGE_EEPROM_WRITE_FAIL:
+		Printf("EEPROM write failed");
+		break;
 	}
 
-	report_util_feedback_line_feed();
+	Putc(']');
+	Report_NotifyLineFeed();
 }
 
 
@@ -826,5 +849,7 @@ void Report_RealtimeStatus(void)
 #endif
 
 	Putc('>');
-	Report_LineFeed();
+	Putc('\r');
+	Putc('\n');
+	Print_FlushReport();
 }
@@ -66,6 +66,16 @@
 #define STATUS_GCODE_G43_DYNAMIC_AXIS_ERROR 	37
 #define STATUS_GCODE_MAX_VALUE_EXCEEDED 		38
 
+#define STATUS_STREAM_LOCKED                    39
+#define STATUS_SPOOL_INVALID                    40
+#define STATUS_MOTION_INVALID                   41
+#define STATUS_EXPRESSION_INVALID               42
+#define STATUS_PARAMETER_INVALID                43
+#define STATUS_OWORD_INVALID                    44
+#define STATUS_OWORD_OVERFLOW                   45
+#define STATUS_TOOL_UNKNOWN                     46
+#define STATUS_SPOOL_FLASH_ERROR                47
+
 // Define Grbl alarm codes. Valid values (1-255). 0 is reserved.
 #define ALARM_HARD_LIMIT_ERROR      	EXEC_ALARM_HARD_LIMIT
 #define ALARM_SOFT_LIMIT_ERROR      	EXEC_ALARM_SOFT_LIMIT
@@ -89,6 +99,9 @@
 #define MESSAGE_RESTORE_DEFAULTS 		9
 #define MESSAGE_SPINDLE_RESTORE 		10
 #define MESSAGE_SLEEP_MODE 				11
+#define MESSAGE_PROGRAM_START 			12
+#define MESSAGE_PROGRAM_DONE 			13
+#define MESSAGE_EEPROM_WRITE_FAIL 		14
 
 
 // Prints system status messages.
@@ -31,12 +31,29 @@
 #include "Stepper.h"
 #include "defaults.h"
 #include "Nvm.h"
+#include "Planner.h"
+#include "stm32f4xx_it.h"
 #include <stdint.h>
 #include <string.h>
 
 
 Settings_t settings;
 
+// Coordinate systems, G28 and G30 are kept in RAM and written back by Settings_Sync()
+static float coord_table[SETTING_INDEX_NCOORD+1][N_AXIS];
+static uint16_t coord_dirty = 0;
+static uint16_t coord_invalid = 0;
+static uint8_t tls_dirty = 0;
+// Tool table, index 0 is T1
+static Tool_Data_t tool_table[TOOL_TABLE_SIZE];
+static uint16_t tool_dirty = 0;
+// Time of first unsaved change
+static uint32_t coord_dirty_time = 0;
+
+
+static void Settings_LoadCoordData(void);
+static void Settings_LoadToolData(void);
+
 
 // Method to store startup lines into EEPROM
 void Settings_StoreStartupLine(uint8_t n, char *line)
@@ -61,17 +78,31 @@ void Settings_StoreBuildInfo(char *line)
 }
 
 
-// Method to store coord data parameters into EEPROM
+// Method to store coord data parameters. Data is written to EEPROM later by Settings_Sync().
 void Settings_WriteCoordData(uint8_t coord_select, float *coord_data)
 {
-#ifdef FORCE_BUFFER_SYNC_DURING_EEPROM_WRITE
-    Protocol_BufferSynchronize();
-#endif
+	memcpy(coord_table[coord_select], coord_data, sizeof(float)*N_AXIS);
 
-	uint32_t addr = coord_select*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;
-	Nvm_Write(addr, (uint8_t*)coord_data, sizeof(float)*N_AXIS);
+	if(coord_dirty == 0) {
+		coord_dirty_time = millis();
+	}
+	coord_dirty |= (1 << coord_select);
+}
 
-	Nvm_Update();
+
+// Method to store tool data. Data is written to EEPROM later by Settings_Sync().
+void Settings_WriteToolData(uint8_t tool, const Tool_Data_t *tool_data)
+{
+	if(tool == 0 || tool > TOOL_TABLE_SIZE) {
+		return;
+	}
+
+	memcpy(&tool_table[tool-1], tool_data, sizeof(Tool_Data_t));
+
+	if(coord_dirty == 0 && tool_dirty == 0 && tls_dirty == 0) {
+		coord_dirty_time = millis();
+	}
+	tool_dirty |= (1 << (tool-1));
 }
 
 
@@ -151,6 +182,14 @@ void Settings_Restore(uint8_t restore_flag) {
 		for(idx = 0; idx <= SETTING_INDEX_NCOORD; idx++) {
 			Settings_WriteCoordData(idx, coord_data);
 		}
+
+		Tool_Data_t tool_data;
+
+		memset(&tool_data, 0, sizeof(tool_data));
+
+		for(idx = 1; idx <= TOOL_TABLE_SIZE; idx++) {
+			Settings_WriteToolData(idx, &tool_data);
+		}
 	}
 
 	if(restore_flag & SETTINGS_RESTORE_STARTUP_LINES) {
@@ -204,14 +243,14 @@ uint8_t Settings_ReadBuildInfo(char *line)
 }
 
 
-// Read selected coordinate data from EEPROM. Updates pointed coord_data value.
+// Read selected coordinate data from RAM table. Updates pointed coord_data value.
 uint8_t Settings_ReadCoordData(uint8_t coord_select, float *coord_data)
 {
-	uint32_t addr = coord_select*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;
-	if(!(Nvm_Read((uint8_t*)coord_data, addr, sizeof(float)*N_AXIS))) {
-		// Reset with default zero vector
-		memset(&coord_data, 0.0, sizeof(coord_data));
-		Settings_WriteCoordData(coord_select, coord_data);
+	memcpy(coord_data, coord_table[coord_select], sizeof(float)*N_AXIS);
+
+	if(coord_invalid & (1 << coord_select)) {
+		// Entry was reset to zero vector while loading. Report once.
+		coord_invalid &= ~(1 << coord_select);
 
 		return false;
 	}
@@ -220,6 +259,105 @@ uint8_t Settings_ReadCoordData(uint8_t coord_select, float *coord_data)
 }
 
 
+// Read selected tool from RAM table. Updates pointed tool_data value.
+uint8_t Settings_ReadToolData(uint8_t tool, Tool_Data_t *tool_data)
+{
+	if(tool == 0 || tool > TOOL_TABLE_SIZE) {
+		return false;
+	}
+
+	memcpy(tool_data, &tool_table[tool-1], sizeof(Tool_Data_t));
+
+	return true;
+}
+
+
+// Writes changed coordinate data, tool data and tls position back to EEPROM. Changes are written as soon as the
+// machine is idle, or after SETTINGS_WRITE_DELAY if the write doesn't disturb a running motion.
+void Settings_Sync(void)
+{
+	if(Nvm_WriteFailed()) {
+		// Retried with the next write. Not a response to a line, so it's reported as message.
+		Report_FeedbackMessage(MESSAGE_EEPROM_WRITE_FAIL);
+	}
+
+	if(coord_dirty == 0 && tool_dirty == 0 && tls_dirty == 0) {
+		return;
+	}
+
+	if(sys.state != STATE_IDLE || Planner_GetCurrentBlock()) {
+		if((millis() - coord_dirty_time) < SETTINGS_WRITE_DELAY || Nvm_WriteBlocking(EEPROM_ADDR_PARAMETERS, SETTINGS_COORD_SIZE) ||
+		   Nvm_WriteBlocking(EEPROM_ADDR_TOOL_TABLE, SETTINGS_TOOL_SIZE) ||
+		   (tls_dirty && Nvm_WriteBlocking(EEPROM_ADDR_GLOBAL, sizeof(Settings_t)+1))) {
+			return;
+		}
+	}
+
+	for(uint8_t idx = 0; idx <= SETTING_INDEX_NCOORD; idx++) {
+		if(coord_dirty & (1 << idx)) {
+			uint32_t addr = idx*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;
+			Nvm_Write(addr, (uint8_t*)coord_table[idx], sizeof(float)*N_AXIS);
+		}
+	}
+
+	coord_dirty = 0;
+
+	for(uint8_t idx = 0; idx < TOOL_TABLE_SIZE; idx++) {
+		if(tool_dirty & (1 << idx)) {
+			uint32_t addr = idx*(sizeof(Tool_Data_t)+1) + EEPROM_ADDR_TOOL_TABLE;
+			Nvm_Write(addr, (uint8_t*)&tool_table[idx], sizeof(Tool_Data_t));
+		}
+	}
+
+	tool_dirty = 0;
+
+	if(tls_dirty) {
+		tls_dirty = 0;
+		WriteGlobalSettings();
+	}
+	else {
+		Nvm_Update();
+	}
+}
+
+
+// Loads all coordinate data into RAM table
+static void Settings_LoadCoordData(void)
+{
+	coord_dirty = 0;
+	coord_invalid = 0;
+
+	for(uint8_t idx = 0; idx <= SETTING_INDEX_NCOORD; idx++) {
+		uint32_t addr = idx*(sizeof(float)*N_AXIS+1) + EEPROM_ADDR_PARAMETERS;
+
+		if(!(Nvm_Read((uint8_t*)coord_table[idx], addr, sizeof(float)*N_AXIS))) {
+			// Reset with default zero vector
+			memset(coord_table[idx], 0, sizeof(float)*N_AXIS);
+			coord_invalid |= (1 << idx);
+			coord_dirty |= (1 << idx);
+		}
+	}
+
+	coord_dirty_time = millis();
+}
+
+
+// Loads the tool table into RAM. Unreadable entries are reset to unknown tools.
+static void Settings_LoadToolData(void)
+{
+	tool_dirty = 0;
+
+	for(uint8_t idx = 0; idx < TOOL_TABLE_SIZE; idx++) {
+		uint32_t addr = idx*(sizeof(Tool_Data_t)+1) + EEPROM_ADDR_TOOL_TABLE;
+
+		if(!(Nvm_Read((uint8_t*)&tool_table[idx], addr, sizeof(Tool_Data_t)))) {
+			memset(&tool_table[idx], 0, sizeof(Tool_Data_t));
+			tool_dirty |= (1 << idx);
+		}
+	}
+}
+
+
 // Reads Grbl global settings struct from EEPROM.
 uint8_t ReadGlobalSettings() {
 	// Check version-byte of eeprom
@@ -383,7 +521,11 @@ void Settings_StoreTlsPosition(void)
     memcpy(settings.tls_position, sys_position, sizeof(float)*N_AXIS);
     settings.tls_valid = 1;
 
-    WriteGlobalSettings();
+    // Written back by Settings_Sync()
+    if(coord_dirty == 0 && tool_dirty == 0 && tls_dirty == 0) {
+		coord_dirty_time = millis();
+    }
+    tls_dirty = 1;
 }
 
 
@@ -392,6 +534,9 @@ void Settings_Init(void)
 {
 	Nvm_Init();
 
+	Settings_LoadCoordData();
+	Settings_LoadToolData();
+
 	if(!ReadGlobalSettings()) {
 		Report_StatusMessage(STATUS_SETTING_READ_FAIL);
 		Settings_Restore(SETTINGS_RESTORE_ALL); // Force restore all EEPROM data.
@@ -64,6 +64,7 @@
 // the startup script. The lower half contains the global settings and space for future
 // developments.
 #define EEPROM_ADDR_GLOBAL         			1U
+#define EEPROM_ADDR_TOOL_TABLE     			256U
 #define EEPROM_ADDR_PARAMETERS     			512U
 #define EEPROM_ADDR_STARTUP_BLOCK  			768U
 #define EEPROM_ADDR_BUILD_INFO     			942U
@@ -82,6 +83,25 @@
 #define AXIS_SETTINGS_START_VAL  			100 // NOTE: Reserving settings values >= 100 for axis settings. Up to 255.
 #define AXIS_SETTINGS_INCREMENT  			10  // Must be greater than the number of axis settings
 
+// Size of all coordinate data in EEPROM, including checksums
+#define SETTINGS_COORD_SIZE					((SETTING_INDEX_NCOORD+1)*(sizeof(float)*N_AXIS+1))
+
+// Number of tools in the tool table (T1 - T<TOOL_TABLE_SIZE>)
+#ifndef TOOL_TABLE_SIZE
+	#define TOOL_TABLE_SIZE					16
+#endif
+#if TOOL_TABLE_SIZE > 16
+	#error "TOOL_TABLE_SIZE: Tool table doesn't fit between global settings and parameters"
+#endif
+
+// Size of the tool table in EEPROM, including checksums
+#define SETTINGS_TOOL_SIZE					(TOOL_TABLE_SIZE*(sizeof(Tool_Data_t)+1))
+
+// Maximum time in ms changed coordinate data is kept in RAM before it is written back during motion
+#ifndef SETTINGS_WRITE_DELAY
+	#define SETTINGS_WRITE_DELAY			2000
+#endif
+
 #ifndef SETTINGS_RESTORE_ALL
 	#define SETTINGS_RESTORE_ALL 			0xFF // All bitflags
 #endif
@@ -126,8 +146,21 @@ typedef struct {
 	uint16_t homing_debounce_delay;
 	float homing_pulloff;
 } Settings_t;
+
+// Tool table entry (Stored from byte EEPROM_ADDR_TOOL_TABLE onwards); 13 Bytes
+typedef struct {
+	float length;		// Relative to the tool length sensor reference, see ToolChange.c
+	float diameter;
+	float wear;			// Added to length by G43
+	uint8_t valid;		// Source of length, see TOOL_LENGTH_*. Zero if unknown.
+} Tool_Data_t;
 #pragma pack(pop)
 
+// Measured on the tls. A re-clamped tool has another length, so it's measured again on every tool change.
+#define TOOL_LENGTH_MEASURED				1
+// Set by G10 L1. Not measured, the tool change only applies it.
+#define TOOL_LENGTH_SET						2
+
 
 extern Settings_t settings;
 
@@ -156,12 +189,21 @@ void Settings_StoreBuildInfo(char *line);
 // Reads build info user-defined string
 uint8_t Settings_ReadBuildInfo(char *line);
 
-// Writes selected coordinate data to EEPROM
+// Writes selected coordinate data to RAM table. Persisted by Settings_Sync().
 void Settings_WriteCoordData(uint8_t coord_select, float *coord_data);
 
-// Reads selected coordinate data from EEPROM
+// Reads selected coordinate data from RAM table
 uint8_t Settings_ReadCoordData(uint8_t coord_select, float *coord_data);
 
+// Writes tool data (tool 1 - TOOL_TABLE_SIZE) to RAM table. Persisted by Settings_Sync().
+void Settings_WriteToolData(uint8_t tool, const Tool_Data_t *tool_data);
+
+// Reads tool data from RAM table. Returns false, if tool is out of range.
+uint8_t Settings_ReadToolData(uint8_t tool, Tool_Data_t *tool_data);
+
+// Writes changed coordinate data, tool data and tls position back to EEPROM. Called from main loop.
+void Settings_Sync(void);
+
 // Returns the step pin mask according to Grbl's internal axis numbering
 uint8_t Settings_GetStepPinMask(uint8_t i);
 
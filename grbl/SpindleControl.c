@@ -68,13 +68,13 @@ uint8_t Spindle_GetState(void)
     // Check if PWM is enabled.
 	if(spindle_enabled)
     {
-		/*if(SPINDLE_DIRECTION_PORT & (1<<SPINDLE_DIRECTION_BIT)) {
+		// Direction pin is only set by Spindle_SetDirection()
+		if(GPIO_ReadOutputDataBit(GPIO_SPINDLE_DIR_PORT, GPIO_SPINDLE_DIR_PIN)) {
 			return SPINDLE_STATE_CCW;
 		}
 		else {
 			return SPINDLE_STATE_CW;
-		}*/
-		return SPINDLE_STATE_CW;
+		}
 	}
 
 	return SPINDLE_STATE_DISABLE;
@@ -112,6 +112,18 @@ void Spindle_SetSpeed(uint8_t pwm_value)
 }
 
 
+// Called by Spindle_SetState() and stepper ISR. A disabled spindle keeps its direction.
+void Spindle_SetDirection(uint8_t state)
+{
+	if(state == SPINDLE_ENABLE_CW) {
+		GPIO_ResetBits(GPIO_SPINDLE_DIR_PORT, GPIO_SPINDLE_DIR_PIN);
+	}
+	else if(state == SPINDLE_ENABLE_CCW) {
+		GPIO_SetBits(GPIO_SPINDLE_DIR_PORT, GPIO_SPINDLE_DIR_PIN);
+	}
+}
+
+
 // Called by spindle_set_state() and step segment generator. Keep routine small and efficient.
 uint8_t Spindle_ComputePwmValue(float rpm) // 328p PWM register is 8-bit.
 {
@@ -161,12 +173,7 @@ void Spindle_SetState(uint8_t state, float rpm)
 		Spindle_Stop();
 	}
 	else {
-		if(state == SPINDLE_ENABLE_CW) {
-			GPIO_ResetBits(GPIO_SPINDLE_DIR_PORT, GPIO_SPINDLE_DIR_PIN);
-		}
-		else {
-			GPIO_SetBits(GPIO_SPINDLE_DIR_PORT, GPIO_SPINDLE_DIR_PIN);
-		}
+		Spindle_SetDirection(state);
 
 		// NOTE: Assumes all calls to this function is when Grbl is not moving or must remain off.
 		if(settings.flags & BITFLAG_LASER_MODE) {
@@ -62,6 +62,9 @@ void Spindle_SetState(uint8_t state, float rpm);
 // NOTE: 328p PWM register is 8-bit.
 void Spindle_SetSpeed(uint8_t pwm_value);
 
+// Sets only the direction pin. Called by stepper ISR for queued spindle changes, PWM comes with the segment.
+void Spindle_SetDirection(uint8_t state);
+
 // Computes 328p-specific PWM register value for the given RPM for quick updating.
 uint8_t Spindle_ComputePwmValue(float rpm);
 
@@ -0,0 +1,330 @@
+/*
+  Spool.c - Stores a job in internal flash and runs it locally
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stddef.h>
+#include <string.h>
+#include "Spool.h"
+#include "Report.h"
+#include "Print.h"
+#include "CRC.h"
+#include "eeprom.h"
+#include "util.h"
+
+
+// Lines are stored as the protocol passes them to the parser: Without whitespace and comments,
+// terminated by '\n'. This typically saves a third of the original file size. The header is
+// written last, so an interrupted upload never looks like a valid job.
+#define SPOOL_MAGIC					0x4C4F5053	// "SPOL"
+
+typedef struct {
+	uint32_t Magic;
+	uint32_t Size;
+	uint32_t Lines;
+	uint32_t Crc;
+} Spool_Header_t;
+
+#define SPOOL_DATA_ADDRESS			(SPOOL_START_ADDRESS + sizeof(Spool_Header_t))
+#define SPOOL_DATA_SIZE				(SPOOL_SIZE - sizeof(Spool_Header_t))
+
+
+static uint8_t spool_state = SPOOL_STATE_IDLE;
+
+// Recording
+static uint32_t spool_size = 0;
+static uint32_t spool_lines = 0;
+static uint32_t spool_crc = 0;
+static uint32_t spool_word = 0;
+static uint8_t spool_failed = 0;
+
+// Running
+static const char *run_ptr = 0;
+static const char *run_end = 0;
+static uint32_t run_line = 0;
+
+
+static FLASH_Status Spool_Put(char c);
+static void Spool_Done(void);
+static uint32_t Spool_CalculateCRC(uint32_t size);
+
+
+void Spool_Init(void)
+{
+	spool_state = SPOOL_STATE_IDLE;
+}
+
+
+uint8_t Spool_Start(void)
+{
+	if(spool_state == SPOOL_STATE_RUN) {
+		return STATUS_IDLE_ERROR;
+	}
+
+	FLASH_Unlock();
+	FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_OPERR | FLASH_FLAG_WRPERR | FLASH_FLAG_PGAERR | FLASH_FLAG_PGPERR | FLASH_FLAG_PGSERR);
+
+	FLASH_Status status = FLASH_EraseSector(SPOOL_SECTOR, VOLTAGE_RANGE);
+
+	FLASH_Lock();
+
+	if(status != FLASH_COMPLETE) {
+		spool_state = SPOOL_STATE_IDLE;
+
+		return STATUS_SPOOL_FLASH_ERROR;
+	}
+
+	spool_size = 0;
+	spool_lines = 0;
+	spool_crc = 0;
+	spool_word = 0;
+	spool_failed = 0;
+	spool_state = SPOOL_STATE_RECORD;
+
+	return STATUS_OK;
+}
+
+
+uint8_t Spool_Append(const char *line)
+{
+	uint16_t len = strlen(line);
+	FLASH_Status status = FLASH_COMPLETE;
+
+	if(spool_state != SPOOL_STATE_RECORD) {
+		return STATUS_IDLE_ERROR;
+	}
+	if(spool_failed) {
+		// Nothing is written after a flash error. Upload can't be finished.
+		return STATUS_SPOOL_FLASH_ERROR;
+	}
+	if(spool_size + len + 1 > SPOOL_DATA_SIZE) {
+		// Job doesn't fit. Upload can't be finished.
+		return STATUS_OVERFLOW;
+	}
+
+	FLASH_Unlock();
+
+	for(uint16_t i = 0; i < len && status == FLASH_COMPLETE; i++) {
+		status = Spool_Put(line[i]);
+	}
+	if(status == FLASH_COMPLETE) {
+		status = Spool_Put('\n');
+	}
+
+	FLASH_Lock();
+
+	if(status != FLASH_COMPLETE) {
+		spool_failed = 1;
+
+		return STATUS_SPOOL_FLASH_ERROR;
+	}
+
+	spool_crc = CRC_UpdateCRC32(spool_crc, (const uint8_t*)line, len);
+	spool_crc = CRC_UpdateCRC32(spool_crc, (const uint8_t*)"\n", 1);
+	spool_lines++;
+
+	return STATUS_OK;
+}
+
+
+uint8_t Spool_Finish(void)
+{
+	FLASH_Status status = FLASH_COMPLETE;
+
+	if(spool_state != SPOOL_STATE_RECORD) {
+		return STATUS_IDLE_ERROR;
+	}
+
+	// Recording ends in any case
+	spool_state = SPOOL_STATE_IDLE;
+
+	if(spool_failed) {
+		return STATUS_SPOOL_FLASH_ERROR;
+	}
+
+	FLASH_Unlock();
+
+	// Last partial word. Remaining bytes stay erased.
+	if(spool_size & 3) {
+		spool_word |= 0xFFFFFFFF << (8 * (spool_size & 3));
+		status = FLASH_ProgramWord(SPOOL_DATA_ADDRESS + (spool_size & ~3), spool_word);
+	}
+
+	// Magic is written last, a failed header stays invalid
+	if(status == FLASH_COMPLETE) {
+		status = FLASH_ProgramWord(SPOOL_START_ADDRESS + offsetof(Spool_Header_t, Size), spool_size);
+	}
+	if(status == FLASH_COMPLETE) {
+		status = FLASH_ProgramWord(SPOOL_START_ADDRESS + offsetof(Spool_Header_t, Lines), spool_lines);
+	}
+	if(status == FLASH_COMPLETE) {
+		status = FLASH_ProgramWord(SPOOL_START_ADDRESS + offsetof(Spool_Header_t, Crc), spool_crc);
+	}
+	if(status == FLASH_COMPLETE) {
+		status = FLASH_ProgramWord(SPOOL_START_ADDRESS + offsetof(Spool_Header_t, Magic), SPOOL_MAGIC);
+	}
+
+	FLASH_Lock();
+
+	if(status != FLASH_COMPLETE) {
+		return STATUS_SPOOL_FLASH_ERROR;
+	}
+
+	Spool_Report();
+
+	return STATUS_OK;
+}
+
+
+uint8_t Spool_Run(void)
+{
+	const Spool_Header_t *header = (const Spool_Header_t*)SPOOL_START_ADDRESS;
+
+	if(spool_state != SPOOL_STATE_IDLE) {
+		return STATUS_IDLE_ERROR;
+	}
+	if(header->Magic != SPOOL_MAGIC || header->Size > SPOOL_DATA_SIZE || Spool_CalculateCRC(header->Size) != header->Crc) {
+		return STATUS_SPOOL_INVALID;
+	}
+
+	run_ptr = (const char*)SPOOL_DATA_ADDRESS;
+	run_end = run_ptr + header->Size;
+	run_line = 0;
+	spool_state = SPOOL_STATE_RUN;
+
+	return STATUS_OK;
+}
+
+
+int8_t Spool_GetChar(char *c)
+{
+	if(spool_state != SPOOL_STATE_RUN) {
+		return -1;
+	}
+
+	if(run_ptr >= run_end) {
+		// Normally reported by Spool_LineDone(). Empty job or last line called a subroutine.
+		Spool_Done();
+
+		return -1;
+	}
+
+	*c = *run_ptr++;
+	if(*c == '\n') {
+		run_line++;
+	}
+
+	return 0;
+}
+
+
+void Spool_LineDone(void)
+{
+	if(spool_state == SPOOL_STATE_RUN && run_ptr >= run_end) {
+		Spool_Done();
+	}
+}
+
+
+void Spool_Abort(void)
+{
+	if(spool_state == SPOOL_STATE_RUN) {
+		spool_state = SPOOL_STATE_IDLE;
+
+		// Line number of failed line
+		Printf("[SPOOL:ERROR,%lu]\r\n", (unsigned long)run_line);
+		Print_FlushNotify();
+	}
+}
+
+
+void Spool_Stop(void)
+{
+	// An interrupted recording has no header and stays invalid
+	spool_state = SPOOL_STATE_IDLE;
+}
+
+
+uint8_t Spool_GetState(void)
+{
+	return spool_state;
+}
+
+
+void Spool_Report(void)
+{
+	const Spool_Header_t *header = (const Spool_Header_t*)SPOOL_START_ADDRESS;
+	uint32_t lines = 0, size = 0, crc = 0;
+
+	if(spool_state == SPOOL_STATE_RECORD) {
+		// Upload in progress
+		lines = spool_lines;
+		size = spool_size;
+		crc = spool_crc;
+	}
+	else if(header->Magic == SPOOL_MAGIC) {
+		lines = header->Lines;
+		size = header->Size;
+		crc = header->Crc;
+	}
+
+	Printf("[SPOOL:%lu,%lu,%08lX]\r\n", (unsigned long)lines, (unsigned long)size, (unsigned long)crc);
+	Print_Flush();
+}
+
+
+static FLASH_Status Spool_Put(char c)
+{
+	FLASH_Status status = FLASH_COMPLETE;
+
+	spool_word |= (uint32_t)(uint8_t)c << (8 * (spool_size & 3));
+	spool_size++;
+
+	// Flash is programmed in words
+	if((spool_size & 3) == 0) {
+		status = FLASH_ProgramWord(SPOOL_DATA_ADDRESS + spool_size - 4, spool_word);
+		spool_word = 0;
+	}
+
+	return status;
+}
+
+
+static void Spool_Done(void)
+{
+	spool_state = SPOOL_STATE_IDLE;
+
+	Printf("[SPOOL:DONE,%lu]\r\n", (unsigned long)run_line);
+	Print_FlushNotify();
+}
+
+
+static uint32_t Spool_CalculateCRC(uint32_t size)
+{
+	const uint8_t *data = (const uint8_t*)SPOOL_DATA_ADDRESS;
+	uint32_t crc = 0;
+
+	while(size) {
+		uint16_t chunk = (size > 0x8000) ? 0x8000 : size;
+
+		crc = CRC_UpdateCRC32(crc, data, chunk);
+		data += chunk;
+		size -= chunk;
+	}
+
+	return crc;
+}
@@ -0,0 +1,64 @@
+/*
+  Spool.h - Stores a job in internal flash and runs it locally
+  Part of Grbl-Advanced
+
+  Copyright (c)	2019 Patrick F.
+
+  Grbl-Advanced is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl-Advanced is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl-Advanced.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef SPOOL_H_INCLUDED
+#define SPOOL_H_INCLUDED
+
+
+#include <stdint.h>
+
+
+// Flash sector 5 (128 KB). The firmware is linked below it, settings use sectors 6 and 7.
+#define SPOOL_START_ADDRESS			((uint32_t)0x08020000)
+#define SPOOL_SIZE					((uint32_t)0x20000)
+#define SPOOL_SECTOR				FLASH_Sector_5
+
+// Spool states
+#define SPOOL_STATE_IDLE			0
+#define SPOOL_STATE_RECORD			1
+#define SPOOL_STATE_RUN				2
+
+
+void Spool_Init(void);
+
+// Erases the spool and stores following g-code lines. Stalls the CPU for ~1s. [IDLE/ALARM]
+uint8_t Spool_Start(void);
+// Appends one line (as filtered by the protocol, without whitespace and comments)
+uint8_t Spool_Append(const char *line);
+// Writes header with size and CRC32. The job is valid afterwards.
+uint8_t Spool_Finish(void);
+
+// Checks CRC and starts executing the stored job
+uint8_t Spool_Run(void);
+// Next character of a running job. Returns -1, if no job is running or it is complete.
+int8_t Spool_GetChar(char *c);
+// Called after the status of each line of the job. Reports the end after the last one.
+void Spool_LineDone(void);
+// Cancels running job after an error
+void Spool_Abort(void);
+// Cancels running job or recording after a reset
+void Spool_Stop(void);
+
+uint8_t Spool_GetState(void);
+
+// Prints '[SPOOL:<lines>,<bytes>,<crc32>]' of the stored job
+void Spool_Report(void);
+
+
+#endif /* SPOOL_H_INCLUDED */
@@ -25,6 +25,7 @@
 #include "Planner.h"
 #include "Probe.h"
 #include "SpindleControl.h"
+#include "CoolantControl.h"
 #include "System.h"
 #include "Settings.h"
 #include "util.h"
@@ -47,6 +48,12 @@
 #define PREP_FLAG_PARKING				BIT(2)
 #define PREP_FLAG_DECEL_OVERRIDE		BIT(3)
 
+// Dwell blocks are executed as segments without steps, one ISR tick per millisecond
+#define DWELL_CYCLES_PER_TICK			(uint16_t)(F_TIMER_STEPPER/1000)
+#define DWELL_SEGMENT_TICKS				5
+// Segment switches spindle direction and coolant to its accessory bits (PL_COND_ACCESSORY_MASK)
+#define SEGMENT_ACCESSORY_SYNC			BIT(0)
+
 // Define Adaptive Multi-Axis Step-Smoothing(AMASS) levels and cutoff frequencies. The highest level
 // frequency bin starts at 0Hz and ends at its cutoff frequency. The next lower level frequency bin
 // starts at the next higher cutoff frequency, and so on. The cutoff frequencies for each level must
@@ -97,6 +104,7 @@ typedef struct {
 	uint8_t  st_block_index;   // Stepper block data index. Uses this information to execute this segment.
 	uint8_t amass_level;    // Indicates AMASS level for the ISR to execute this segment
 	uint8_t spindle_pwm;
+	uint8_t accessory;      // Queued spindle direction and coolant state. 0 if unchanged.
 
 	uint8_t backlash_motion;
 } Stepper_Segment_t;
@@ -175,6 +183,9 @@ static Stepper_Block_t *st_prep_block;  // Pointer to the stepper block data bei
 static Stepper_PrepData_t prep;
 
 
+static uint8_t Stepper_PrepareDwell(void);
+
+
 /*    BLOCK VELOCITY PROFILE DEFINITION
           __________________________
          /|                        |\     _________________         ^
@@ -480,6 +491,12 @@ void Stepper_MainISR(void) {
 			st.steps[Y_AXIS] = st.exec_block->steps[Y_AXIS] >> st.exec_segment->amass_level;
 			st.steps[Z_AXIS] = st.exec_block->steps[Z_AXIS] >> st.exec_segment->amass_level;
 
+			if(st.exec_segment->accessory) {
+				// Queued spindle or coolant change of program mode
+				Spindle_SetDirection(st.exec_segment->accessory & PL_COND_SPINDLE_MASK);
+				Coolant_SetState(st.exec_segment->accessory & (PL_COND_FLAG_COOLANT_FLOOD | PL_COND_FLAG_COOLANT_MIST));
+			}
+
 			// Set real-time spindle output as segment is loaded, just prior to the first step.
 			Spindle_SetSpeed(st.exec_segment->spindle_pwm);
 
@@ -841,8 +858,10 @@ void Stepper_PrepareBuffer(void)
 
 				// Initialize segment buffer data for generating the segments.
 				prep.steps_remaining = (float)pl_block->step_event_count;
-				prep.step_per_mm = prep.steps_remaining/pl_block->millimeters;
-				prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR/prep.step_per_mm;
+				if(pl_block->dwell == 0.0) {
+					prep.step_per_mm = prep.steps_remaining/pl_block->millimeters;
+					prep.req_mm_increment = REQ_MM_INCREMENT_SCALAR/prep.step_per_mm;
+				}
 				prep.dt_remainder = 0.0; // Reset for new segment block
 
 				if((sys.step_control & STEP_CONTROL_EXECUTE_HOLD) || (prep.recalculate_flag & PREP_FLAG_DECEL_OVERRIDE)) {
@@ -972,6 +991,14 @@ void Stepper_PrepareBuffer(void)
 			BIT_TRUE(sys.step_control, STEP_CONTROL_UPDATE_SPINDLE_PWM); // Force update whenever updating block.
 		}
 
+		if(pl_block->dwell > 0.0) {
+			// Dwell block. Passes time without steps.
+			if(Stepper_PrepareDwell()) {
+				return;
+			}
+			continue;
+		}
+
 		// Initialize new segment
 		Stepper_Segment_t *prep_segment = &segment_buffer[segment_buffer_head];
 
@@ -979,6 +1006,7 @@ void Stepper_PrepareBuffer(void)
 		prep_segment->st_block_index = prep.st_block_index;
 
 		prep_segment->backlash_motion = pl_block->backlash_motion;
+		prep_segment->accessory = 0;
 
 		/*------------------------------------------------------------------------------------
 		Compute the average velocity of this new segment by determining the total distance
@@ -1246,6 +1274,68 @@ void Stepper_PrepareBuffer(void)
 }
 
 
+// Generates one segment of a dwell block. Returns 1, if the segment generation has to stop.
+static uint8_t Stepper_PrepareDwell(void)
+{
+	if(sys.step_control & STEP_CONTROL_EXECUTE_HOLD) {
+		// Machine is already at rest. Remaining time is executed after resume.
+		BIT_TRUE(sys.step_control, STEP_CONTROL_END_MOTION);
+
+		return 1;
+	}
+
+	Stepper_Segment_t *prep_segment = &segment_buffer[segment_buffer_head];
+	uint16_t ticks = DWELL_SEGMENT_TICKS;
+
+	if(pl_block->dwell < (DWELL_SEGMENT_TICKS/1000.0)) {
+		ticks = (uint16_t)(pl_block->dwell*1000.0 + 0.5);
+		if(ticks == 0) {
+			ticks = 1;
+		}
+	}
+
+	prep_segment->st_block_index = prep.st_block_index;
+	prep_segment->backlash_motion = 0;
+	prep_segment->n_step = ticks;
+	prep_segment->cycles_per_tick = DWELL_CYCLES_PER_TICK;
+	prep_segment->amass_level = 0;
+	prep_segment->accessory = 0;
+	if(pl_block->accessory_sync) {
+		prep_segment->accessory = (pl_block->condition & PL_COND_ACCESSORY_MASK) | SEGMENT_ACCESSORY_SYNC;
+	}
+
+	// Spindle state of the dwell block, e.g. stopped spindle of a G86 retract. A dynamic laser (M4)
+	// is off without motion.
+	if(sys.step_control & STEP_CONTROL_UPDATE_SPINDLE_PWM) {
+		if((pl_block->condition & (PL_COND_FLAG_SPINDLE_CW | PL_COND_FLAG_SPINDLE_CCW)) && !st_prep_block->is_pwm_rate_adjusted) {
+			prep.current_spindle_pwm = Spindle_ComputePwmValue(pl_block->spindle_speed);
+		}
+		else {
+			sys.spindle_speed = 0.0;
+			prep.current_spindle_pwm = SPINDLE_PWM_OFF_VALUE;
+		}
+
+		BIT_FALSE(sys.step_control, STEP_CONTROL_UPDATE_SPINDLE_PWM);
+	}
+	prep_segment->spindle_pwm = prep.current_spindle_pwm;
+
+	// Segment complete
+	segment_buffer_head = segment_next_head;
+	if(++segment_next_head == SEGMENT_BUFFER_SIZE) {
+		segment_next_head = 0;
+	}
+
+	pl_block->dwell -= ticks/1000.0;
+	if(pl_block->dwell <= 0.0) {
+		pl_block->dwell = 0.0;
+		pl_block = 0;
+		Planner_DiscardCurrentBlock();
+	}
+
+	return 0;
+}
+
+
 // Called by realtime status reporting to fetch the current speed being executed. This value
 // however is not exactly the current speed, but the speed computed in the last step segment
 // in the segment buffer. It will always be behind by up to the number of segment blocks (-1)
@@ -29,7 +29,12 @@
 #include "Stepper.h"
 #include "System.h"
 #include "ToolChange.h"
+#include "Recorder.h"
+#include "Spool.h"
+#include "Benchmark.h"
 #include "System32.h"
+#include "Print.h"
+#include "Platform.h"
 
 
 void System_Init(void)
@@ -61,6 +66,13 @@ void System_ResetPosition(void)
 uint8_t System_GetControlState(void)
 {
 	uint8_t control_state = 0;
+
+#ifdef ENABLE_RECORDER
+	if(Recorder_GetState() == REC_STATE_REPLAY) {
+		return Recorder_GetControlState();
+	}
+#endif
+
 	uint8_t pin = ((GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_0)<<CONTROL_RESET_BIT) |
 					(GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_1)<<CONTROL_FEED_HOLD_BIT) |
 					(GPIO_ReadInputDataBit(GPIOA, GPIO_Pin_4)<<CONTROL_CYCLE_START_BIT) |
@@ -177,8 +189,24 @@ uint8_t System_ExecuteLine(char *line)
 		return GC_ExecuteLine(line); // NOTE: $J= is ignored inside g-code parser and used to detect jog motions.
 		break;
 
-	case '$':
 	case 'G':
+		if(line[2] == 'R') {
+			// Switch serial link to GrIP framing and back. Response is sent in the old format.
+			if((line[3] != 'I') || (line[4] != 'P') || (line[5] != '=') || (line[7] != 0)) {
+				return STATUS_INVALID_STATEMENT;
+			}
+#if defined(ETH_IF) || defined(ENABLE_RECORDER)
+			return STATUS_SETTING_DISABLED;
+#else
+			if(line[6] != '0' && line[6] != '1') {
+				return STATUS_INVALID_STATEMENT;
+			}
+			Print_SetGrIP(line[6] == '1');
+			break;
+#endif
+		}
+		// fall through
+	case '$':
 	case 'C':
 	case 'X':
 		if(line[2] != 0) {
@@ -265,6 +293,48 @@ uint8_t System_ExecuteLine(char *line)
         }
         break;
 
+    case 'B':
+        if(line[2] == 'A') {
+            // Serial baud rate. '$BAUD' confirms a new rate and lists the supported ones,
+            // '$BAUD=<rate>' switches after the response. [IDLE/ALARM]
+            if((line[3] != 'U') || (line[4] != 'D')) {
+                return STATUS_INVALID_STATEMENT;
+            }
+            if(line[5] == 0) {
+                Print_ConfirmBaud();
+                Print_ReportBaudRates();
+                break;
+            }
+            if(line[5] != '=') {
+                return STATUS_INVALID_STATEMENT;
+            }
+            if(Print_GetTarget() == PRINT_ETH) {
+                // Would cut off the serial host, which can't confirm from here
+                return STATUS_INVALID_STATEMENT;
+            }
+            if(!(sys.state == STATE_IDLE || sys.state == STATE_ALARM)) {
+                return STATUS_IDLE_ERROR;
+            }
+            char_counter = 6;
+            if(!Read_Float(line, &char_counter, &value) || line[char_counter] != 0) {
+                return STATUS_BAD_NUMBER_FORMAT;
+            }
+            if(Print_SetBaud((uint32_t)value)) {
+                return STATUS_INVALID_STATEMENT;
+            }
+            break;
+        }
+#ifdef ENABLE_BENCHMARK
+        // Print and clear cycle counters
+        if(line[2] != 0) {
+            return STATUS_INVALID_STATEMENT;
+        }
+        Benchmark_Report();
+        break;
+#else
+        return STATUS_INVALID_STATEMENT;
+#endif
+
     case 'P':
         if(sys.is_homed)
         {
@@ -344,6 +414,29 @@ uint8_t System_ExecuteLine(char *line)
 			break;
 
 		case 'S': // Puts Grbl to sleep [IDLE/ALARM]
+			if(line[2] == 'P') {
+				// Job spool: '$SPOOL=START', lines, '$SPOOL=END'. '$SPOOL' prints size and CRC.
+				if(strncmp(&line[2], "POOL", 4) != 0) {
+					return STATUS_INVALID_STATEMENT;
+				}
+				if(line[6] == 0) {
+					Spool_Report();
+				}
+				else if(strcmp(&line[6], "=START") == 0) {
+					// Erasing the sector stalls the CPU for seconds. Never with motion queued or running.
+					if(!(sys.state == STATE_IDLE || sys.state == STATE_ALARM) || Planner_GetCurrentBlock()) {
+						return STATUS_IDLE_ERROR;
+					}
+					return Spool_Start();
+				}
+				else if(strcmp(&line[6], "=END") == 0) {
+					return Spool_Finish();
+				}
+				else {
+					return STATUS_INVALID_STATEMENT;
+				}
+				break;
+			}
 			if((line[2] != 'L') || (line[3] != 'P') || (line[4] != 0)) {
 				return(STATUS_INVALID_STATEMENT);
 			}
@@ -373,6 +466,53 @@ uint8_t System_ExecuteLine(char *line)
 			break;
 
 		case 'R': // Restore defaults [IDLE/ALARM]
+#ifdef ENABLE_RECORDER
+			if((line[2] == 'E') && (line[3] == 'C')) {
+				// Input recorder [IDLE/ALARM]
+				if(line[4] == 0) {
+					Recorder_Dump();
+					break;
+				}
+				if(line[4] == '+') {
+					return Recorder_Load(&line[5]);
+				}
+				if((line[4] != '=') || (line[6] != 0)) {
+					return STATUS_INVALID_STATEMENT;
+				}
+
+				switch(line[5])
+				{
+				case '0':
+					Recorder_Stop();
+					break;
+
+				case '1':
+					Recorder_Start();
+					break;
+
+				case 'C':
+					Recorder_Init();
+					break;
+
+				case 'P':
+					if(Recorder_Replay()) {
+						return STATUS_SETTING_READ_FAIL;
+					}
+					break;
+
+				default:
+					return STATUS_INVALID_STATEMENT;
+				}
+				break;
+			}
+#endif
+			if((line[2] == 'U') && (line[3] == 'N') && (line[4] == 0)) {
+				// Run spooled job [IDLE]
+				if(sys.state != STATE_IDLE || Planner_GetCurrentBlock()) {
+					return STATUS_IDLE_ERROR;
+				}
+				return Spool_Run();
+			}
 			if((line[2] != 'S') || (line[3] != 'T') || (line[4] != '=') || (line[6] != 0)) {
 				return(STATUS_INVALID_STATEMENT);
 			}
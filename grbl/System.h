@@ -144,6 +144,7 @@ typedef struct {
 #endif
 	float spindle_speed;
 	uint8_t is_homed;
+	uint8_t program_mode;        // Between '%' lines. Spindle, coolant and dwells don't sync the buffer.
 } System_t;
 
 extern System_t sys;
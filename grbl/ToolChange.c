@@ -19,6 +19,7 @@
 */
 #include <string.h>
 #include "ToolChange.h"
+#include "Config.h"
 #include "GCode.h"
 #include "MotionControl.h"
 #include "Protocol.h"
@@ -30,16 +31,20 @@
 
 
 static uint8_t isFirstTC = 1;
-static int32_t toolOffset = 0;
-static int32_t toolReferenz = 0;
+// Length (incl. wear) of the first tool applied by $T or G43. Offsets of all tools are relative to it.
+static float toolReferenz = 0.0;
+// Length of the previous tool. Expected trigger height for probing the next one.
+static float lastToolLength = 0.0;
+static uint8_t lastToolKnown = 0;
 static float tc_pos[N_AXIS] = {0};
 
 
 void TC_Init(void)
 {
     isFirstTC = 1;
-    toolOffset = 0;
-    toolReferenz = 0;
+    toolReferenz = 0.0;
+    lastToolLength = 0.0;
+    lastToolKnown = 0;
 
     memset(tc_pos, 0, sizeof(float)*N_AXIS);
 
@@ -96,7 +101,9 @@ void TC_ProbeTLS(void)
 {
     Planner_LineData_t pl_data = {0};
     float position[N_AXIS] = {0.0};
+    Tool_Data_t tool = {0};
     uint8_t flags = 0;
+    uint8_t ret = 0;
 
 
     if(sys.state == STATE_CHECK_MODE || settings.tls_valid == 0)
@@ -104,10 +111,6 @@ void TC_ProbeTLS(void)
 		return;
 	}
 
-	// Move to XY position of TLS
-	System_ConvertArraySteps2Mpos(position, settings.tls_position);
-	position[Z_AXIS] = 0.0;
-
     // Set-up planer
     pl_data.feed_rate = 0.0;
 	pl_data.condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
@@ -115,76 +118,134 @@ void TC_ProbeTLS(void)
     pl_data.spindle_speed = 0;
     pl_data.line_number = gc_state.line_number;
 
-    // Move to X/Y position of TLS
-	MC_Line(position, &pl_data);
+    // Only tools with a length set by G10 L1 aren't measured. A tool measured before may have been
+    // clamped differently since.
+    if(!Settings_ReadToolData(gc_state.tool, &tool) || tool.valid != TOOL_LENGTH_SET)
+    {
+        // Move to XY position of TLS
+        System_ConvertArraySteps2Mpos(position, settings.tls_position);
+        position[Z_AXIS] = 0.0;
+
+        // Move to X/Y position of TLS
+        MC_Line(position, &pl_data);
+
+        // Move down with offset (for tool). Probing ends at the same height for all tools.
+        float tls_z = settings.tls_position[Z_AXIS] / settings.steps_per_mm[Z_AXIS];
+        float probe_end = tls_z + TLS_PROBE_HEIGHT - TLS_PROBE_DISTANCE;
+        uint8_t adaptive = lastToolKnown && (lastToolLength + TLS_PROBE_CLEARANCE < TLS_PROBE_HEIGHT);
+
+        position[Z_AXIS] = tls_z + TLS_PROBE_HEIGHT;
+        MC_Line(position, &pl_data);
+
+        // Wait until queue is processed
+        Protocol_BufferSynchronize();
+
+        pl_data.condition = 0; // Set rapid motion condition flag.
+
+        if(adaptive)
+        {
+            // Approach the height, where the previous tool touched, as probe move. A longer tool
+            // triggers here and continues with the slow touch.
+            pl_data.feed_rate = TLS_APPROACH_RATE;
+            position[Z_AXIS] = tls_z + lastToolLength + TLS_PROBE_CLEARANCE;
+            ret = MC_ProbeCycle(position, &pl_data, GC_PARSER_PROBE_IS_NO_ERROR);
+            if(ret != GC_PROBE_FOUND && ret != GC_PROBE_FAIL_END)
+            {
+                // Error
+                return;
+            }
+        }
+
+        // Set up fast probing
+        pl_data.feed_rate = TLS_SEEK_RATE;
+
+        if(adaptive && ret != GC_PROBE_FOUND)
+        {
+            // Probe TLS fast around expected height. Continue below, if not found.
+            position[Z_AXIS] = max(probe_end, tls_z + lastToolLength - TLS_PROBE_CLEARANCE);
+            ret = MC_ProbeCycle(position, &pl_data, GC_PARSER_PROBE_IS_NO_ERROR);
+            if(ret != GC_PROBE_FOUND && ret != GC_PROBE_FAIL_END)
+            {
+                // Error
+                return;
+            }
+        }
+
+        if(ret != GC_PROBE_FOUND)
+        {
+            // Probe TLS fast
+            position[Z_AXIS] = probe_end;
+            ret = MC_ProbeCycle(position, &pl_data, flags);
+            if(ret != GC_PROBE_FOUND)
+            {
+                // Error
+                return;
+            }
+        }
+
+        // Trigger position. The machine stopped a bit below.
+        System_ConvertArraySteps2Mpos(position, sys_probe_position);
+        position[Z_AXIS] += TLS_PROBE_BACKOFF;
+
+        // Move up a little bit for slow probing
+        pl_data.feed_rate = TLS_SEEK_RATE;
+        MC_Line(position, &pl_data);
+
+        // Probe TLS slow. Touch is expected within the back off distance.
+        pl_data.feed_rate = TLS_FEED_RATE;
+        position[Z_AXIS] -= 2*TLS_PROBE_BACKOFF;
+        ret = MC_ProbeCycle(position, &pl_data, flags);
+        if(ret != GC_PROBE_FOUND)
+        {
+            // Error
+            return;
+        }
+
+        // Length relative to the stored tls position. Kept in the tool table for G43 H, if tool has an entry.
+        tool.length = (sys_probe_position[Z_AXIS] - settings.tls_position[Z_AXIS]) / settings.steps_per_mm[Z_AXIS];
+        tool.valid = TOOL_LENGTH_MEASURED;
+        Settings_WriteToolData(gc_state.tool, &tool);
+
+        Delay_ms(5);
+
+        // Move Z up
+        position[Z_AXIS] = 0.0;
+        pl_data.condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
+
+        MC_Line(position, &pl_data);
+    }
 
-    // Move down with offset (for tool)
-	position[Z_AXIS] = (settings.tls_position[Z_AXIS] / settings.steps_per_mm[Z_AXIS]) + 90.0;
-	MC_Line(position, &pl_data);
+    lastToolLength = tool.length;
+    lastToolKnown = 1;
 
-	// Wait until queue is processed
-    Protocol_BufferSynchronize();
+    // Apply offset as dynamic tool length offset. Zero for the first (reference) tool.
+    gc_state.modal.tool_length = TOOL_LENGTH_OFFSET_ENABLE_DYNAMIC;
+    gc_state.tool_length_offset = TC_GetToolOffset(tool.length + tool.wear);
+    System_FlagWcoChange();
 
-    // Set up fast probing
-    pl_data.feed_rate = 180.0;
-	pl_data.condition = 0; // Set rapid motion condition flag.
+    // Move back to initial tc position
+    MC_Line(tc_pos, &pl_data);
 
-    // Probe TLS fast
-    position[Z_AXIS] -= 200.0;
-    uint8_t ret = MC_ProbeCycle(position, &pl_data, flags);
-    if(ret != GC_PROBE_FOUND)
-    {
-        // Error
-        return;
-    }
+    // Wait until queue is processed
+    Protocol_BufferSynchronize();
 
-    // Get current position
-    System_ConvertArraySteps2Mpos(position, sys_position);
-    position[Z_AXIS] += 1.5;
+    GC_SyncPosition();
+}
 
-    // Move up a little bit for slow probing
-    pl_data.feed_rate = 200.0;
-    MC_Line(position, &pl_data);
-
-    // Probe TLS slow
-    pl_data.feed_rate = 12.0;
-    position[Z_AXIS] -= 200;
-    ret = MC_ProbeCycle(position, &pl_data, flags);
-    if(ret != GC_PROBE_FOUND)
-    {
-        // Error
-        return;
-    }
 
+float TC_GetToolOffset(float length)
+{
     if(isFirstTC)
     {
+        if(sys.state == STATE_CHECK_MODE)
+        {
+            return 0.0;
+        }
+
         // Save first tool as reference
         isFirstTC = 0;
-        toolReferenz = sys_probe_position[Z_AXIS];
+        toolReferenz = length;
     }
-    else
-    {
-        // Calculate tool offset
-        toolOffset = sys_probe_position[Z_AXIS] - toolReferenz;
-
-        // Apply offset as dynamic tool length offset
-        gc_state.modal.tool_length = TOOL_LENGTH_OFFSET_ENABLE_DYNAMIC;
-        gc_state.tool_length_offset = toolOffset / settings.steps_per_mm[Z_AXIS];
-    }
-
-    Delay_ms(5);
-
-    // Move Z up
-    position[Z_AXIS] = 0.0;
-    pl_data.condition |= PL_COND_FLAG_RAPID_MOTION; // Set rapid motion condition flag.
 
-    MC_Line(position, &pl_data);
-
-    // Move back to initial tc position
-    MC_Line(tc_pos, &pl_data);
-
-    // Wait until queue is processed
-    Protocol_BufferSynchronize();
-
-    GC_SyncPosition();
+    return length - toolReferenz;
 }
@@ -29,5 +29,12 @@ void TC_Init(void);
 void TC_ChangeCurrentTool(void);
 void TC_ProbeTLS(void);
 
+/**
+ * \brief   Tool length offset of a tool with length (incl. wear) from the tool table. Offsets are
+ *          relative to the first tool applied after power-up by $T or G43 (the tool used to set the
+ *          work zero), which becomes the reference.
+ */
+float TC_GetToolOffset(float length);
+
 
 #endif /* TOOLCHANGE_H_INCLUDED */
@@ -3,18 +3,23 @@
 
 
 #include "Config.h"
+#include "Benchmark.h"
 #include "CoolantControl.h"
 #include "debug.h"
+#include "Expression.h"
 #include "GCode.h"
 #include "Jog.h"
 #include "Limits.h"
 #include "MotionControl.h"
+#include "OWord.h"
 #include "Planner.h"
 #include "Probe.h"
 #include "Protocol.h"
+#include "Recorder.h"
 #include "Report.h"
 #include "Settings.h"
 #include "SpindleControl.h"
+#include "Spool.h"
 #include "Stepper.h"
 #include "System.h"
 #include "util.h"
@@ -32,6 +32,7 @@
 #include "FIFO_USART.h"
 #include "ComIf.h"
 #include "Platform.h"
+#include "EXTI.h"
 
 
 // Declare system global variable structure
@@ -72,10 +73,31 @@ int main(void)
 
     // Initialize TCP server
     ServerTCP_Init(ETH_SOCK, ETH_PORT);
+
+    // W5500 INTn
+    Exti_Init4(2, 1);
 #endif
 
     // Initialize GrIP protocol
-    GrIP_Init();
+#if defined(ETH_IF) && defined(ETH_RAW)
+    // Plain text for senders without GrIP support
+    GrIP_Init(IF_ETH_RAW);
+#elif defined(ETH_IF)
+    GrIP_Init(IF_ETH);
+#else
+    // Serial link switches to GrIP with '$GRIP=1'
+    GrIP_Init(IF_USB);
+#endif
+
+    Spool_Init();
+    Expr_Init();
+    OWord_Init();
+#ifdef ENABLE_RECORDER
+    Recorder_Init();
+#endif
+#ifdef ENABLE_BENCHMARK
+    Benchmark_Init();
+#endif
 
     // Init SysTick 1ms
 	SysTick_Init();
@@ -121,6 +143,9 @@ int main(void)
 		Probe_Init();
 		Spindle_Init();
 		Stepper_Reset();
+		// A reset cancels spooled job and running subroutines
+		Spool_Stop();
+		OWord_Abort();
 
 		// Sync cleared gcode and planner positions to current system position.
 		Planner_SyncPosition();
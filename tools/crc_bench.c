@@ -0,0 +1,107 @@
+/*
+  crc_bench.c - Host benchmark of the CRC library
+  Part of Grbl-Advanced
+
+  Build and run with 'make crcbench'. CRC.c is compiled once for each CRC_32_MODE, the
+  hardware mode only exists on the target. Results are in MB/s for GrIP sized packets.
+*/
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "CRC.h"
+
+
+#define PACKET_SIZE     256
+#define ITERATIONS      200000
+
+
+static double Bench(uint32_t (*func)(const uint8_t*, uint16_t), const uint8_t *data)
+{
+    volatile uint32_t sink = 0;
+    clock_t start = clock();
+
+    for(uint32_t i = 0; i < ITERATIONS; i++)
+    {
+        sink ^= func(data, PACKET_SIZE);
+    }
+
+    double sec = (double)(clock() - start) / CLOCKS_PER_SEC;
+    (void)sink;
+
+    return (double)PACKET_SIZE * ITERATIONS / sec / 1e6;
+}
+
+
+static uint32_t CRC8(const uint8_t *data, uint16_t len)
+{
+    return CRC_CalculateCRC8(data, len);
+}
+
+
+static uint32_t CRC16(const uint8_t *data, uint16_t len)
+{
+    return CRC_CalculateCRC16(data, len);
+}
+
+
+int main(int argc, char **argv)
+{
+    const uint8_t check[] = "123456789";
+    uint8_t data[PACKET_SIZE + 1];
+    int ret = 0;
+
+    CRC_Init();
+
+    // Check values of the catalogued algorithms
+    if(CRC_CalculateCRC8(check, 9) != 0x4B)
+    {
+        printf("CRC8 check failed: 0x%02X\n", CRC_CalculateCRC8(check, 9));
+        ret = 1;
+    }
+    if(CRC_CalculateCRC16(check, 9) != 0x29B1)
+    {
+        printf("CRC16 check failed: 0x%04X\n", CRC_CalculateCRC16(check, 9));
+        ret = 1;
+    }
+    for(uint16_t len = 0; len <= 9; len++)
+    {
+        // All lengths, so every tail of the sliced loops is used
+        uint32_t crc = 0xFFFFFFFF;
+
+        for(uint16_t i = 0; i < len; i++)
+        {
+            crc ^= check[i];
+            for(uint8_t b = 0; b < 8; b++)
+            {
+                crc = (crc & 1) ? ((crc >> 1) ^ 0xEDB88320) : (crc >> 1);
+            }
+        }
+
+        if(CRC_CalculateCRC32(check, len) != ~crc)
+        {
+            printf("CRC32 check failed for length %u: 0x%08X\n", len, CRC_CalculateCRC32(check, len));
+            ret = 1;
+        }
+    }
+
+    for(uint16_t i = 0; i < sizeof(data); i++)
+    {
+        data[i] = (uint8_t)(i * 7 + 3);
+    }
+
+    // Continued calculation must match a single pass
+    for(uint16_t split = 0; split <= 64; split++)
+    {
+        if(CRC_UpdateCRC32(CRC_UpdateCRC32(0, data, split), &data[split], 64 - split) != CRC_CalculateCRC32(data, 64))
+        {
+            printf("CRC32 update failed at %u\n", split);
+            ret = 1;
+        }
+    }
+
+    // Unaligned start, like a payload behind the 8 byte GrIP header
+    printf("%-10s CRC8 %7.1f MB/s  CRC16 %7.1f MB/s  CRC32 %7.1f MB/s\n", argc > 1 ? argv[1] : "",
+           Bench(CRC8, &data[1]), Bench(CRC16, &data[1]), Bench(CRC_CalculateCRC32, &data[1]));
+
+    return ret;
+}
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+#
+# crc_tables.py - Generates the constant CRC lookup tables
+# Part of Grbl-Advanced
+#
+# Usage: crc_tables.py > Libraries/CRC/CRC_Tables.h
+#
+# The tables live in flash. They were computed by CRC_Init() into RAM before.
+#
+
+CRC_8_POLYNOMIAL = 0x1D
+CRC_16_POLYNOMIAL = 0x1021
+# CRC32 is reflected, so the reversed polynomial 0x04C11DB7 is used
+CRC_32_POLYNOMIAL = 0xEDB88320
+
+
+def crc8_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = ((crc << 1) ^ CRC_8_POLYNOMIAL) if crc & 0x80 else (crc << 1)
+        table.append(crc & 0xFF)
+    return table
+
+
+def crc16_table():
+    table = []
+    for i in range(256):
+        crc = i << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ CRC_16_POLYNOMIAL) if crc & 0x8000 else (crc << 1)
+        table.append(crc & 0xFFFF)
+    return table
+
+
+def crc32_tables():
+    tables = [[]]
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = ((crc >> 1) ^ CRC_32_POLYNOMIAL) if crc & 1 else (crc >> 1)
+        tables[0].append(crc)
+    # Table n: CRC of byte followed by n zero bytes
+    for n in range(1, 8):
+        tables.append([(tables[n-1][i] >> 8) ^ tables[0][tables[n-1][i] & 0xFF] for i in range(256)])
+    return tables
+
+
+def rows(values, fmt, per_line, indent):
+    lines = []
+    for i in range(0, len(values), per_line):
+        lines.append(indent + ", ".join(fmt % v for v in values[i:i+per_line]) + ",")
+    lines[-1] = lines[-1][:-1]
+    return "\n".join(lines)
+
+
+def main():
+    out = []
+    out.append("/*")
+    out.append("  CRC_Tables.h - Constant lookup tables for CRC.c")
+    out.append("")
+    out.append("  Generated by tools/crc_tables.py, do not edit.")
+    out.append("*/")
+    out.append("#ifndef CRC_TABLES_H_INCLUDED")
+    out.append("#define CRC_TABLES_H_INCLUDED")
+    out.append("")
+    out.append("")
+    out.append("#if (CRC_8_MODE == TABLE)")
+    out.append("static const uint8_t CRC8Table[256u] =")
+    out.append("{")
+    out.append(rows(crc8_table(), "0x%02Xu", 12, "    "))
+    out.append("};")
+    out.append("#endif")
+    out.append("")
+    out.append("#if (CRC_16_MODE == TABLE)")
+    out.append("static const uint16_t CRC16Table[256u] =")
+    out.append("{")
+    out.append(rows(crc16_table(), "0x%04Xu", 8, "    "))
+    out.append("};")
+    out.append("#endif")
+    out.append("")
+    out.append("#if (CRC_32_MODE != RUNTTIME)")
+    out.append("// Reflected table for bytes. Slicing-by-N uses N tables, table n holds the CRC of a byte followed")
+    out.append("// by n zero bytes, so N bytes are processed with N independent lookups.")
+    out.append("static const uint32_t CRC32Table[CRC_32_SLICES][256u] =")
+    out.append("{")
+    tables = crc32_tables()
+    for n, table in enumerate(tables):
+        if n == 1:
+            out.append("#if (CRC_32_SLICES > 1)")
+        if n == 4:
+            out.append("#endif")
+            out.append("#if (CRC_32_SLICES > 4)")
+        out.append("    {")
+        out.append(rows(table, "0x%08Xu", 6, "        "))
+        out.append("    }" + ("," if n < 7 else ""))
+    out.append("#endif")
+    out.append("};")
+    out.append("#endif")
+    out.append("")
+    out.append("")
+    out.append("#endif // CRC_TABLES_H_INCLUDED")
+    print("\n".join(out))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,357 @@
+#!/usr/bin/env python3
+#
+# motion_encoder.py - Converts G-Code into GrIP packets with pre-parsed binary motion commands
+# Part of Grbl-Advanced
+#
+# Usage: motion_encoder.py job.nc job.bin [--file-lines]
+#
+# Linear moves, feed, spindle, coolant and dwells are encoded as MSG_MOTION packets
+# (see grbl/MotionStream.h). Everything else (arcs, probing, offsets, tool changes, ...)
+# is passed on as text in MSG_DATA packets, in the original order.
+#
+# The output file is a sequence of packets: <type:1><length:2, big endian><payload>.
+# The sender wraps each one into a GrIP packet of that type.
+#
+import argparse
+import re
+import sys
+
+
+GRIP_BUFFER_SIZE = 256
+MSG_DATA = 2
+MSG_MOTION = 7
+
+MS_SCALE = 1000
+N_AXIS = 3
+AXES = "XYZ"
+
+MS_OP_FEED_MOVE = 0x00
+MS_OP_RAPID_MOVE = 0x20
+MS_OP_POSITION = 0x40
+MS_OP_FEED = 0x60
+MS_OP_SPEED = 0x61
+MS_OP_LINE = 0x62
+MS_OP_SPINDLE = 0x63
+MS_OP_COOLANT = 0x64
+MS_OP_DWELL = 0x65
+
+# G-codes, which don't move the machine or change work coordinates. The parser needs them
+# for following text lines, so they are sent as text.
+G_MODAL = {17, 18, 19, 20, 21, 40, 49, 61, 80, 90, 91, 94}
+G_ARC = {2, 3}
+# Words allowed in a line encoded as motion packet
+ENCODABLE_WORDS = set("NGMXYZFSP")
+
+WORD = re.compile(r"([A-Z])([-+]?[0-9]*\.?[0-9]*)")
+# O-word lines, which open or close a subroutine or block
+OWORD = re.compile(r"O([0-9]+|<[^>]*>)(ENDSUB|ENDWHILE|ENDIF|ENDREPEAT|SUB|WHILE|IF|REPEAT)")
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        b = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(value):
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def strip(line):
+    # Same filtering as the protocol: No comments, whitespace or leading block delete, uppercase
+    line = re.sub(r"\([^)]*\)?", "", line.split(";", 1)[0])
+    return "".join(c for c in line.upper() if c > " ").lstrip("/")
+
+
+class Encoder:
+    def __init__(self, file_lines=False):
+        self.file_lines = file_lines
+        self.packets = []
+        self.type = None
+        self.payload = bytearray()
+
+        # Modal state, as the controller sees it
+        self.motion = 0
+        self.inches = False
+        self.incremental = False
+        self.inverse_time = False
+        self.feed = None
+        self.speed = None
+        self.spindle = None
+        self.coolant = None
+        self.line = None
+        # Open subroutines and blocks. Their lines are recorded by the controller.
+        self.oword_depth = 0
+        # Work position in counts. None if unknown (after probing, offset changes, ...)
+        self.pos = [None] * N_AXIS
+
+        self.text_lines = 0
+        self.motion_lines = 0
+
+    def flush(self):
+        if self.payload:
+            self.packets.append((self.type, bytes(self.payload)))
+        self.type = None
+        self.payload = bytearray()
+
+    def emit(self, msg_type, data, start=None):
+        if self.type != msg_type or len(self.payload) + len(data) > GRIP_BUFFER_SIZE:
+            self.flush()
+            self.type = msg_type
+
+            if msg_type == MSG_MOTION:
+                # Re-anchor known axes at the position before this record, so float rounding
+                # on the controller doesn't add up over many packets
+                known = [i for i in range(N_AXIS) if start[i] is not None]
+                if known:
+                    self.payload += bytes([MS_OP_POSITION | sum(1 << i for i in known)])
+                    for i in known:
+                        self.payload += varint(zigzag(start[i]))
+
+        self.payload += data
+
+    def to_counts(self, value):
+        mm = float(value) * (25.4 if self.inches else 1.0)
+        return int(round(mm * MS_SCALE))
+
+    def encode(self, raw, file_line):
+        line = strip(raw)
+        if not line:
+            return
+
+        if line.startswith("O") or self.oword_depth:
+            # Subroutines, loops and their bodies stay text
+            match = OWORD.match(line)
+            if match:
+                self.oword_depth += -1 if match.group(2).startswith("END") else 1
+            self.text(line, unknown=True)
+            return
+
+        words = WORD.findall(line)
+        if "".join(l + v for l, v in words) != line or any(v == "" for _, v in words):
+            # Not plain g-code ('$' commands etc.)
+            self.text(line, unknown=True)
+            return
+
+        g = [float(v) for l, v in words if l == "G"]
+        m = [float(v) for l, v in words if l == "M"]
+        val = {l: v for l, v in words if l not in "GM"}
+        axes = {AXES.index(l): val[l] for l in AXES if l in val}
+
+        # Track modal state first, it applies to text and motion packets alike
+        for code in g:
+            if code == 20:
+                self.inches = True
+            elif code == 21:
+                self.inches = False
+            elif code == 90:
+                self.incremental = False
+            elif code == 91:
+                self.incremental = True
+            elif code == 93:
+                self.inverse_time = True
+            elif code == 94:
+                self.inverse_time = False
+
+        motion = [c for c in g if c in (0, 1, 2, 3, 38.2, 38.3, 38.4, 38.5, 73, 80, 81, 82, 83, 85, 86, 89)]
+        if motion:
+            self.motion = motion[0]
+
+        encodable = (set(l for l, _ in words) <= ENCODABLE_WORDS and
+                     all(c in (0, 1, 4) for c in g) and
+                     all(c in (3, 4, 5, 7, 8, 9) for c in m) and
+                     not self.inverse_time and
+                     (not axes or self.motion in (0, 1)) and
+                     ("P" not in val or (4 in g and not axes)) and
+                     (4 not in g or "P" in val) and
+                     len(g) == len(set(g)))
+
+        if 2 in m or 30 in m:
+            # Program end resets modal state of the controller
+            self.motion = 1
+            self.incremental = False
+            self.inverse_time = False
+
+        if axes and self.motion == 1 and self.feed is None and "F" not in val:
+            # Controller may have a feed rate from text lines, but we can't be sure
+            encodable = False
+
+        if not encodable:
+            simple_motion = all(c in G_MODAL or c in G_ARC or c in (0, 1) for c in g) and \
+                            all(c in (3, 4, 5, 7, 8, 9) for c in m) and \
+                            self.motion in (0, 1, 2, 3)
+            self.text(line, unknown=not simple_motion, axes=axes)
+            self.track_values(val, m)
+            return
+
+        start = list(self.pos)
+        rec = bytearray()
+
+        # Same order of execution as the parser
+        number = int(float(val["N"])) if "N" in val else (file_line if self.file_lines else None)
+        if number is not None and number != self.line:
+            self.line = number
+            rec += bytes([MS_OP_LINE]) + varint(number)
+
+        if "F" in val:
+            feed = self.to_counts(val["F"])
+            if feed != self.feed:
+                self.feed = feed
+                rec += bytes([MS_OP_FEED]) + varint(feed)
+
+        if "S" in val:
+            speed = int(round(float(val["S"]) * MS_SCALE))
+            if speed != self.speed:
+                self.speed = speed
+                rec += bytes([MS_OP_SPEED]) + varint(speed)
+
+        for code in m:
+            if code in (3, 4, 5):
+                state = {5: 0, 3: 1, 4: 2}[int(code)]
+                if state != self.spindle:
+                    self.spindle = state
+                    rec += bytes([MS_OP_SPINDLE, state])
+
+        if any(c in (7, 8, 9) for c in m):
+            coolant = self.coolant or 0
+            for code in m:
+                if code == 9:
+                    coolant = 0
+                elif code == 8:
+                    coolant |= 1
+                elif code == 7:
+                    coolant |= 2
+            if coolant != self.coolant:
+                self.coolant = coolant
+                rec += bytes([MS_OP_COOLANT, coolant])
+
+        if 4 in g:
+            rec += bytes([MS_OP_DWELL]) + varint(int(round(float(val["P"]) * 1000)))
+
+        if axes:
+            mask = 0
+            deltas = bytearray()
+            anchor = bytearray()
+            anchor_mask = 0
+
+            for i in range(N_AXIS):
+                if i not in axes:
+                    continue
+
+                counts = self.to_counts(axes[i])
+                mask |= 1 << i
+
+                if self.incremental:
+                    delta = counts
+                    if self.pos[i] is not None:
+                        self.pos[i] += counts
+                elif self.pos[i] is None:
+                    # Start of move is unknown. Declare the target as last position and move by 0.
+                    anchor_mask |= 1 << i
+                    anchor += varint(zigzag(counts))
+                    delta = 0
+                    self.pos[i] = counts
+                else:
+                    delta = counts - self.pos[i]
+                    self.pos[i] = counts
+
+                deltas += varint(zigzag(delta))
+
+            if anchor_mask:
+                rec += bytes([MS_OP_POSITION | anchor_mask]) + anchor
+
+            op = MS_OP_RAPID_MOVE if self.motion == 0 else MS_OP_FEED_MOVE
+            rec += bytes([op | mask]) + deltas
+
+            if self.line is not None:
+                self.line += 1
+
+        if not rec:
+            if g:
+                # Only sets the motion mode
+                self.text(line, unknown=False)
+            return
+
+        self.emit(MSG_MOTION, bytes(rec), start)
+        self.motion_lines += 1
+
+    def track_values(self, val, m):
+        if "F" in val and not self.inverse_time:
+            self.feed = self.to_counts(val["F"])
+        elif "F" in val:
+            # Inverse time feed is not a feed rate
+            self.feed = None
+        if "S" in val:
+            self.speed = int(round(float(val["S"]) * MS_SCALE))
+        for code in m:
+            if code in (3, 4, 5):
+                self.spindle = {5: 0, 3: 1, 4: 2}[int(code)]
+            elif code == 9:
+                self.coolant = 0
+            elif code == 8:
+                self.coolant = (self.coolant or 0) | 1
+            elif code == 7:
+                self.coolant = (self.coolant or 0) | 2
+
+    def text(self, line, unknown, axes=None):
+        self.emit(MSG_DATA, line.encode("ascii") + b"\n")
+        self.text_lines += 1
+        # Text lines set the line number to their N word or 0
+        self.line = None
+
+        if unknown:
+            # Machine may have moved or work offsets changed
+            self.pos = [None] * N_AXIS
+            self.spindle = None
+            self.coolant = None
+            return
+
+        for i, value in (axes or {}).items():
+            counts = self.to_counts(value)
+            if self.incremental:
+                if self.pos[i] is not None:
+                    self.pos[i] += counts
+            else:
+                self.pos[i] = counts
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Encode G-Code into binary motion packets")
+    parser.add_argument("gcode")
+    parser.add_argument("output")
+    parser.add_argument("--file-lines", action="store_true",
+                        help="Report line numbers of the file instead of N words")
+    args = parser.parse_args()
+
+    enc = Encoder(args.file_lines)
+    size = 0
+    with open(args.gcode) as f:
+        for num, line in enumerate(f, 1):
+            size += len(strip(line)) + 1 if strip(line) else 0
+            try:
+                enc.encode(line, num)
+            except ValueError as e:
+                print("%s:%d: %s" % (args.gcode, num, e), file=sys.stderr)
+                return 1
+    enc.flush()
+
+    out = 0
+    with open(args.output, "wb") as f:
+        for msg_type, payload in enc.packets:
+            f.write(bytes([msg_type]) + len(payload).to_bytes(2, "big") + payload)
+            out += len(payload)
+
+    print("Motion lines: %d, text lines: %d, packets: %d" %
+          (enc.motion_lines, enc.text_lines, len(enc.packets)))
+    print("Payload: %d bytes (text: %d bytes)" % (out, size))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())